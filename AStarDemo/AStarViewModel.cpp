@@ -23,10 +23,12 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <limits>
 #include <cassert>
 #include <string>
 #include <memory>
 #include <thread>
+#include <utility>
 
 
 
@@ -66,7 +68,7 @@ namespace winrt::AStarDemo::implementation
         NotifyPropertyChanged(fieldname);
     }
 
-    AStarViewModel::AStarViewModel(): goButtonEnabled(false), loadedMap(false), mouseActive(false), map(), solver(map), running(false), dx(0), dy(0), marginx(0), marginy(0), tiles(nullptr), startMapX(0), startMapY(0), tilesPerHeight(0), tilesPerRow(0)
+    AStarViewModel::AStarViewModel(): goButtonEnabled(false), loadedMap(false), mouseActive(false), map(), running(false), dx(0), dy(0), marginx(0), marginy(0), tiles(nullptr), startMapX(0), startMapY(0), tilesPerHeight(0), tilesPerRow(0), searchStateStale(false)
     {
     }
 
@@ -95,11 +97,20 @@ namespace winrt::AStarDemo::implementation
      */
     IAsyncAction AStarViewModel::LoadFile(const StorageFile& file)
     {
-        winrt::hstring data = co_await FileIO::ReadTextAsync(file);
-        std::wstring str(data.data());
-        std::wistringstream buffer(str);
+        bool loaded = false;
+        if (file.FileType() == L".amap") {
+            // binary maps are memory mapped instead of being read as text
+            auto binary = BinaryMap::open(std::wstring(file.Path()));
+            loaded = binary != nullptr && LoadMap(*binary);
+        }
+        else {
+            winrt::hstring data = co_await FileIO::ReadTextAsync(file);
+            std::wstring str(data.data());
+            std::wistringstream buffer(str);
+            loaded = LoadMap(buffer);
+        }
 
-        if (LoadMap(buffer))
+        if (loaded)
         {
             ChangeFieldValue(goButtonEnabled, true, L"GoButtonEnabled");
             ChangeFieldValue(loadedMap, true, L"LoadedMap");
@@ -125,6 +136,7 @@ namespace winrt::AStarDemo::implementation
                 // render the background
                 renderTarget.Clear(Colors::White());
 
+                ApplyExpansions();
                 DrawMap(renderTarget);
             }
         }
@@ -137,6 +149,7 @@ namespace winrt::AStarDemo::implementation
     {
         StopSearch();
         map.clear();
+        searchStateStale = true;
     }
 
     /**
@@ -283,20 +296,37 @@ namespace winrt::AStarDemo::implementation
         auto startPos = map.get_start();
         auto endPos = map.get_end();
 
+        WaitForSearch();
+        expansions.track(static_cast<std::size_t>(map.rows()) * map.columns());
+        expansions.open();
+        searchStop = std::stop_source();
         running = true;
 
-        backTask = std::async(std::launch::async, [this, startPos, endPos]() {
-            // Initialize the required data
+        std::promise<void> done;
+        backTask = done.get_future();
+        RunSearch({ startPos.first, startPos.second }, { endPos.first, endPos.second }, searchStop.get_token(), std::move(done));
+    }
 
-            auto start = std::make_shared<Node>(startPos.first, startPos.second);
-            auto end = std::make_shared<Node>(endPos.first, endPos.second);
+    /**
+    *  @brief Runs the search on the interactive lane of the thread pool, resuming on the worker that ran it.
+    *  @param done set once the path was added to the map, or the search failed
+    */
+    winrt::fire_and_forget AStarViewModel::RunSearch(PathPoint start, PathPoint goal, std::stop_token stop, std::promise<void> done)
+    {
+        try {
+            // streaming the searched cells so that they get drawn
+            StreamObserver observer(expansions, map.columns());
+            const auto result = co_await searches.find_async(map, start, goal, observer, TaskPriority::INTERACTIVE, stop);
 
-            // now find the result
-            auto res = solver.find(start, end);
-            map.add_path(res.get());
-            this->StopSearch();
-            return res;
-        });
+            // a cancelled search has no path to show
+            map.add_path(result.path);
+            StopSearch();
+            done.set_value();
+        }
+        catch (...) {
+            StopSearch();
+            done.set_exception(std::current_exception());
+        }
     }
 
     /**
@@ -305,6 +335,20 @@ namespace winrt::AStarDemo::implementation
     void AStarViewModel::StopSearch()
     {
         running = false;
+        searchStop.request_stop();
+    }
+
+    /**
+     *   @brief Waits for the background search to finish, if there is one.
+     *   The expansion stream is closed first, so that the events nobody draws anymore are not taken for an overflow.
+     */
+    void AStarViewModel::WaitForSearch()
+    {
+        if (backTask.valid()) {
+            LogInfo("task sleeping");
+            expansions.close();
+            backTask.wait();
+        }
     }
 
 
@@ -315,16 +359,27 @@ namespace winrt::AStarDemo::implementation
     {
         LogInfo("loading map");
         // Just in case another search is ongoing
-        if (backTask.valid()) {
-            LogInfo("task sleeping");
-            backTask.wait();
-        }
+        WaitForSearch();
 
         LogInfo("Loading file stream");
-         
+        searchStateStale = true;
         return map.load(fd);
     }
 
+    /**
+     *   @brief loads a new map from a file in the binary format.
+     */
+    bool AStarViewModel::LoadMap(const BinaryMap& file)
+    {
+        LogInfo("loading binary map");
+        // Just in case another search is ongoing
+        WaitForSearch();
+
+        searchStateStale = true;
+        file.load(map);
+        return true;
+    }
+
     /**
      *  @brief Loads the images required for the level being drawn.
      * @param device the Win2D to draw into.
@@ -343,6 +398,27 @@ namespace winrt::AStarDemo::implementation
         co_return;
     }
 
+    /**
+     * @brief Applies the cell changes published by the search since the last frame.
+     */
+    void AStarViewModel::ApplyExpansions()
+    {
+        const std::size_t cells = static_cast<std::size_t>(map.rows()) * map.columns();
+        if (searchStateStale.exchange(false) || searchState.size() != cells) {
+            searchState.assign(cells, SearchContext::CellState::UNSEEN);
+        }
+
+        expansions.drain([this, cells](const ExpansionEvent& event) {
+            if (event.state == SearchContext::CellState::UNSEEN) {
+                // a new search has started
+                searchState.assign(cells, SearchContext::CellState::UNSEEN);
+            }
+            else if (event.cell < searchState.size()) {
+                searchState[event.cell] = event.state;
+            }
+        });
+    }
+
     /**
      * @brief MapRender::draw_map Draws the real map.
      * @param device the Win2D to draw into.
@@ -352,9 +428,20 @@ namespace winrt::AStarDemo::implementation
         if (tiles != nullptr) {
             CanvasSpriteBatch sprites = painter.CreateSpriteBatch();
 
-            for (int row = 0; row < tilesPerHeight && row + startMapY < map.rows(); ++row) {
-                for (int col = 0; col < tilesPerRow && col + startMapX < map.columns(); ++col) {
-                    int spriteId = MapToSpriteId(map.at(row + startMapY, col + startMapX));
+            // one snapshot per frame, instead of locking the map for each tile
+            const auto snapshot = map.snapshot();
+
+            for (int row = 0; row < tilesPerHeight && row + startMapY < snapshot->rows(); ++row) {
+                for (int col = 0; col < tilesPerRow && col + startMapX < snapshot->columns(); ++col) {
+                    auto cell = snapshot->at(row + startMapY, col + startMapX);
+
+                    // the searched cells are not stored on the map, they come from the expansion stream
+                    const std::size_t index = static_cast<std::size_t>(row + startMapY) * snapshot->columns() + col + startMapX;
+                    if (cell == Map::CellType::FREE && index < searchState.size() && searchState[index] == SearchContext::CellState::CLOSED) {
+                        cell = Map::CellType::VISITED;
+                    }
+
+                    int spriteId = MapToSpriteId(cell);
 
                     float2 dest{
                         static_cast<float>(col * map.tilesWidth()),
@@ -27,9 +27,12 @@ import SpriteSheet;
 
 #include "AStarViewModel.g.h"
 
+#include <atomic>
 #include <future>
 #include <string>
 #include <iosfwd>
+#include <stop_token>
+#include <vector>
 
 namespace winrt::AStarDemo::implementation
 {
@@ -72,24 +75,34 @@ namespace winrt::AStarDemo::implementation
         winrt::event<winrt::Windows::UI::Xaml::Data::PropertyChangedEventHandler> propertyChanged;
 
         AStarLib::Map map;
-        AStarLib::AStarSolver solver;
+        AStarLib::AsyncSolver searches;
         int marginx, marginy;
         int dx, dy;
         bool running;
         int startMapX, startMapY;
         int tilesPerRow, tilesPerHeight;
 
+        // search progress, published by the search thread and applied by the drawing one
+        AStarLib::ExpansionStream expansions;
+        std::vector<AStarLib::SearchContext::CellState> searchState;
+        std::atomic<bool> searchStateStale;
+
+        void ApplyExpansions();
         void DrawMap(const winrt::Microsoft::Graphics::Canvas::CanvasDrawingSession& painter) const;
         int MapToSpriteId(AStarLib::Map::CellType cell) const;
 
         void StartSearch();
+        winrt::fire_and_forget RunSearch(AStarLib::PathPoint start, AStarLib::PathPoint goal, std::stop_token stop, std::promise<void> done);
         void StopSearch();
+        void WaitForSearch();
         bool LoadMap(std::wistream& fd);
+        bool LoadMap(const AStarLib::BinaryMap& file);
 
         std::unique_ptr<SpriteSheet> tiles;
 
-        // Handle for the A* background processing.
-        std::future<AStarLib::AStarSolver::NodePtr> backTask;
+        // Handle for the A* background processing, and the means to cancel it.
+        std::future<void> backTask;
+        std::stop_source searchStop;
     };
 }
 
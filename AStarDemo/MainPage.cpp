@@ -74,6 +74,7 @@ namespace winrt::AStarDemo::implementation
 
         openPicker.FileTypeFilter().Clear();
         openPicker.FileTypeFilter().Append(L".txt");
+        openPicker.FileTypeFilter().Append(L".amap");
 
         StorageFile file = co_await openPicker.PickSingleFileAsync();
         if (file != nullptr && file.IsAvailable()) {
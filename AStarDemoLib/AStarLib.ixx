@@ -19,7 +19,27 @@
 export module AStarLib;
 
 export import Node;
+export import Path;
+export import Connectivity;
 export import Map;
+export import MapFile;
 export import Logger;
+export import OpenList;
+export import SearchContext;
+export import SearchObserver;
+export import SearchPolicies;
+export import ExpansionStream;
 export import AStarSolver;
+export import JumpPointSolver;
+export import HierarchicalSolver;
+export import ThreadPool;
+export import BatchSolver;
+export import AsyncSolver;
+export import FlowField;
+export import CooperativePlanner;
+export import BidirectionalSolver;
+export import IncrementalSolver;
+export import PathCache;
+export import ChunkedMap;
+export import ChunkedSolver;
 
@@ -19,44 +19,145 @@
 export module AStarSolver;
 
 import <memory>;
-import <unordered_set>;
-import <queue>;
 import <vector>;
 import <algorithm>;
 import <string>;
-import <functional>;
 import <cassert>;
-import <format>;
+import <cstddef>;
+import <cstdint>;
+import <cmath>;
+import <chrono>;
+import <limits>;
+import <span>;
+import <stop_token>;
 
 import Node;
+import Path;
 import Map;
-import Logger;
+import OpenList;
+import SearchContext;
+import SearchObserver;
+import SearchPolicies;
 
 export namespace AStarLib {
 
     /**
      * Searchs for a possible path between two given points by using the A* algorithm.
+     *
+     * The heuristic, movement costs, allowed moves and tie breaking come from the Policy,
+     * a SearchPolicy, so that each combination gets its own fully inlined search loop.
+     * AStarSolver is the one all the other solvers share their costs with.
+     *
+     * The solver keeps its scratch memory between searches, so a single instance
+     * should not be used by several threads at the same time. Several solvers can
+     * share a MapSnapshot and search it concurrently, while the map keeps being edited.
+     *
+     * The searches only read the map. What happens during a search can be followed by
+     * passing a SearchObserver to find(), e.g. MapVisitObserver to draw the searched area.
+     *
+     * Besides find(), a search can be started with start() and then advanced in slices
+     * with step() or run_until(), to spread it over several frames. It can be cancelled
+     * with the stop token given to start(), and partial_path() then leads to the cell
+     * closest to the goal found so far. A live Map should not be edited between the
+     * slices of a search, searching a snapshot avoids that.
+     *
+     * The path found is kept as cell indices on the solver. path() turns it into a chain
+     * of nodes only when asked, copy_path() hands it out as a Path or into the caller's
+     * own memory, which is much cheaper for long paths.
      */
-    export class AStarSolver
+    template<typename Policy>
+    class BasicAStarSolver
     {
     public:
         using NodePtr = std::shared_ptr<Node>;
-        AStarSolver(Map& map) noexcept;
+        BasicAStarSolver(Map& map);
+        explicit BasicAStarSolver(std::shared_ptr<const MapSnapshot> snapshot);
 
         NodePtr find(NodePtr start, NodePtr goal);
 
-    private:
-        Map& m_map;
+        template<SearchObserver Observer>
+        NodePtr find(NodePtr start, NodePtr goal, Observer& observer);
+
+        Path find(int start_row, int start_col, int goal_row, int goal_col);
+
+        void start(NodePtr start, NodePtr goal, std::stop_token stop = {});
+        void start(int start_row, int start_col, int goal_row, int goal_col, std::stop_token stop = {});
+
+        SearchStatus step(std::size_t max_expansions);
+
+        template<SearchObserver Observer>
+        SearchStatus step(std::size_t max_expansions, Observer& observer);
+
+        SearchStatus run_until(std::chrono::steady_clock::time_point deadline);
+
+        template<SearchObserver Observer>
+        SearchStatus run_until(std::chrono::steady_clock::time_point deadline, Observer& observer);
+
+        SearchStatus status() const noexcept { return m_status; }
+        NodePtr path();
+        NodePtr partial_path();
+
+        std::size_t path_length() const noexcept { return m_status == SearchStatus::FOUND ? m_path.size() : 0; }
+        bool copy_path(Path& path) const;
+        std::size_t copy_path(std::span<PathPoint> points) const noexcept;
 
+        void attach(std::shared_ptr<const MapSnapshot> snapshot);
 
-        double movement_cost(const Node& from, const Node& to) const noexcept;
-        double estimate(const Node& current, const Node& goal) const noexcept;
-        void sucessors(NodePtr current, const Node& goal, std::vector<NodePtr>& neighbours);
+        const SearchStats& stats() const noexcept { return m_stats; }
+
+    private:
+        using Context = typename Policy::Cost::Context;
+        using Cost = typename Context::CostType;
+
+        Map* m_map;
+        std::shared_ptr<const MapSnapshot> m_snapshot;
+        Context m_context;
+        SearchStats m_stats;
+        // the cells of the path found, from the goal back to the start
+        std::vector<std::uint32_t> m_path;
+
+        // the search in progress
+        NodePtr m_start;
+        NodePtr m_result;
+        int m_start_row = 0;
+        int m_start_col = 0;
+        int m_goal_row = 0;
+        int m_goal_col = 0;
+        std::stop_token m_stop;
+        SearchStatus m_status = SearchStatus::IDLE;
+        bool m_pending = false;
+        int m_rows = 0;
+        int m_columns = 0;
+        std::uint32_t m_goal_index = 0;
+        std::uint32_t m_closest = 0;
+        Cost m_closest_estimate{};
+
+        template<typename Grid, typename Observer>
+        void begin(const Grid& grid, Observer& observer);
+
+        template<typename Grid, typename Observer>
+        SearchStatus advance(const Grid& grid, std::size_t max_expansions, Observer& observer);
+
+        Cost estimate(int row, int col) const noexcept;
+        void trace(std::uint32_t goal);
+        NodePtr build_path();
     };
-}
 
-// Uncomment if debugging information for the solver is desired
-//#define DEBUG_ASTAR_SOLVER
+    // the solver everything else compares against, 1.0 and 1.5 costs with an euclidean estimate
+    using AStarSolver = BasicAStarSolver<SearchPolicy<>>;
+
+    // same costs, with the tightest estimate for them and ties broken towards the goal
+    using OctileSolver = BasicAStarSolver<SearchPolicy<OctileHeuristic, StandardCost, EightConnected, PreferDeeper>>;
+
+    // 4 connected grids
+    using ManhattanSolver = BasicAStarSolver<SearchPolicy<ManhattanHeuristic, StandardCost, FourConnected, PreferDeeper>>;
+
+    // uninformed search, mostly useful as a reference for the others
+    using DijkstraSolver = BasicAStarSolver<SearchPolicy<ZeroHeuristic>>;
+
+    // same paths as OctileSolver, with costs counted in half steps on a bucket queue
+    using IntegerSolver = BasicAStarSolver<SearchPolicy<OctileHeuristic, IntegerCost>>;
+}
 
 // make the standard C++ library available on the local namespace
 using namespace std;
@@ -64,179 +165,444 @@ using namespace std;
 // also to reduce typing
 using namespace AStarLib;
 
-// Helper functions for the ClosedType
-size_t hash_func(const AStarSolver::NodePtr& n)
+
+template<typename Policy>
+BasicAStarSolver<Policy>::BasicAStarSolver(Map& map) : m_map(&map)
 {
-    return n->col() + static_cast<size_t>(n->row());
 }
 
-bool equal_func(const AStarSolver::NodePtr& lhs, const AStarSolver::NodePtr& rhs)
+/**
+ * @brief Constructs a solver that only reads the given snapshot.
+ * @param snapshot the map contents to search on
+ */
+template<typename Policy>
+BasicAStarSolver<Policy>::BasicAStarSolver(shared_ptr<const MapSnapshot> snapshot) : m_map(nullptr), m_snapshot(std::move(snapshot))
 {
-    return (lhs->col() == rhs->col()) && (lhs->row() == rhs->row());
+    assert(m_snapshot != nullptr);
 }
 
-bool heap_comparator(const AStarSolver::NodePtr& lhs, const AStarSolver::NodePtr& rhs) noexcept
+/**
+ * @brief Makes the following searches use another snapshot, keeping the scratch memory.
+ * @param snapshot the map contents to search on
+ */
+template<typename Policy>
+void BasicAStarSolver<Policy>::attach(shared_ptr<const MapSnapshot> snapshot)
 {
-    return lhs->total_cost() > rhs->total_cost();
+    assert(snapshot != nullptr);
+    m_map = nullptr;
+    m_snapshot = std::move(snapshot);
 }
 
-// Helper type definitons
-typedef vector<AStarSolver::NodePtr> SucessorsType;
-typedef vector<AStarSolver::NodePtr> OpenType;
-typedef unordered_set<AStarSolver::NodePtr, function<decltype(hash_func)>, function<decltype(equal_func)>> ClosedType;
+/**
+ * A* search function
+ * The search state lives on the solver's SearchContext, only the returned
+ * path is allocated on the heap.
+ *
+ * @param start where to start searching from
+ * @param goal   the target destination
+ * @return null if nothing was found, the reversed path otherwise.
+ */
+template<typename Policy>
+typename BasicAStarSolver<Policy>::NodePtr BasicAStarSolver<Policy>::find(NodePtr start, NodePtr goal)
+{
+    NullObserver observer;
+    return find(start, goal, observer);
+}
 
+/**
+ * A* search function, reporting its progress to the given observer.
+ *
+ * @param start where to start searching from
+ * @param goal   the target destination
+ * @param observer called on every open list change and expansion
+ * @return null if nothing was found, the reversed path otherwise.
+ */
+template<typename Policy>
+template<SearchObserver Observer>
+typename BasicAStarSolver<Policy>::NodePtr BasicAStarSolver<Policy>::find(NodePtr start, NodePtr goal, Observer& observer)
+{
+    this->start(std::move(start), std::move(goal));
+    step(numeric_limits<size_t>::max(), observer);
+    return path();
+}
+
+/**
+ * A* search function, without building any nodes.
+ *
+ * @param start_row where to start searching from
+ * @param start_col where to start searching from
+ * @param goal_row the target destination
+ * @param goal_col the target destination
+ * @return an empty path if nothing was found, the cells from the start to the goal otherwise.
+ */
+template<typename Policy>
+Path BasicAStarSolver<Policy>::find(int start_row, int start_col, int goal_row, int goal_col)
+{
+    start(start_row, start_col, goal_row, goal_col);
+    step(numeric_limits<size_t>::max());
+
+    Path path;
+    copy_path(path);
+    return path;
+}
+
+/**
+ * @brief Prepares a search to be run in slices with step() or run_until().
+ * Any search still in progress is abandoned.
+ * @param start where to start searching from, it becomes the end of the chain path() returns
+ * @param goal   the target destination
+ * @param stop cancels the search when requested, it is checked before each expansion
+ */
+template<typename Policy>
+void BasicAStarSolver<Policy>::start(NodePtr start, NodePtr goal, stop_token stop)
+{
+    this->start(start->row(), start->col(), goal->row(), goal->col(), std::move(stop));
+    m_start = std::move(start);
+}
 
 /**
-* Debuging function. I did not declare it as
-* private members, so that I don't need to expose the implementation.
-*/
-template<typename T>
-void write_data(ostream& output, const string& name, const T& data)
+ * @brief Prepares a search to be run in slices with step() or run_until().
+ * Any search still in progress is abandoned.
+ * @param start_row where to start searching from
+ * @param start_col where to start searching from
+ * @param goal_row the target destination
+ * @param goal_col the target destination
+ * @param stop cancels the search when requested, it is checked before each expansion
+ */
+template<typename Policy>
+void BasicAStarSolver<Policy>::start(int start_row, int start_col, int goal_row, int goal_col, stop_token stop)
 {
-    LogInfo(std::format("Start {}", name));
-    for (shared_ptr<Node> next_node : data) {
-        if (next_node != nullptr) {
-            next_node->write_contents(output);
+    m_start = nullptr;
+    m_result = nullptr;
+    m_path.clear();
+    m_start_row = start_row;
+    m_start_col = start_col;
+    m_goal_row = goal_row;
+    m_goal_col = goal_col;
+    m_stop = std::move(stop);
+    m_status = SearchStatus::RUNNING;
+    m_pending = true;
+}
+
+/**
+ * @brief Advances the search started with start().
+ * @param max_expansions the most cells to expand before returning
+ * @return RUNNING while the search has not ended.
+ */
+template<typename Policy>
+SearchStatus BasicAStarSolver<Policy>::step(size_t max_expansions)
+{
+    NullObserver observer;
+    return step(max_expansions, observer);
+}
+
+/**
+ * @brief Advances the search started with start(), reporting its progress to the given observer.
+ * @param max_expansions the most cells to expand before returning
+ * @param observer called on every open list change and expansion
+ * @return RUNNING while the search has not ended.
+ */
+template<typename Policy>
+template<SearchObserver Observer>
+SearchStatus BasicAStarSolver<Policy>::step(size_t max_expansions, Observer& observer)
+{
+    if (m_map != nullptr) {
+        return advance(*m_map, max_expansions, observer);
+    }
+    else {
+        return advance(*m_snapshot, max_expansions, observer);
+    }
+}
+
+/**
+ * @brief Advances the search started with start() until it ends or the deadline passes.
+ * @param deadline when to give control back, at least one slice of the search is always run
+ * @return RUNNING while the search has not ended.
+ */
+template<typename Policy>
+SearchStatus BasicAStarSolver<Policy>::run_until(chrono::steady_clock::time_point deadline)
+{
+    NullObserver observer;
+    return run_until(deadline, observer);
+}
+
+/**
+ * @brief Advances the search started with start() until it ends or the deadline passes,
+ * reporting its progress to the given observer.
+ * @param deadline when to give control back, at least one slice of the search is always run
+ * @param observer called on every open list change and expansion
+ * @return RUNNING while the search has not ended.
+ */
+template<typename Policy>
+template<SearchObserver Observer>
+SearchStatus BasicAStarSolver<Policy>::run_until(chrono::steady_clock::time_point deadline, Observer& observer)
+{
+    // reading the clock costs about as much as an expansion, so it is only done between slices
+    constexpr size_t slice = 64;
+
+    while (step(slice, observer) == SearchStatus::RUNNING) {
+        if (chrono::steady_clock::now() >= deadline) {
+            break;
         }
     }
-    LogInfo(std::format("\nEnd {}", name));
+    return m_status;
 }
 
+/**
+ * @brief The path found, as a chain of nodes built on the first call.
+ * @return null while the search has not found the goal.
+ */
+template<typename Policy>
+typename BasicAStarSolver<Policy>::NodePtr BasicAStarSolver<Policy>::path()
+{
+    if (m_status != SearchStatus::FOUND) {
+        return nullptr;
+    }
+    if (m_result == nullptr) {
+        m_result = build_path();
+    }
+    return m_result;
+}
 
+/**
+ * @brief The path found, or when the search did not reach the goal, the path to the
+ * explored cell closest to it.
+ * @return null when no search was started or it has not expanded anything yet.
+ */
+template<typename Policy>
+typename BasicAStarSolver<Policy>::NodePtr BasicAStarSolver<Policy>::partial_path()
+{
+    if (m_status == SearchStatus::FOUND) {
+        return path();
+    }
+    if (m_status == SearchStatus::IDLE || m_pending) {
+        return nullptr;
+    }
+    trace(m_closest);
+    return build_path();
+}
 
-AStarSolver::AStarSolver(Map& map) noexcept : m_map(map)
+/**
+ * @brief Copies the path found, reusing the memory the given path already has.
+ * @param path where to copy the cells to, from the start to the goal
+ * @return false, leaving the path empty, while the search has not found the goal.
+ */
+template<typename Policy>
+bool BasicAStarSolver<Policy>::copy_path(Path& path) const
 {
+    if (m_status != SearchStatus::FOUND) {
+        path.clear();
+        return false;
+    }
+
+    copy_path(path.resize(m_path.size(), m_context.cost(m_goal_index) * Policy::Cost::scale));
+    return true;
 }
 
 /**
- * A* search function
- * The caller is responsible for cleaning the memory allocated for the
- * path. The arguments are assumed to be allocated on the heap.
- *
- * @param start where to start searching from
- * @param goal   the target destination
- * @return null if nothing was found, the reversed path otherwise.
+ * @brief Copies the path found into memory owned by the caller, without allocating.
+ * @param points where to copy the cells to, from the start to the goal
+ * @return the number of cells of the path, nothing is copied when they do not fit and
+ * 0 is returned while the search has not found the goal.
  */
-AStarSolver::NodePtr AStarSolver::find(NodePtr start, NodePtr goal)
+template<typename Policy>
+size_t BasicAStarSolver<Policy>::copy_path(span<PathPoint> points) const noexcept
 {
-    SucessorsType neighbours;
-    OpenType open_list;
-    ClosedType closed_list(50, hash_func, equal_func);
+    const size_t length = path_length();
+    if (length > points.size()) {
+        return length;
+    }
 
-    open_list.push_back(start);
-    make_heap(open_list.begin(), open_list.end(), heap_comparator);
+    for (size_t i = 0; i < length; ++i) {
+        const auto cell = static_cast<int>(m_path[length - 1 - i]);
+        points[i] = { cell / m_columns, cell % m_columns };
+    }
+    return length;
+}
 
-    while (open_list.size() > 0) {
-        // Get the top element from the Open list
-        auto current = open_list.front();
-        assert(current != nullptr);
+/**
+ * Sets up the search state on the first step, once the map to search is known.
+ */
+template<typename Policy>
+template<typename Grid, typename Observer>
+void BasicAStarSolver<Policy>::begin(const Grid& grid, Observer& observer)
+{
+    m_pending = false;
+    m_rows = grid.rows();
+    m_columns = grid.columns();
+    m_context.prepare(static_cast<size_t>(m_rows) * m_columns);
+    m_stats = {};
+
+    const uint32_t start_index = static_cast<uint32_t>(m_start_row * m_columns + m_start_col);
+    m_goal_index = static_cast<uint32_t>(m_goal_row * m_columns + m_goal_col);
+
+    const Cost start_key = Policy::TieBreaking::key(Cost{}, estimate(m_start_row, m_start_col));
+    m_context.open(start_index, Cost{}, Context::no_parent);
+    m_context.open_list().push(start_index, start_key);
+    observer.on_push(m_start_row, m_start_col, start_key * Policy::Cost::scale);
+    ++m_stats.pushes;
+
+    m_closest = start_index;
+    m_closest_estimate = estimate(m_start_row, m_start_col);
+
+    // otherwise everything reachable from the start would be flooded before giving up
+    if (!grid.connected(m_start_row, m_start_col, m_goal_row, m_goal_col)) {
+        m_status = SearchStatus::NOT_FOUND;
+    }
+}
 
-        pop_heap(open_list.begin(), open_list.end(), heap_comparator);
-        open_list.pop_back();
-        closed_list.insert(current);
+/**
+ * The search itself, shared between live maps and snapshots.
+ */
+template<typename Policy>
+template<typename Grid, typename Observer>
+SearchStatus BasicAStarSolver<Policy>::advance(const Grid& grid, size_t max_expansions, Observer& observer)
+{
+    if (m_status != SearchStatus::RUNNING) {
+        return m_status;
+    }
 
-        m_map.visit(current->row(), current->col());
+    SearchTimer timer(m_stats.elapsed);
+    if (m_pending) {
+        begin(grid, observer);
+        if (m_status != SearchStatus::RUNNING) {
+            return m_status;
+        }
+    }
+    else if (grid.rows() != m_rows || grid.columns() != m_columns) {
+        // the map was replaced between two steps, the search state does not fit it anymore
+        m_status = SearchStatus::CANCELLED;
+        return m_status;
+    }
 
-#ifdef DEBUG_ASTAR_SOLVER
-        current->write_contents();
-        write_data("OPEN", open_list);
-        write_data("CLOSED", closed_list);
-#endif // DEBUG_ASTAR_SOLVER
+    const int columns = m_columns;
+    auto& open_list = m_context.open_list();
 
-        // have we found our destination?
-        if (*current == *goal) {
-            return current;
+    for (size_t expanded = 0; expanded < max_expansions; ) {
+        if (open_list.empty()) {
+            m_status = SearchStatus::NOT_FOUND;
+            break;
         }
-        else {
-            // no, then keep on searching
-            sucessors(current, *goal, neighbours);
+        if (m_stop.stop_requested()) {
+            m_status = SearchStatus::CANCELLED;
+            break;
+        }
+
+        m_stats.peak_open = max(m_stats.peak_open, open_list.size());
 
+        // Get the top element from the Open list
+        const uint32_t current = static_cast<uint32_t>(open_list.pop());
+        const int row = current / columns;
+        const int col = current % columns;
+        ++m_stats.pops;
 
-            while (neighbours.size() > 0) {
-                auto next_node = neighbours.back();
-                neighbours.pop_back();
+        m_context.close(current);
+        observer.on_close(row, col);
 
-                auto search_closed = closed_list.find(next_node);
-                if (search_closed != closed_list.end()) {
-                    continue;
-                }
+        // have we found our destination?
+        if (current == m_goal_index) {
+            trace(current);
+            m_status = SearchStatus::FOUND;
+            break;
+        }
 
+        // no, then keep on searching
+        const Cost remaining = estimate(row, col);
+        if (remaining < m_closest_estimate) {
+            m_closest = current;
+            m_closest_estimate = remaining;
+        }
 
-                const double cost = current->cost() + movement_cost(*current, *next_node);
+        const Cost current_cost = m_context.cost(current);
+        ++expanded;
+        ++m_stats.expansions;
+        observer.on_expand(row, col, current_cost * Policy::Cost::scale);
 
-                auto openFound = std::find_if(std::begin(open_list), std::end(open_list), [current](const NodePtr succ) noexcept {
-                    return *current == *succ;
-                    });
-                if (openFound != std::end(open_list)) {
-                    auto n = (*openFound);
-                    if (cost < n->cost()) {
-                        n->set_cost(cost);
-                        make_heap(std::begin(open_list), std::end(open_list), heap_comparator); // need to rebalance the queue
-                    }
-                }
-                else {
-                    next_node->set_cost(cost);
-                    open_list.push_back(next_node);
-                    push_heap(std::begin(open_list), std::end(open_list), heap_comparator);
+        Policy::Moves::neighbours(grid, row, col, [&](int next_row, int next_col, bool diagonal) {
+            const uint32_t next_node = static_cast<uint32_t>(next_row * columns + next_col);
+            const auto state = m_context.state(next_node);
+            if (state == Context::CellState::CLOSED) {
+                return;
+            }
+
+            const Cost cost = current_cost + (diagonal ? Policy::Cost::diagonal : Policy::Cost::straight);
+
+            if (state == Context::CellState::OPEN) {
+                if (cost < m_context.cost(next_node)) {
+                    // cheaper way to reach an already queued node
+                    const Cost key = Policy::TieBreaking::key(cost, estimate(next_row, next_col));
+                    m_context.update(next_node, cost, current);
+                    open_list.decrease_key(next_node, key);
+                    observer.on_decrease_key(next_row, next_col, key * Policy::Cost::scale);
+                    ++m_stats.decrease_keys;
                 }
             }
-        }
+            else {
+                const Cost key = Policy::TieBreaking::key(cost, estimate(next_row, next_col));
+                m_context.open(next_node, cost, current);
+                open_list.push(next_node, key);
+                observer.on_push(next_row, next_col, key * Policy::Cost::scale);
+                ++m_stats.pushes;
+            }
+        });
     }
 
-    return nullptr;
+    return m_status;
 }
 
 
 /**
- * Searches all the sucessor nodes from the current state.
- * @param current the node to generate the sucessors
- * @param goal the end position that we want to reach
- * @param neighbours the list of valid sucessor nodes. It is the caller's responsability
- * to delete them.
+ * Follows the parent links stored on the search context, from the given cell back to the start.
+ * @param goal the cell where the search ended.
  */
-void AStarSolver::sucessors(NodePtr current, const Node& goal, vector<NodePtr>& neighbours)
+template<typename Policy>
+void BasicAStarSolver<Policy>::trace(uint32_t goal)
 {
-    const int col_min = max(current->col() - 1, 0);
-    const int col_max = min(current->col() + 2, m_map.columns() - 1);
-
-    const int row_min = max(current->row() - 1, 0);
-    const int row_max = min(current->row() + 2, m_map.rows() - 1);
-
-    for (int row = row_min; row < row_max; ++row) {
-        for (int col = col_min; col < col_max; ++col) {
-            // avoid using the current node or crossing walls
-            if (!(row == current->row() && col == current->col()) &&
-                (m_map.at(row, col) != Map::CellType::BLOCKED)) {
-
-                auto neighbour = make_shared<Node>(row, col);
-
-                neighbour->set_parent(current);
-                neighbour->set_estimation(estimate(*current, goal));
-                neighbours.push_back(std::move(neighbour));
-            }
-        }
+    m_path.clear();
+    for (uint32_t cell = goal; cell != Context::no_parent; cell = m_context.parent(cell)) {
+        m_path.push_back(cell);
     }
 }
 
 /**
- * Cost function for reaching the current state
+ * Converts the traced cells into a chain of nodes.
+ * @return the node for the last cell traced, the start node ends the chain.
  */
-double AStarSolver::movement_cost(const Node& from, const Node& to) const noexcept
+template<typename Policy>
+typename BasicAStarSolver<Policy>::NodePtr BasicAStarSolver<Policy>::build_path()
 {
-    // make the diagonals cost a bit more than horizontal/vertical deplacements
-    const double dx = abs(from.col() - to.col());
-    const double dy = abs(from.row() - to.row());
-    return (dx + dy) < 2.0 ? 1.0 : 1.5;
-}
+    // the last entry is the start cell itself
+    NodePtr current = m_start != nullptr ? m_start : make_shared<Node>(m_start_row, m_start_col);
+    current->set_cost(0.0);
+    current->set_estimation(estimate(m_start_row, m_start_col) * Policy::Cost::scale);
+    current->set_parent(nullptr);
+
+    for (auto cell = m_path.rbegin() + 1; cell != m_path.rend(); ++cell) {
+        const int row = static_cast<int>(*cell) / m_columns;
+        const int col = static_cast<int>(*cell) % m_columns;
+
+        auto node = make_shared<Node>(row, col);
+        node->set_cost(m_context.cost(*cell) * Policy::Cost::scale);
+        node->set_estimation(estimate(row, col) * Policy::Cost::scale);
+        node->set_parent(current);
+        current = std::move(node);
+    }
 
+    return current;
+}
 
 /**
  * Heuristic function
  */
-double AStarSolver::estimate(const Node& current, const Node& goal) const noexcept
+template<typename Policy>
+typename BasicAStarSolver<Policy>::Cost BasicAStarSolver<Policy>::estimate(int row, int col) const noexcept
 {
-    // estimate using Manhattan distance with diagonals
-    const double dx = abs(current.col() - goal.col());
-    const double dy = abs(current.row() - goal.row());
-    return sqrt(dx * dx + dy * dy);
+    return Policy::Heuristic::template estimate<typename Policy::Cost>(abs(col - m_goal_col), abs(row - m_goal_row));
 }
+
+// the common combinations are compiled once here, instead of by every user
+template class AStarLib::BasicAStarSolver<SearchPolicy<>>;
+template class AStarLib::BasicAStarSolver<SearchPolicy<OctileHeuristic, StandardCost, EightConnected, PreferDeeper>>;
+template class AStarLib::BasicAStarSolver<SearchPolicy<ManhattanHeuristic, StandardCost, FourConnected, PreferDeeper>>;
+template class AStarLib::BasicAStarSolver<SearchPolicy<ZeroHeuristic>>;
+template class AStarLib::BasicAStarSolver<SearchPolicy<OctileHeuristic, IntegerCost>>;
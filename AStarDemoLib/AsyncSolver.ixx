@@ -0,0 +1,265 @@
+/* AsyncSolver.ixx - Searches awaited from coroutines
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+export module AsyncSolver;
+
+import <cassert>;
+import <concepts>;
+import <coroutine>;
+import <cstddef>;
+import <exception>;
+import <functional>;
+import <limits>;
+import <memory>;
+import <stop_token>;
+import <utility>;
+import <vector>;
+
+import Map;
+import Path;
+import SearchContext;
+import SearchObserver;
+import ThreadPool;
+import AStarSolver;
+
+export namespace AStarLib {
+
+    /**
+     * Types that can run the searches of an AsyncSolver, a ThreadPool or anything with
+     * the same submit(). Tasks must be given the index of the worker running them, below
+     * size(), and a worker must run one task at a time.
+     */
+    export template<typename T>
+    concept SearchExecutor = requires(T& executor, ThreadPool::Task task, TaskPriority priority) {
+        { executor.size() } -> std::convertible_to<std::size_t>;
+        executor.submit(std::move(task), priority);
+    };
+
+    /**
+     * How an asynchronous search ended, the path is empty unless it was FOUND.
+     */
+    export struct AsyncResult {
+        SearchStatus status = SearchStatus::CANCELLED;
+        Path path;
+    };
+
+    /**
+     * Runs searches on an executor and hands their paths back to coroutines:
+     *
+     *     const auto result = co_await solver.find_async(map, { 1, 1 }, { 8, 8 });
+     *
+     * Every worker of the executor gets its own AStarSolver, kept between searches, so
+     * there is no thread per query and the searches only allocate the returned path.
+     * Searches of one AsyncSolver can be started from any thread at the same time.
+     *
+     * The awaiting coroutine is resumed on the worker that ran the search, callers that
+     * need to be back on their own thread, like a UI, have to switch back themselves.
+     * Stopping the given token cancels a search still queued or running, and a search
+     * stopped before being awaited does not reach the executor at all. An observer given
+     * to find_async() is called from the worker as well.
+     *
+     * The solver and its executor must outlive the searches started on them.
+     */
+    export class AsyncSolver final
+    {
+    public:
+        /**
+         * Awaitable returned by find_async(), the search is queued when it is awaited.
+         */
+        class FindOperation final
+        {
+        public:
+            FindOperation(const FindOperation&) = delete;
+            FindOperation& operator=(const FindOperation&) = delete;
+
+            bool await_ready() const noexcept { return m_stop.stop_requested(); }
+            void await_suspend(std::coroutine_handle<> caller);
+            AsyncResult await_resume();
+
+        private:
+            friend class AsyncSolver;
+
+            using Step = std::function<SearchStatus(AStarSolver&)>;
+
+            FindOperation(AsyncSolver& solver, std::shared_ptr<const MapSnapshot> snapshot, PathPoint start, PathPoint goal,
+                TaskPriority priority, std::stop_token stop, Step step = {}) noexcept;
+
+            AsyncSolver& m_solver;
+            std::shared_ptr<const MapSnapshot> m_snapshot;
+            PathPoint m_start;
+            PathPoint m_goal;
+            TaskPriority m_priority;
+            std::stop_token m_stop;
+            Step m_step;
+            AsyncResult m_result;
+            std::exception_ptr m_error;
+        };
+
+        AsyncSolver();
+
+        /**
+         * @brief Constructs a solver running its searches on the given executor.
+         * @param executor the workers to use, it must outlive the solver
+         */
+        template<SearchExecutor Executor>
+        explicit AsyncSolver(Executor& executor) :
+            m_submit([&executor](ThreadPool::Task task, TaskPriority priority) { executor.submit(std::move(task), priority); }),
+            m_solvers(static_cast<std::size_t>(executor.size()))
+        {
+        }
+
+        AsyncSolver(const AsyncSolver&) = delete;
+        AsyncSolver& operator=(const AsyncSolver&) = delete;
+
+        FindOperation find_async(const Map& map, PathPoint start, PathPoint goal,
+            TaskPriority priority = TaskPriority::INTERACTIVE, std::stop_token stop = {});
+        FindOperation find_async(std::shared_ptr<const MapSnapshot> snapshot, PathPoint start, PathPoint goal,
+            TaskPriority priority = TaskPriority::INTERACTIVE, std::stop_token stop = {});
+
+        template<SearchObserver Observer>
+        FindOperation find_async(const Map& map, PathPoint start, PathPoint goal, Observer& observer,
+            TaskPriority priority = TaskPriority::INTERACTIVE, std::stop_token stop = {});
+
+    private:
+        std::function<void(ThreadPool::Task, TaskPriority)> m_submit;
+
+        // created by each worker on its first search, only ever touched by that worker
+        std::vector<std::unique_ptr<AStarSolver>> m_solvers;
+
+        void run(std::size_t worker, FindOperation& operation);
+    };
+}
+
+// make the standard C++ library available on the local namespace
+using namespace std;
+
+// also to reduce typing
+using namespace AStarLib;
+
+
+/**
+ * @brief Prepares a search against the current contents of the map, reporting its progress.
+ * @param map the map to search on, later changes to it are not seen by the search
+ * @param start where to start searching from
+ * @param goal the target destination
+ * @param observer told about the search from the worker running it, it must outlive the search
+ * @param priority the executor lane, background searches wait for the interactive ones
+ * @param stop cancels the search when requested
+ */
+template<SearchObserver Observer>
+AsyncSolver::FindOperation AsyncSolver::find_async(const Map& map, PathPoint start, PathPoint goal, Observer& observer, TaskPriority priority, stop_token stop)
+{
+    return FindOperation(*this, map.snapshot(), start, goal, priority, std::move(stop), [&observer](AStarSolver& solver) {
+        return solver.step(numeric_limits<size_t>::max(), observer);
+    });
+}
+
+/**
+ * @brief Constructs a solver running its searches on the process wide thread pool.
+ */
+AsyncSolver::AsyncSolver() : AsyncSolver(ThreadPool::default_pool())
+{
+}
+
+/**
+ * @brief Prepares a search against the current contents of the map, to be co_awaited.
+ * @param map the map to search on, later changes to it are not seen by the search
+ * @param start where to start searching from
+ * @param goal the target destination
+ * @param priority the executor lane, background searches wait for the interactive ones
+ * @param stop cancels the search when requested
+ */
+AsyncSolver::FindOperation AsyncSolver::find_async(const Map& map, PathPoint start, PathPoint goal, TaskPriority priority, stop_token stop)
+{
+    return find_async(map.snapshot(), start, goal, priority, std::move(stop));
+}
+
+/**
+ * @brief Prepares a search against a snapshot, to be co_awaited.
+ * @param snapshot the map contents to search on
+ * @param start where to start searching from
+ * @param goal the target destination
+ * @param priority the executor lane, background searches wait for the interactive ones
+ * @param stop cancels the search when requested
+ */
+AsyncSolver::FindOperation AsyncSolver::find_async(shared_ptr<const MapSnapshot> snapshot, PathPoint start, PathPoint goal, TaskPriority priority, stop_token stop)
+{
+    assert(snapshot != nullptr);
+    return FindOperation(*this, std::move(snapshot), start, goal, priority, std::move(stop));
+}
+
+/**
+ * @brief Searches on the worker the operation was given to.
+ */
+void AsyncSolver::run(size_t worker, FindOperation& operation)
+{
+    assert(worker < m_solvers.size());
+
+    // cancelled while waiting on the queue
+    if (operation.m_stop.stop_requested()) {
+        return;
+    }
+
+    auto& solver = m_solvers[worker];
+    if (solver == nullptr) {
+        solver = make_unique<AStarSolver>(operation.m_snapshot);
+    }
+    else {
+        solver->attach(operation.m_snapshot);
+    }
+
+    solver->start(operation.m_start.row, operation.m_start.col, operation.m_goal.row, operation.m_goal.col, operation.m_stop);
+    operation.m_result.status = operation.m_step ? operation.m_step(*solver) : solver->step(numeric_limits<size_t>::max());
+    solver->copy_path(operation.m_result.path);
+}
+
+AsyncSolver::FindOperation::FindOperation(AsyncSolver& solver, shared_ptr<const MapSnapshot> snapshot, PathPoint start, PathPoint goal,
+    TaskPriority priority, stop_token stop, Step step) noexcept :
+    m_solver(solver), m_snapshot(std::move(snapshot)), m_start(start), m_goal(goal), m_priority(priority), m_stop(std::move(stop)),
+    m_step(std::move(step))
+{
+}
+
+/**
+ * @brief Queues the search, the caller is resumed once it is over.
+ */
+void AsyncSolver::FindOperation::await_suspend(coroutine_handle<> caller)
+{
+    m_solver.m_submit([this, caller](size_t worker) {
+        try {
+            m_solver.run(worker, *this);
+        }
+        catch (...) {
+            m_error = current_exception();
+        }
+
+        // the operation lives on the caller's frame, which may be gone after this
+        caller.resume();
+    }, m_priority);
+}
+
+/**
+ * @brief The outcome of the search, an exception thrown by it is rethrown here.
+ */
+AsyncResult AsyncSolver::FindOperation::await_resume()
+{
+    if (m_error) {
+        rethrow_exception(m_error);
+    }
+    return std::move(m_result);
+}
@@ -0,0 +1,132 @@
+/* BatchSolver.ixx - Solves many path queries in parallel
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+export module BatchSolver;
+
+import <cassert>;
+import <cstddef>;
+import <memory>;
+import <span>;
+import <vector>;
+
+import Node;
+import Map;
+import ThreadPool;
+import AStarSolver;
+
+export namespace AStarLib {
+
+    /**
+     * A single path request of a batch.
+     */
+    export struct PathQuery {
+        Node start;
+        Node goal;
+    };
+
+    /**
+     * Solves batches of path queries against the same map, spreading them over
+     * the workers of a ThreadPool.
+     *
+     * Every worker gets its own AStarSolver, kept between batches, so after the
+     * first batch searching only allocates the returned paths. The searches read
+     * a snapshot of the map, which can keep being edited meanwhile.
+     *
+     * A BatchSolver solves one batch at a time, several batches can run
+     * concurrently by using one BatchSolver for each.
+     */
+    export class BatchSolver final
+    {
+    public:
+        using NodePtr = std::shared_ptr<Node>;
+
+        BatchSolver();
+        explicit BatchSolver(ThreadPool& pool);
+
+        void solve(const Map& map, std::span<const PathQuery> queries, std::span<NodePtr> results);
+        void solve(std::shared_ptr<const MapSnapshot> snapshot, std::span<const PathQuery> queries, std::span<NodePtr> results);
+
+    private:
+        ThreadPool& m_pool;
+        std::vector<AStarSolver> m_solvers;
+    };
+}
+
+// make the standard C++ library available on the local namespace
+using namespace std;
+
+// also to reduce typing
+using namespace AStarLib;
+
+
+/**
+ * @brief Constructs a batch solver running on the process wide thread pool.
+ */
+BatchSolver::BatchSolver() : BatchSolver(ThreadPool::default_pool())
+{
+}
+
+/**
+ * @brief Constructs a batch solver running on the given thread pool.
+ * @param pool the workers to use, it must outlive the solver
+ */
+BatchSolver::BatchSolver(ThreadPool& pool) : m_pool(pool)
+{
+}
+
+/**
+ * @brief Solves all queries against the current contents of the map.
+ * @param map the map to search on, it is not modified
+ * @param queries the start and goal of each search
+ * @param results receives the reversed path of each query, null when there is none
+ */
+void BatchSolver::solve(const Map& map, span<const PathQuery> queries, span<NodePtr> results)
+{
+    solve(map.snapshot(), queries, results);
+}
+
+/**
+ * @brief Solves all queries against the given snapshot, returning once all are done.
+ * @param snapshot the map contents to search on
+ * @param queries the start and goal of each search
+ * @param results receives the reversed path of each query, null when there is none,
+ * it must be at least as large as queries
+ */
+void BatchSolver::solve(shared_ptr<const MapSnapshot> snapshot, span<const PathQuery> queries, span<NodePtr> results)
+{
+    assert(snapshot != nullptr);
+    assert(results.size() >= queries.size());
+
+    if (m_solvers.empty()) {
+        m_solvers.reserve(m_pool.size());
+        for (size_t i = 0; i < m_pool.size(); ++i) {
+            m_solvers.emplace_back(snapshot);
+        }
+    }
+    else {
+        for (auto& solver : m_solvers) {
+            solver.attach(snapshot);
+        }
+    }
+
+    m_pool.parallel_for(queries.size(), [this, queries, results](size_t worker, size_t index) {
+        const auto& query = queries[index];
+        results[index] = m_solvers[worker].find(make_shared<Node>(query.start.row(), query.start.col()),
+            make_shared<Node>(query.goal.row(), query.goal.col()));
+    });
+}
@@ -0,0 +1,339 @@
+/* BidirectionalSolver.ixx - A* searching from both ends of the path
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+export module BidirectionalSolver;
+
+import <memory>;
+import <vector>;
+import <algorithm>;
+import <string>;
+import <cassert>;
+import <cstddef>;
+import <cstdint>;
+import <cmath>;
+import <limits>;
+
+import Node;
+import Map;
+import OpenList;
+import SearchContext;
+import SearchObserver;
+import SearchPolicies;
+
+export namespace AStarLib {
+
+    /**
+     * Searchs for a path between two given points by running A* from both ends at once.
+     *
+     * One search moves forward from the start and the other backward from the goal,
+     * each one with the straight line distance to its own target as heuristic. Until
+     * they meet, the side with the smaller frontier is expanded. Afterwards the path
+     * found is only known to be optimal once the smallest key of either open list
+     * reaches its cost (Pohl, 1971), so the side closest to that bound is expanded.
+     * Cells that can't lead to a shorter path are not queued, and cells already
+     * settled by the other search are not expanded (Kwa, 1989).
+     *
+     * It pays off when a long wall sits between the start and the goal, where each
+     * search only floods its own side of it, instead of A* flooding both.
+     * Same threading rules as AStarSolver.
+     */
+    export class BidirectionalSolver
+    {
+    public:
+        using NodePtr = std::shared_ptr<Node>;
+        BidirectionalSolver(Map& map);
+        explicit BidirectionalSolver(std::shared_ptr<const MapSnapshot> snapshot);
+
+        NodePtr find(NodePtr start, NodePtr goal);
+
+        template<SearchObserver Observer>
+        NodePtr find(NodePtr start, NodePtr goal, Observer& observer);
+
+        const SearchStats& stats() const noexcept { return m_stats; }
+
+    private:
+        static constexpr double infinity = std::numeric_limits<double>::infinity();
+
+        Map* m_map;
+        std::shared_ptr<const MapSnapshot> m_snapshot;
+        SearchContext m_forward;
+        SearchContext m_backward;
+        SearchStats m_stats;
+        std::vector<std::uint32_t> m_path;
+
+        template<typename Grid, typename Observer>
+        NodePtr search(const Grid& grid, NodePtr start, NodePtr goal, Observer& observer);
+
+        template<typename Grid, typename Observer>
+        void expand(const Grid& grid, SearchContext& side, SearchContext& other, const Node& to,
+            double& best, std::uint32_t& meeting, Observer& observer);
+
+        double movement_cost(int from_row, int from_col, int to_row, int to_col) const noexcept;
+        double estimate(int row, int col, const Node& target) const noexcept;
+        NodePtr build_path(NodePtr start, std::uint32_t meeting, double cost, int columns, const Node& goal);
+    };
+}
+
+// make the standard C++ library available on the local namespace
+using namespace std;
+
+// also to reduce typing
+using namespace AStarLib;
+
+
+BidirectionalSolver::BidirectionalSolver(Map& map) : m_map(&map)
+{
+}
+
+/**
+ * @brief Constructs a solver that only reads the given snapshot.
+ * @param snapshot the map contents to search on
+ */
+BidirectionalSolver::BidirectionalSolver(shared_ptr<const MapSnapshot> snapshot) : m_map(nullptr), m_snapshot(std::move(snapshot))
+{
+    assert(m_snapshot != nullptr);
+}
+
+/**
+ * Bidirectional A* search function
+ *
+ * @param start where to start searching from
+ * @param goal   the target destination
+ * @return null if nothing was found, the reversed path otherwise, like AStarSolver::find.
+ */
+BidirectionalSolver::NodePtr BidirectionalSolver::find(NodePtr start, NodePtr goal)
+{
+    NullObserver observer;
+    return find(start, goal, observer);
+}
+
+/**
+ * Bidirectional A* search function, reporting the progress of both searches to the given observer.
+ *
+ * @param start where to start searching from
+ * @param goal   the target destination
+ * @param observer called on every open list change and expansion
+ * @return null if nothing was found, the reversed path otherwise, like AStarSolver::find.
+ */
+template<SearchObserver Observer>
+BidirectionalSolver::NodePtr BidirectionalSolver::find(NodePtr start, NodePtr goal, Observer& observer)
+{
+    if (m_map != nullptr) {
+        return search(*m_map, start, goal, observer);
+    }
+    else {
+        return search(*m_snapshot, start, goal, observer);
+    }
+}
+
+/**
+ * The search itself, shared between live maps and snapshots.
+ */
+template<typename Grid, typename Observer>
+BidirectionalSolver::NodePtr BidirectionalSolver::search(const Grid& grid, NodePtr start, NodePtr goal, Observer& observer)
+{
+    const int columns = grid.columns();
+    const auto cell_index = [columns](int row, int col) noexcept {
+        return static_cast<uint32_t>(row * columns + col);
+    };
+
+    const size_t cells = static_cast<size_t>(grid.rows()) * columns;
+    m_forward.prepare(cells);
+    m_backward.prepare(cells);
+    m_stats = {};
+    SearchTimer timer(m_stats.elapsed);
+
+    // otherwise both frontiers would flood everything they reach before giving up
+    if (!grid.connected(start->row(), start->col(), goal->row(), goal->col())) {
+        return nullptr;
+    }
+
+    const uint32_t start_index = cell_index(start->row(), start->col());
+    const uint32_t goal_index = cell_index(goal->row(), goal->col());
+
+    const double start_key = estimate(start->row(), start->col(), *goal);
+    m_forward.open(start_index, 0.0, SearchContext::no_parent);
+    m_forward.open_list().push(start_index, start_key);
+    observer.on_push(start->row(), start->col(), start_key);
+
+    const double goal_key = estimate(goal->row(), goal->col(), *start);
+    m_backward.open(goal_index, 0.0, SearchContext::no_parent);
+    m_backward.open_list().push(goal_index, goal_key);
+    observer.on_push(goal->row(), goal->col(), goal_key);
+    m_stats.pushes = 2;
+
+    double best = start_index == goal_index ? 0.0 : infinity;
+    uint32_t meeting = start_index;
+
+    auto& forward_open = m_forward.open_list();
+    auto& backward_open = m_backward.open_list();
+    while (!forward_open.empty() && !backward_open.empty()) {
+        // no path through the cells still queued can be shorter than the one already found
+        if (max(forward_open.key(forward_open.top()), backward_open.key(backward_open.top())) >= best) {
+            break;
+        }
+
+        m_stats.peak_open = max(m_stats.peak_open, forward_open.size() + backward_open.size());
+
+        // before meeting keep both frontiers small, afterwards push one key towards the bound
+        const bool forward = best == infinity ?
+            forward_open.size() <= backward_open.size() :
+            forward_open.key(forward_open.top()) >= backward_open.key(backward_open.top());
+        if (forward) {
+            expand(grid, m_forward, m_backward, *goal, best, meeting, observer);
+        }
+        else {
+            expand(grid, m_backward, m_forward, *start, best, meeting, observer);
+        }
+    }
+
+    if (best == infinity) {
+        return nullptr;
+    }
+    return build_path(start, meeting, best, columns, *goal);
+}
+
+/**
+ * Expands the top cell of one of the searches.
+ * @param side the search to expand
+ * @param other the search running in the opposite direction
+ * @param to where the expanded search is heading to
+ * @param best the cost of the shortest path found so far, updated when a shorter one is found
+ * @param meeting a cell on that path, reached by both searches
+ */
+template<typename Grid, typename Observer>
+void BidirectionalSolver::expand(const Grid& grid, SearchContext& side, SearchContext& other, const Node& to,
+    double& best, uint32_t& meeting, Observer& observer)
+{
+    const int columns = grid.columns();
+    auto& open_list = side.open_list();
+
+    const uint32_t current = static_cast<uint32_t>(open_list.pop());
+    const int row = current / columns;
+    const int col = current % columns;
+    side.close(current);
+    ++m_stats.pops;
+    observer.on_close(row, col);
+
+    // already settled by the other search, the best path through it is known (Kwa, 1989)
+    if (other.state(current) == SearchContext::CellState::CLOSED) {
+        return;
+    }
+
+    ++m_stats.expansions;
+    observer.on_expand(row, col, side.cost(current));
+
+    // the map border counts as a wall, so it is never on the mask
+    NeighbourMask::for_each(row, col, grid.neighbours(row, col), [&](int next_row, int next_col, bool) {
+        const uint32_t next = static_cast<uint32_t>(next_row * columns + next_col);
+        const auto state = side.state(next);
+        if (state == SearchContext::CellState::CLOSED) {
+            return;
+        }
+
+        const double cost = side.cost(current) + movement_cost(row, col, next_row, next_col);
+        const double key = cost + estimate(next_row, next_col, to);
+        if (key >= best) {
+            return;
+        }
+        if (state == SearchContext::CellState::OPEN) {
+            if (cost >= side.cost(next)) {
+                return;
+            }
+            side.update(next, cost, current);
+            open_list.decrease_key(next, key);
+            observer.on_decrease_key(next_row, next_col, key);
+            ++m_stats.decrease_keys;
+        }
+        else {
+            side.open(next, cost, current);
+            open_list.push(next, key);
+            observer.on_push(next_row, next_col, key);
+            ++m_stats.pushes;
+        }
+
+        // the moves are symmetric, so both halves join into a path
+        if (other.state(next) != SearchContext::CellState::UNSEEN && cost + other.cost(next) < best) {
+            best = cost + other.cost(next);
+            meeting = next;
+        }
+    });
+}
+
+/**
+ * Joins the forward search path to the meeting cell with the backward one from there.
+ * @param start the node where the search started, it becomes the end of the chain.
+ * @param meeting the cell where both searches met.
+ * @param cost the cost of the whole path.
+ * @param columns the width of the searched map.
+ * @param goal the goal node, used to fill in the estimations.
+ * @return the node for the goal cell.
+ */
+BidirectionalSolver::NodePtr BidirectionalSolver::build_path(NodePtr start, uint32_t meeting, double cost, int columns, const Node& goal)
+{
+    // the forward half, from the meeting cell back to the start
+    m_path.clear();
+    for (uint32_t cell = meeting; cell != SearchContext::no_parent; cell = m_forward.parent(cell)) {
+        m_path.push_back(cell);
+    }
+    reverse(m_path.begin(), m_path.end());
+    const size_t forward_cells = m_path.size();
+
+    // and the backward half, from the meeting cell on to the goal
+    if (m_backward.state(meeting) != SearchContext::CellState::UNSEEN) {
+        for (uint32_t cell = m_backward.parent(meeting); cell != SearchContext::no_parent; cell = m_backward.parent(cell)) {
+            m_path.push_back(cell);
+        }
+    }
+
+    // the first entry is the start cell itself
+    start->set_cost(0.0);
+    start->set_estimation(estimate(start->row(), start->col(), goal));
+    start->set_parent(nullptr);
+
+    NodePtr current = start;
+    for (size_t i = 1; i < m_path.size(); ++i) {
+        const uint32_t cell = m_path[i];
+        const int row = cell / columns;
+        const int col = cell % columns;
+
+        auto node = make_shared<Node>(row, col);
+        node->set_cost(i < forward_cells ? m_forward.cost(cell) : cost - m_backward.cost(cell));
+        node->set_estimation(estimate(row, col, goal));
+        node->set_parent(current);
+        current = std::move(node);
+    }
+
+    return current;
+}
+
+/**
+ * Cost function for reaching the current state
+ */
+double BidirectionalSolver::movement_cost(int from_row, int from_col, int to_row, int to_col) const noexcept
+{
+    return (from_row != to_row && from_col != to_col) ? StandardCost::diagonal : StandardCost::straight;
+}
+
+/**
+ * Heuristic function, the same as AStarSolver, towards the end the search is heading to
+ */
+double BidirectionalSolver::estimate(int row, int col, const Node& target) const noexcept
+{
+    return EuclideanHeuristic::estimate<StandardCost>(abs(col - target.col()), abs(row - target.row()));
+}
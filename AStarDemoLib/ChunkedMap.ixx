@@ -0,0 +1,496 @@
+/* ChunkedMap.ixx - Map split in chunks that are paged in from disk on demand
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+export module ChunkedMap;
+
+import <algorithm>;
+import <array>;
+import <bit>;
+import <cassert>;
+import <condition_variable>;
+import <cstddef>;
+import <cstdint>;
+import <cstring>;
+import <deque>;
+import <filesystem>;
+import <fstream>;
+import <functional>;
+import <limits>;
+import <memory>;
+import <mutex>;
+import <span>;
+import <stdexcept>;
+import <thread>;
+import <unordered_set>;
+import <vector>;
+
+import Map;
+
+export namespace AStarLib {
+
+    /**
+     * Read-only map stored in a chunk file, for worlds that don't fit in memory.
+     *
+     * The world is split in chunks of chunk_size x chunk_size cells, each one kept as
+     * one bit per cell. Chunks are read from the file the first time they are needed,
+     * and once the memory budget is reached their slots are recycled with the clock
+     * algorithm, which only spares the chunks used since the hand last went by.
+     * at() and passable() behave as on Map, including the blocked border around the
+     * map, and can be called from several threads.
+     *
+     * Solvers can call prefetch() for cells they are about to reach, which queues the
+     * chunk to be read by a background thread, so the search does not wait on the disk.
+     */
+    export class ChunkedMap final
+    {
+    public:
+        using CellType = Map::CellType;
+        using ChunkWords = std::span<std::uint64_t, 64>;
+
+        static constexpr int chunk_size = 64;
+
+        static std::unique_ptr<ChunkedMap> open(const std::filesystem::path& path, std::size_t memory_budget = std::size_t{ 64 } << 20);
+
+        ~ChunkedMap();
+
+        ChunkedMap(const ChunkedMap&) = delete;
+        ChunkedMap& operator=(const ChunkedMap&) = delete;
+
+        int rows() const noexcept { return m_rows; }
+
+        int columns() const noexcept { return m_cols; }
+
+        CellType at(int row, int col) const {
+            if (row < 0 || row >= m_rows || col < 0 || col >= m_cols) {
+                throw std::out_of_range("map position out of range");
+            }
+            return passable(row, col) ? CellType::FREE : CellType::BLOCKED;
+        }
+
+        bool passable(int row, int col) const;
+
+        void prefetch(int row, int col) const;
+
+        std::size_t chunk_count() const noexcept { return m_chunk_slot.size(); }
+
+        std::size_t capacity() const noexcept { return m_slots.size(); }
+
+        std::size_t resident_chunks() const;
+
+        std::size_t loads() const;
+
+        std::size_t evictions() const;
+
+    private:
+        struct alignas(64) Chunk {
+            std::array<std::uint64_t, chunk_size> words;
+        };
+
+        static constexpr std::uint32_t no_slot = std::numeric_limits<std::uint32_t>::max();
+        static constexpr std::size_t no_chunk = std::numeric_limits<std::size_t>::max();
+        static constexpr std::size_t max_pending = 256;
+
+        int m_rows;
+        int m_cols;
+        int m_chunk_cols;
+        std::uint64_t m_data_offset;
+
+        mutable std::mutex m_lock;
+        mutable std::mutex m_file_lock;
+        mutable std::ifstream m_file;
+        mutable std::vector<Chunk> m_slots;
+        mutable std::vector<std::size_t> m_slot_chunk;
+        mutable std::vector<bool> m_referenced;
+        mutable std::vector<std::uint32_t> m_chunk_slot;
+        mutable std::size_t m_hand;
+        mutable std::size_t m_resident;
+        mutable std::size_t m_loads;
+        mutable std::size_t m_evictions;
+
+        // requests for the prefetch thread
+        mutable std::deque<std::size_t> m_pending;
+        mutable std::unordered_set<std::size_t> m_queued;
+        mutable std::condition_variable m_wake;
+        std::filesystem::path m_path;
+        bool m_stop;
+        std::thread m_loader;
+
+        ChunkedMap(const std::filesystem::path& path, int rows, int cols, std::uint64_t data_offset, std::size_t memory_budget);
+
+        std::size_t chunk_index(int row, int col) const noexcept {
+            return static_cast<std::size_t>(row / chunk_size) * m_chunk_cols + static_cast<std::size_t>(col / chunk_size);
+        }
+
+        std::uint64_t chunk_offset(std::size_t chunk) const noexcept {
+            return m_data_offset + chunk * sizeof(Chunk);
+        }
+
+        Chunk read(std::size_t chunk) const;
+        std::uint32_t insert(std::size_t chunk, const Chunk& contents) const;
+        void load_pending();
+    };
+
+    bool write_chunked_map(const std::filesystem::path& path, int rows, int cols,
+        const std::function<void(int first_row, int first_col, ChunkedMap::ChunkWords words)>& fill);
+
+    bool save_chunked_map(const Map& map, const std::filesystem::path& path);
+}
+
+// make the standard C++ library available on the local namespace
+using namespace std;
+
+// also to reduce typing
+using namespace AStarLib;
+
+namespace {
+    constexpr char chunk_magic[8] = { 'A', 'S', 't', 'a', 'r', 'c', 'h', 'k' };
+    constexpr uint32_t chunk_format_version = 1;
+
+    /**
+     * Layout of the chunk file header, all fields are little endian.
+     * The chunks follow it row-major, as chunk_size words of chunk_size bits each.
+     */
+    struct ChunkFileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t header_size;
+        int32_t rows;
+        int32_t cols;
+        uint32_t chunk_size;
+        uint32_t reserved;
+        uint64_t data_offset;
+        uint64_t padding[3];
+    };
+    static_assert(sizeof(ChunkFileHeader) == 64);
+
+    size_t chunks_along(int cells) noexcept
+    {
+        return (static_cast<size_t>(cells) + ChunkedMap::chunk_size - 1) / ChunkedMap::chunk_size;
+    }
+}
+
+/**
+ * @brief Opens a chunk file, without reading any of its chunks yet.
+ * @param path the file written by write_chunked_map().
+ * @param memory_budget how many bytes the resident chunks may take, at least a few chunks are always kept.
+ * @return null if the file could not be opened or is not a chunk file.
+ */
+unique_ptr<ChunkedMap> ChunkedMap::open(const filesystem::path& path, size_t memory_budget)
+{
+    if constexpr (endian::native != endian::little) {
+        return nullptr;
+    }
+
+    ifstream file(path, ios::binary);
+    ChunkFileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        return nullptr;
+    }
+
+    if (memcmp(header.magic, chunk_magic, sizeof(chunk_magic)) != 0 || header.version != chunk_format_version
+        || header.header_size != sizeof(header) || header.chunk_size != chunk_size
+        || header.rows <= 0 || header.cols <= 0) {
+        return nullptr;
+    }
+
+    error_code error;
+    const auto size = filesystem::file_size(path, error);
+    const auto chunks = static_cast<uint64_t>(chunks_along(header.rows)) * chunks_along(header.cols);
+    if (error || header.data_offset < sizeof(header) || size < header.data_offset || (size - header.data_offset) / sizeof(Chunk) < chunks) {
+        return nullptr;
+    }
+
+    return unique_ptr<ChunkedMap>(new ChunkedMap(path, header.rows, header.cols, header.data_offset, memory_budget));
+}
+
+/**
+ * @brief Sets up the chunk cache and starts the prefetch thread.
+ */
+ChunkedMap::ChunkedMap(const filesystem::path& path, int rows, int cols, uint64_t data_offset, size_t memory_budget) :
+    m_rows{ rows }, m_cols{ cols }, m_chunk_cols{ static_cast<int>(chunks_along(cols)) }, m_data_offset{ data_offset },
+    m_file(path, ios::binary), m_hand{ 0 }, m_resident{ 0 }, m_loads{ 0 }, m_evictions{ 0 }, m_path(path), m_stop{ false }
+{
+    // a search looking around a chunk corner touches four chunks at once
+    const size_t chunks = chunks_along(rows) * chunks_along(cols);
+    const size_t slots = min(max(memory_budget / sizeof(Chunk), size_t{ 4 }), chunks);
+
+    m_slots.resize(slots);
+    m_slot_chunk.assign(slots, no_chunk);
+    m_referenced.assign(slots, false);
+    m_chunk_slot.assign(chunks, no_slot);
+
+    m_loader = thread([this] { load_pending(); });
+}
+
+/**
+ * @brief Stops the prefetch thread, dropping the requests it did not get to.
+ */
+ChunkedMap::~ChunkedMap()
+{
+    {
+        lock_guard guard(m_lock);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    m_loader.join();
+}
+
+/**
+ * @brief Check if a cell can be walked on, with the same border rules as Map::passable.
+ * Reads the chunk from the file when it is not resident.
+ */
+bool ChunkedMap::passable(int row, int col) const
+{
+    assert(row >= -1 && row <= m_rows && col >= -1 && col <= m_cols);
+    if (row < 0 || row >= m_rows || col < 0 || col >= m_cols) {
+        return false;
+    }
+
+    const auto chunk = chunk_index(row, col);
+    const auto bit = [row, col](const Chunk& contents) -> bool {
+        return (contents.words[row % chunk_size] >> (col % chunk_size)) & 1;
+    };
+
+    {
+        lock_guard guard(m_lock);
+        if (const auto slot = m_chunk_slot[chunk]; slot != no_slot) {
+            m_referenced[slot] = true;
+            return bit(m_slots[slot]);
+        }
+    }
+
+    // searches on resident chunks don't wait for the disk
+    const auto contents = read(chunk);
+
+    lock_guard guard(m_lock);
+    // another search, or the prefetch thread, might have read it in the meantime
+    if (m_chunk_slot[chunk] == no_slot) {
+        insert(chunk, contents);
+    }
+    return bit(contents);
+}
+
+/**
+ * @brief Hints that the cell is going to be looked at soon.
+ * When its chunk is not resident, it gets read by the prefetch thread. The hint
+ * is dropped if too many are already waiting.
+ */
+void ChunkedMap::prefetch(int row, int col) const
+{
+    if (row < 0 || row >= m_rows || col < 0 || col >= m_cols) {
+        return;
+    }
+
+    const auto chunk = chunk_index(row, col);
+    {
+        lock_guard guard(m_lock);
+        if (m_chunk_slot[chunk] != no_slot || m_pending.size() >= max_pending || !m_queued.insert(chunk).second) {
+            return;
+        }
+        m_pending.push_back(chunk);
+    }
+    m_wake.notify_one();
+}
+
+/**
+ * @brief How many chunks are currently in memory.
+ */
+size_t ChunkedMap::resident_chunks() const
+{
+    lock_guard guard(m_lock);
+    return m_resident;
+}
+
+/**
+ * @brief How many times a chunk was read from the file, including prefetches.
+ */
+size_t ChunkedMap::loads() const
+{
+    lock_guard guard(m_lock);
+    return m_loads;
+}
+
+/**
+ * @brief How many times a chunk was dropped to make room for another one.
+ */
+size_t ChunkedMap::evictions() const
+{
+    lock_guard guard(m_lock);
+    return m_evictions;
+}
+
+/**
+ * @brief Reads a chunk from the file, without making it resident.
+ * Must be called without m_lock held.
+ */
+ChunkedMap::Chunk ChunkedMap::read(size_t chunk) const
+{
+    Chunk contents;
+
+    lock_guard guard(m_file_lock);
+    m_file.clear();
+    m_file.seekg(static_cast<streamoff>(chunk_offset(chunk)));
+    if (!m_file.read(reinterpret_cast<char*>(contents.words.data()), sizeof(contents.words))) {
+        throw runtime_error("could not read map chunk");
+    }
+    return contents;
+}
+
+/**
+ * @brief Makes a chunk resident, evicting the one the clock hand stops at if there is no room.
+ * The slots are recycled with the clock algorithm, where each access marks its slot as
+ * referenced and the hand skips, and clears, referenced slots once.
+ * Must be called with m_lock held.
+ * @return the slot now holding the chunk.
+ */
+uint32_t ChunkedMap::insert(size_t chunk, const Chunk& contents) const
+{
+    ++m_loads;
+
+    while (m_referenced[m_hand]) {
+        m_referenced[m_hand] = false;
+        m_hand = (m_hand + 1) % m_slots.size();
+    }
+
+    const auto slot = static_cast<uint32_t>(m_hand);
+    m_hand = (m_hand + 1) % m_slots.size();
+
+    if (m_slot_chunk[slot] != no_chunk) {
+        m_chunk_slot[m_slot_chunk[slot]] = no_slot;
+        ++m_evictions;
+    }
+    else {
+        ++m_resident;
+    }
+
+    m_slots[slot] = contents;
+    m_slot_chunk[slot] = chunk;
+    m_chunk_slot[chunk] = slot;
+    m_referenced[slot] = true;
+
+    return slot;
+}
+
+/**
+ * @brief Body of the prefetch thread, reads the queued chunks with its own file handle,
+ * so that the searches can keep on using the resident chunks meanwhile.
+ */
+void ChunkedMap::load_pending()
+{
+    ifstream file(m_path, ios::binary);
+    Chunk contents;
+
+    unique_lock guard(m_lock);
+    while (true) {
+        m_wake.wait(guard, [this] { return m_stop || !m_pending.empty(); });
+        if (m_stop) {
+            return;
+        }
+
+        const auto chunk = m_pending.front();
+        m_pending.pop_front();
+
+        guard.unlock();
+        file.clear();
+        file.seekg(static_cast<streamoff>(chunk_offset(chunk)));
+        const bool read = static_cast<bool>(file.read(reinterpret_cast<char*>(contents.words.data()), sizeof(contents.words)));
+        guard.lock();
+
+        m_queued.erase(chunk);
+        // a search might have needed it in the meantime
+        if (read && m_chunk_slot[chunk] == no_slot) {
+            insert(chunk, contents);
+        }
+    }
+}
+
+/**
+ * @brief Writes a chunk file one chunk at a time, so that the world never has to be in memory.
+ * @param path the file to write.
+ * @param rows the amount of map rows.
+ * @param cols the amount of map columns.
+ * @param fill called once per chunk, row-major, with the first cell of the chunk and its cleared words.
+ * Bit c of word r tells if the cell (first_row + r, first_col + c) is free. Bits for cells outside
+ * of the map are ignored.
+ * @return false if the file could not be written.
+ */
+bool AStarLib::write_chunked_map(const filesystem::path& path, int rows, int cols,
+    const function<void(int first_row, int first_col, ChunkedMap::ChunkWords words)>& fill)
+{
+    if constexpr (endian::native != endian::little) {
+        return false;
+    }
+
+    if (rows <= 0 || cols <= 0) {
+        return false;
+    }
+
+    ofstream file(path, ios::binary | ios::trunc);
+
+    ChunkFileHeader header{};
+    memcpy(header.magic, chunk_magic, sizeof(chunk_magic));
+    header.version = chunk_format_version;
+    header.header_size = sizeof(header);
+    header.rows = rows;
+    header.cols = cols;
+    header.chunk_size = ChunkedMap::chunk_size;
+    header.data_offset = sizeof(header);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    array<uint64_t, ChunkedMap::chunk_size> words;
+    for (int first_row = 0; first_row < rows && file; first_row += ChunkedMap::chunk_size) {
+        for (int first_col = 0; first_col < cols && file; first_col += ChunkedMap::chunk_size) {
+            words.fill(0);
+            fill(first_row, first_col, words);
+
+            // keep whatever lies outside of the map blocked
+            const int valid_rows = min(rows - first_row, ChunkedMap::chunk_size);
+            const int valid_cols = min(cols - first_col, ChunkedMap::chunk_size);
+            const uint64_t mask = valid_cols == 64 ? ~uint64_t{ 0 } : (uint64_t{ 1 } << valid_cols) - 1;
+            for (int row = 0; row < ChunkedMap::chunk_size; ++row) {
+                words[row] = row < valid_rows ? words[row] & mask : 0;
+            }
+
+            file.write(reinterpret_cast<const char*>(words.data()), sizeof(words));
+        }
+    }
+
+    return static_cast<bool>(file);
+}
+
+/**
+ * @brief Writes the passability of a map as a chunk file.
+ * @param map the map to save.
+ * @param path the file to write.
+ * @return false if the file could not be written.
+ */
+bool AStarLib::save_chunked_map(const Map& map, const filesystem::path& path)
+{
+    const auto snapshot = map.snapshot();
+    return write_chunked_map(path, snapshot->rows(), snapshot->columns(), [&](int first_row, int first_col, ChunkedMap::ChunkWords words) {
+        const int last_row = min(first_row + ChunkedMap::chunk_size, snapshot->rows());
+        const int last_col = min(first_col + ChunkedMap::chunk_size, snapshot->columns());
+        for (int row = first_row; row < last_row; ++row) {
+            for (int col = first_col; col < last_col; ++col) {
+                if (snapshot->passable(row, col)) {
+                    words[row - first_row] |= uint64_t{ 1 } << (col - first_col);
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,291 @@
+/* ChunkedSolver.ixx - A* solver for maps paged in from disk
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+export module ChunkedSolver;
+
+import <algorithm>;
+import <cmath>;
+import <cstddef>;
+import <cstdint>;
+import <functional>;
+import <limits>;
+import <memory>;
+import <unordered_map>;
+import <vector>;
+
+import Node;
+import ChunkedMap;
+import SearchContext;
+import SearchPolicies;
+
+export namespace AStarLib {
+
+    /**
+     * A* search over a ChunkedMap, with the same movement costs and heuristic as AStarSolver.
+     *
+     * AStarSolver keeps its scratch memory as arrays sized for the whole map, which is
+     * not an option for worlds that don't fit in memory themselves. This solver only keeps
+     * state for the cells it reaches, and hints the map about the chunks the frontier is
+     * about to enter, so that they get read while the search goes on.
+     *
+     * That state still grows with the area searched, which for an unreachable goal is
+     * everything connected to the start. Searches give up once they reached max_cells
+     * cells, with status() telling that apart from a goal known to be unreachable.
+     */
+    export class ChunkedSolver final
+    {
+    public:
+        using NodePtr = std::shared_ptr<Node>;
+
+        // how many cells away from a chunk edge the next chunk gets prefetched
+        static constexpr int prefetch_distance = 8;
+
+        // a hash map entry per cell, a little over a hundred MB
+        static constexpr std::size_t default_max_cells = std::size_t{ 1 } << 21;
+
+        explicit ChunkedSolver(const ChunkedMap& map, std::size_t max_cells = default_max_cells);
+
+        NodePtr find(NodePtr start, NodePtr goal);
+
+        /**
+         * How the last search ended, FOUND or NOT_FOUND, or RUNNING when it ran out of
+         * cells before it could tell.
+         */
+        SearchStatus status() const noexcept { return m_status; }
+
+        std::size_t max_cells() const noexcept { return m_max_cells; }
+
+        const SearchStats& stats() const noexcept { return m_stats; }
+
+    private:
+        static constexpr std::uint64_t no_parent = std::numeric_limits<std::uint64_t>::max();
+
+        struct Record {
+            double cost;
+            std::uint64_t parent;
+            bool closed;
+        };
+
+        struct Entry {
+            double key;
+            double cost;
+            std::uint64_t cell;
+
+            // the heap keeps the smallest key on top, preferring the deepest cell on ties
+            bool operator>(const Entry& other) const noexcept {
+                return key > other.key || (key == other.key && cost < other.cost);
+            }
+        };
+
+        const ChunkedMap& m_map;
+        std::size_t m_max_cells;
+        SearchStatus m_status;
+        std::unordered_map<std::uint64_t, Record> m_records;
+        std::vector<Entry> m_open;
+        SearchStats m_stats;
+
+        void prefetch_ahead(int row, int col) const;
+        NodePtr build_path(NodePtr start, std::uint64_t goal, const Node& target) const;
+
+        double movement_cost(int from_row, int from_col, int to_row, int to_col) const noexcept;
+        double estimate(int row, int col, const Node& goal) const noexcept;
+    };
+}
+
+// make the standard C++ library available on the local namespace
+using namespace std;
+
+// also to reduce typing
+using namespace AStarLib;
+
+/**
+ * @brief Constructs a solver for the given map.
+ * @param map the map to search on, it must outlive the solver
+ * @param max_cells how many cells a search may reach before giving up
+ */
+ChunkedSolver::ChunkedSolver(const ChunkedMap& map, size_t max_cells) :
+    m_map(map), m_max_cells{ max<size_t>(max_cells, 1) }, m_status{ SearchStatus::IDLE }
+{
+}
+
+/**
+ * A* search function
+ * Open cells may be queued more than once, the stale copies are skipped when popped.
+ * The search stops with no path once max_cells cells were reached, see status().
+ *
+ * @param start where to start searching from
+ * @param goal   the target destination
+ * @return null if nothing was found, the reversed path otherwise.
+ */
+ChunkedSolver::NodePtr ChunkedSolver::find(NodePtr start, NodePtr goal)
+{
+    const uint64_t columns = static_cast<uint64_t>(m_map.columns());
+    const auto cell_index = [columns](int row, int col) noexcept {
+        return static_cast<uint64_t>(row) * columns + static_cast<uint64_t>(col);
+    };
+
+    m_records.clear();
+    m_open.clear();
+    m_stats = {};
+    SearchTimer timer(m_stats.elapsed);
+
+    // a blocked end is answered without reading any more of the map
+    m_status = SearchStatus::NOT_FOUND;
+    if (!m_map.passable(start->row(), start->col()) || !m_map.passable(goal->row(), goal->col())) {
+        return nullptr;
+    }
+
+    const uint64_t start_index = cell_index(start->row(), start->col());
+    const uint64_t goal_index = cell_index(goal->row(), goal->col());
+
+    m_records[start_index] = { 0.0, no_parent, false };
+    m_open.push_back({ estimate(start->row(), start->col(), *goal), 0.0, start_index });
+
+    while (!m_open.empty()) {
+        m_stats.peak_open = max(m_stats.peak_open, m_open.size());
+
+        pop_heap(m_open.begin(), m_open.end(), greater<>{});
+        const Entry entry = m_open.back();
+        m_open.pop_back();
+
+        auto& record = m_records[entry.cell];
+        if (record.closed || entry.cost > record.cost) {
+            continue;
+        }
+        record.closed = true;
+        ++m_stats.expansions;
+
+        if (entry.cell == goal_index) {
+            m_status = SearchStatus::FOUND;
+            return build_path(start, entry.cell, *goal);
+        }
+
+        const int row = static_cast<int>(entry.cell / columns);
+        const int col = static_cast<int>(entry.cell % columns);
+        prefetch_ahead(row, col);
+
+        for (int next_row = row - 1; next_row <= row + 1; ++next_row) {
+            for (int next_col = col - 1; next_col <= col + 1; ++next_col) {
+                // avoid using the current node or crossing walls, the map border counts as a wall
+                if ((next_row == row && next_col == col) || !m_map.passable(next_row, next_col)) {
+                    continue;
+                }
+
+                const uint64_t next = cell_index(next_row, next_col);
+                const double cost = entry.cost + movement_cost(row, col, next_row, next_col);
+
+                const auto found = m_records.find(next);
+                if (found == m_records.end()) {
+                    if (m_records.size() == m_max_cells) {
+                        m_status = SearchStatus::RUNNING;
+                        return nullptr;
+                    }
+                    m_records.emplace(next, Record{ cost, entry.cell, false });
+                }
+                else {
+                    if (found->second.closed || cost >= found->second.cost) {
+                        continue;
+                    }
+                    found->second.cost = cost;
+                    found->second.parent = entry.cell;
+                }
+
+                m_open.push_back({ cost + estimate(next_row, next_col, *goal), cost, next });
+                push_heap(m_open.begin(), m_open.end(), greater<>{});
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief Asks the map to read the chunks next to the given cell, when it is close to their edge.
+ */
+void ChunkedSolver::prefetch_ahead(int row, int col) const
+{
+    constexpr int size = ChunkedMap::chunk_size;
+    const int inner_row = row % size;
+    const int inner_col = col % size;
+    if (inner_row >= prefetch_distance && inner_row < size - prefetch_distance
+        && inner_col >= prefetch_distance && inner_col < size - prefetch_distance) {
+        return;
+    }
+
+    for (int row_step = -1; row_step <= 1; ++row_step) {
+        for (int col_step = -1; col_step <= 1; ++col_step) {
+            const int ahead_row = row + row_step * prefetch_distance;
+            const int ahead_col = col + col_step * prefetch_distance;
+            if ((ahead_row / size != row / size || ahead_col / size != col / size) && ahead_row >= 0 && ahead_col >= 0) {
+                m_map.prefetch(ahead_row, ahead_col);
+            }
+        }
+    }
+}
+
+/**
+ * Converts the parent links of the search into a chain of nodes.
+ * @param start the node where the search started, it becomes the end of the chain.
+ * @param goal the cell where the search ended.
+ * @param target the goal node, used to fill in the estimations.
+ * @return the node for the goal cell.
+ */
+ChunkedSolver::NodePtr ChunkedSolver::build_path(NodePtr start, uint64_t goal, const Node& target) const
+{
+    const uint64_t columns = static_cast<uint64_t>(m_map.columns());
+
+    vector<uint64_t> cells;
+    for (uint64_t cell = goal; cell != no_parent; cell = m_records.at(cell).parent) {
+        cells.push_back(cell);
+    }
+
+    // the last entry is the start cell itself
+    start->set_cost(0.0);
+    start->set_estimation(estimate(start->row(), start->col(), target));
+    start->set_parent(nullptr);
+
+    NodePtr current = start;
+    for (auto cell = cells.rbegin() + 1; cell != cells.rend(); ++cell) {
+        const int row = static_cast<int>(*cell / columns);
+        const int col = static_cast<int>(*cell % columns);
+
+        auto node = make_shared<Node>(row, col);
+        node->set_cost(m_records.at(*cell).cost);
+        node->set_estimation(estimate(row, col, target));
+        node->set_parent(current);
+        current = std::move(node);
+    }
+
+    return current;
+}
+
+/**
+ * Cost function for reaching the current state
+ */
+double ChunkedSolver::movement_cost(int from_row, int from_col, int to_row, int to_col) const noexcept
+{
+    return (from_row != to_row && from_col != to_col) ? StandardCost::diagonal : StandardCost::straight;
+}
+
+/**
+ * Heuristic function
+ */
+double ChunkedSolver::estimate(int row, int col, const Node& goal) const noexcept
+{
+    return EuclideanHeuristic::estimate<StandardCost>(abs(col - goal.col()), abs(row - goal.row()));
+}
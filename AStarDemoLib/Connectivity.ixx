@@ -0,0 +1,318 @@
+/* Connectivity.ixx - Connected components of the walkable cells
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+export module Connectivity;
+
+import <array>;
+import <cassert>;
+import <cstddef>;
+import <cstdint>;
+import <vector>;
+
+export namespace AStarLib {
+
+    /**
+     * Connected components of the walkable cells of a grid, so that unreachable goals are
+     * rejected without flooding everything reachable from the start.
+     *
+     * Cells are joined under 8 connectivity with corner cutting, the most permissive moves of
+     * the solvers, so cells in different components can't be joined by any of them. The
+     * components live on a union-find structure: unblocking a cell merges it with its
+     * neighbours, blocking one only needs a rebuild when it may have split its component.
+     *
+     * Grid is anything with rows(), columns() and passable(), like Map and MapSnapshot.
+     */
+    export class Connectivity final
+    {
+    public:
+        template<typename Grid>
+        void build(const Grid& grid);
+
+        template<typename Grid>
+        void unblock(const Grid& grid, int row, int col);
+
+        template<typename Grid>
+        void block(const Grid& grid, int row, int col);
+
+        void invalidate() noexcept { m_valid = false; }
+
+        /**
+         * @brief False until build() is called, and after a change that needs it to be called again.
+         */
+        bool valid() const noexcept { return m_valid; }
+
+        template<typename Grid>
+        bool connected(const Grid& grid, int from_row, int from_col, int to_row, int to_col) const;
+
+    private:
+        // the 8 neighbours of a cell walking around it clockwise, from the top left one
+        static constexpr int ring_rows[8] = { -1, -1, -1, 0, 1, 1, 1, 0 };
+        static constexpr int ring_cols[8] = { -1, 0, 1, 1, 1, 0, -1, -1 };
+
+        std::vector<std::uint32_t> m_parent;
+        std::vector<std::uint8_t> m_rank;
+        int m_columns = 0;
+        bool m_valid = false;
+
+        std::uint32_t cell_index(int row, int col) const noexcept {
+            return static_cast<std::uint32_t>(row * m_columns + col);
+        }
+
+        std::uint32_t find(std::uint32_t cell) noexcept;
+        std::uint32_t root(std::uint32_t cell) const noexcept;
+        void unite(std::uint32_t first, std::uint32_t second) noexcept;
+
+        template<typename Grid>
+        static unsigned ring(const Grid& grid, int row, int col) noexcept;
+
+        static bool ring_joined(unsigned around) noexcept;
+    };
+}
+
+// make the standard C++ library available on the local namespace
+using namespace std;
+
+// also to reduce typing
+using namespace AStarLib;
+
+/**
+ * @brief Labels all the components again, after the grid was loaded or a change split one.
+ * @param grid the cells to label.
+ */
+template<typename Grid>
+void Connectivity::build(const Grid& grid)
+{
+    const int rows = grid.rows();
+    m_columns = grid.columns();
+
+    const size_t cells = static_cast<size_t>(rows) * m_columns;
+    m_parent.resize(cells);
+    m_rank.assign(cells, 0);
+    for (size_t cell = 0; cell < cells; ++cell) {
+        m_parent[cell] = static_cast<uint32_t>(cell);
+    }
+
+    // joining each cell with the neighbours already seen covers every pair once
+    for (int row = 0; row < rows; ++row) {
+        for (int col = 0; col < m_columns; ++col) {
+            if (!grid.passable(row, col)) {
+                continue;
+            }
+
+            const uint32_t cell = cell_index(row, col);
+            if (grid.passable(row - 1, col - 1)) {
+                unite(cell, cell_index(row - 1, col - 1));
+            }
+            if (grid.passable(row - 1, col)) {
+                unite(cell, cell_index(row - 1, col));
+            }
+            if (grid.passable(row - 1, col + 1)) {
+                unite(cell, cell_index(row - 1, col + 1));
+            }
+            if (grid.passable(row, col - 1)) {
+                unite(cell, cell_index(row, col - 1));
+            }
+        }
+    }
+
+    // point everything straight at its root, so that the lookups don't need to follow chains
+    for (size_t cell = 0; cell < cells; ++cell) {
+        m_parent[cell] = find(static_cast<uint32_t>(cell));
+    }
+
+    m_valid = true;
+}
+
+/**
+ * @brief Merges a cell that became walkable with the components around it.
+ * @param grid the cells, with the change already made.
+ * @param row the row of the unblocked cell.
+ * @param col the column of the unblocked cell.
+ */
+template<typename Grid>
+void Connectivity::unblock(const Grid& grid, int row, int col)
+{
+    if (!m_valid) {
+        return;
+    }
+
+    const uint32_t cell = cell_index(row, col);
+    const unsigned around = ring(grid, row, col);
+
+    // a cell blocked after the last build still belongs to its old component, which is
+    // only right when one of its neighbours is still in it
+    if (find(cell) != cell || m_rank[cell] != 0) {
+        bool joined = false;
+        for (int i = 0; i < 8 && !joined; ++i) {
+            joined = ((around >> i) & 1) && find(cell_index(row + ring_rows[i], col + ring_cols[i])) == find(cell);
+        }
+        if (!joined) {
+            invalidate();
+            return;
+        }
+    }
+
+    for (int i = 0; i < 8; ++i) {
+        if ((around >> i) & 1) {
+            unite(cell, cell_index(row + ring_rows[i], col + ring_cols[i]));
+        }
+    }
+}
+
+/**
+ * @brief Takes note of a cell that stopped being walkable.
+ * The component is kept when the neighbours of the cell are still joined around it,
+ * otherwise it may have split and everything is labelled again on the next query.
+ * @param grid the cells, with the change already made.
+ * @param row the row of the blocked cell.
+ * @param col the column of the blocked cell.
+ */
+template<typename Grid>
+void Connectivity::block(const Grid& grid, int row, int col)
+{
+    if (m_valid && !ring_joined(ring(grid, row, col))) {
+        invalidate();
+    }
+}
+
+/**
+ * @brief Checks if a path may exist between two cells.
+ * A blocked start is left through any of its neighbours, as the solvers do.
+ * @param grid the cells the components were built from.
+ * @return false when no path can exist, the goal is blocked or in another component.
+ */
+template<typename Grid>
+bool Connectivity::connected(const Grid& grid, int from_row, int from_col, int to_row, int to_col) const
+{
+    assert(m_valid);
+    if (from_row == to_row && from_col == to_col) {
+        return true;
+    }
+    if (!grid.passable(to_row, to_col)) {
+        return false;
+    }
+
+    const uint32_t target = root(cell_index(to_row, to_col));
+    if (grid.passable(from_row, from_col)) {
+        return root(cell_index(from_row, from_col)) == target;
+    }
+
+    const unsigned around = ring(grid, from_row, from_col);
+    for (int i = 0; i < 8; ++i) {
+        if (((around >> i) & 1) && root(cell_index(from_row + ring_rows[i], from_col + ring_cols[i])) == target) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief The walkable neighbours of a cell, one bit per ring position.
+ */
+template<typename Grid>
+unsigned Connectivity::ring(const Grid& grid, int row, int col) noexcept
+{
+    unsigned around = 0;
+    for (int i = 0; i < 8; ++i) {
+        if (grid.passable(row + ring_rows[i], col + ring_cols[i])) {
+            around |= 1u << i;
+        }
+    }
+    return around;
+}
+
+/**
+ * @brief Checks if the walkable neighbours of a cell are still joined among themselves
+ * without going through the cell in the middle.
+ * @param around the neighbours, as given by ring().
+ */
+bool Connectivity::ring_joined(unsigned around) noexcept
+{
+    static constexpr auto table = [] {
+        array<bool, 256> joined{};
+        for (unsigned cells = 0; cells < joined.size(); ++cells) {
+            // grow the set reached from the lowest neighbour until it stops changing
+            unsigned reached = cells & (~cells + 1);
+            for (unsigned previous = 0; previous != reached; ) {
+                previous = reached;
+                for (int i = 0; i < 8; ++i) {
+                    if (!((reached >> i) & 1)) {
+                        continue;
+                    }
+                    for (int j = 0; j < 8; ++j) {
+                        const int rows = ring_rows[i] - ring_rows[j];
+                        const int cols = ring_cols[i] - ring_cols[j];
+                        if (rows >= -1 && rows <= 1 && cols >= -1 && cols <= 1) {
+                            reached |= cells & (1u << j);
+                        }
+                    }
+                }
+            }
+            joined[cells] = reached == cells;
+        }
+        return joined;
+    }();
+
+    return table[around & 0xff];
+}
+
+/**
+ * @brief The root of a cell's set, halving the path to it on the way.
+ */
+uint32_t Connectivity::find(uint32_t cell) noexcept
+{
+    while (m_parent[cell] != cell) {
+        m_parent[cell] = m_parent[m_parent[cell]];
+        cell = m_parent[cell];
+    }
+    return cell;
+}
+
+/**
+ * @brief The root of a cell's set, without touching the structure so that it can be shared.
+ * The union by rank keeps the chains short.
+ */
+uint32_t Connectivity::root(uint32_t cell) const noexcept
+{
+    while (m_parent[cell] != cell) {
+        cell = m_parent[cell];
+    }
+    return cell;
+}
+
+/**
+ * @brief Merges the sets of two cells, the shallower tree goes below the other one.
+ */
+void Connectivity::unite(uint32_t first, uint32_t second) noexcept
+{
+    first = find(first);
+    second = find(second);
+    if (first == second) {
+        return;
+    }
+
+    if (m_rank[first] < m_rank[second]) {
+        m_parent[first] = second;
+    }
+    else {
+        m_parent[second] = first;
+        if (m_rank[first] == m_rank[second]) {
+            ++m_rank[first];
+        }
+    }
+}
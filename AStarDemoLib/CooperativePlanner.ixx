@@ -0,0 +1,593 @@
+/* CooperativePlanner.ixx - Collision free paths for many agents sharing a map
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+export module CooperativePlanner;
+
+import <algorithm>;
+import <cassert>;
+import <cstddef>;
+import <cstdint>;
+import <limits>;
+import <memory>;
+import <unordered_map>;
+import <utility>;
+import <vector>;
+
+import Map;
+import OpenList;
+import SearchContext;
+import FlowField;
+import SearchPolicies;
+
+export namespace AStarLib {
+
+    /**
+     * Hash table from (cell, time) pairs to 32 bit values, with open addressing and linear probing.
+     *
+     * The slots are tagged with the generation of the table, so that clearing it is a
+     * counter increment, which makes it cheap to use as scratch memory for each search.
+     */
+    export class SpaceTimeTable final
+    {
+    public:
+        static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+        explicit SpaceTimeTable(std::size_t capacity = 64);
+
+        void clear() noexcept;
+
+        std::size_t size() const noexcept { return m_size; }
+        std::size_t capacity() const noexcept { return m_slots.size(); }
+
+        std::uint32_t find(std::uint32_t cell, std::uint32_t time) const noexcept;
+        void assign(std::uint32_t cell, std::uint32_t time, std::uint32_t value);
+        bool erase(std::uint32_t cell, std::uint32_t time) noexcept;
+
+    private:
+        struct Slot {
+            std::uint64_t key;
+            std::uint32_t value;
+            std::uint32_t generation;
+        };
+
+        // erased slots keep the probe chains going until the next rehash
+        static constexpr std::uint64_t erased = std::numeric_limits<std::uint64_t>::max();
+
+        std::vector<Slot> m_slots;
+        std::size_t m_size;
+        std::size_t m_used;
+        std::uint32_t m_generation;
+        int m_shift;
+
+        static std::uint64_t make_key(std::uint32_t cell, std::uint32_t time) noexcept {
+            return (std::uint64_t{ time } << 32) | cell;
+        }
+
+        std::size_t slot_of(std::uint64_t key) const noexcept {
+            return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ull) >> m_shift);
+        }
+
+        bool in_use(const Slot& slot) const noexcept { return slot.generation == m_generation; }
+
+        void rehash(std::size_t capacity);
+    };
+
+    /**
+     * Moves many agents over the same map without running into each other, with
+     * Windowed Hierarchical Cooperative A* (Silver, 2005).
+     *
+     * Each agent searches the next window() ticks in (cell, time) space, avoiding the cells
+     * other agents have reserved at those times and swapping places with them, and then
+     * reserves its own moves. The cell where its window ends stays reserved afterwards, so
+     * that its current plan followed by waiting is always a way out on its next search,
+     * and agents never collide, even when they get stuck. Agents meeting head on in a one
+     * cell wide corridor do get stuck, as nobody plans to back out.
+     *
+     * Past the window, the estimate is the true distance to the goal on the empty map,
+     * given by a FlowField shared by all the agents heading to that goal. The field only
+     * searches as far as the agents asked about, so it costs little more than a single
+     * search and is reused on every tick.
+     *
+     * The agents search again every half window, spread over the ticks so that only a
+     * fraction of them searches on each one, until its first search an agent just waits.
+     * A search that runs out of nodes keeps the deepest part of the window it got to.
+     *
+     * The planner works on the snapshot taken when it was constructed, later changes to
+     * the map are not seen.
+     */
+    export class CooperativePlanner final
+    {
+    public:
+        static constexpr int default_window = 16;
+
+        explicit CooperativePlanner(const Map& map, int window = default_window);
+        explicit CooperativePlanner(std::shared_ptr<const MapSnapshot> snapshot, int window = default_window);
+
+        std::size_t add_agent(int row, int col, int goal_row, int goal_col);
+        void set_goal(std::size_t agent, int row, int col);
+
+        void tick();
+
+        std::size_t agents() const noexcept { return m_agents.size(); }
+        std::pair<int, int> position(std::size_t agent) const noexcept;
+        bool arrived(std::size_t agent) const noexcept;
+
+        int window() const noexcept { return m_window; }
+        std::uint32_t time() const noexcept { return m_time; }
+
+        /**
+         * @brief Counters added up over all the window searches since the planner was made.
+         */
+        const SearchStats& stats() const noexcept { return m_stats; }
+
+    private:
+        static constexpr std::size_t node_budget = std::size_t{ 1 } << 14;
+        static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+
+        struct Agent {
+            std::uint32_t goal;
+
+            // the cells to be at from plan_time on, reserved on the table
+            std::vector<std::uint32_t> plan;
+            std::uint32_t plan_time;
+            std::uint32_t replan_time;
+        };
+
+        struct Field {
+            std::unique_ptr<FlowField> field;
+            std::size_t agents;
+        };
+
+        struct WindowNode {
+            std::uint32_t cell;
+            std::uint32_t time;
+            double cost;
+            std::uint32_t parent;
+            bool closed;
+        };
+
+        std::shared_ptr<const MapSnapshot> m_snapshot;
+        int m_window;
+        std::uint32_t m_time;
+        std::vector<Agent> m_agents;
+        std::unordered_map<std::uint32_t, Field> m_fields;
+        SpaceTimeTable m_reservations;
+
+        // the cell each agent ends its plan on, held from the end of the plan on
+        SpaceTimeTable m_parked;
+        SearchStats m_stats;
+
+        // scratch memory of the window searches
+        SpaceTimeTable m_visited;
+        std::vector<WindowNode> m_nodes;
+        IndexedHeap m_open_list;
+
+        std::uint32_t cell_index(int row, int col) const noexcept {
+            return static_cast<std::uint32_t>(row * m_snapshot->columns() + col);
+        }
+
+        std::uint32_t current_cell(const Agent& agent) const noexcept {
+            return agent.plan[std::min<std::size_t>(m_time - agent.plan_time, agent.plan.size() - 1)];
+        }
+
+        std::uint32_t plan_end(const Agent& agent) const noexcept {
+            return agent.plan_time + static_cast<std::uint32_t>(agent.plan.size()) - 1;
+        }
+
+        bool reserved(std::uint32_t cell, std::uint32_t time) const noexcept;
+
+        FlowField& field(std::uint32_t goal);
+        void release_field(std::uint32_t goal);
+        void plan(std::size_t agent);
+        std::uint32_t search(std::size_t agent, std::uint32_t start, FlowField& heuristic);
+    };
+}
+
+// make the standard C++ library available on the local namespace
+using namespace std;
+
+// also to reduce typing
+using namespace AStarLib;
+
+/**
+ * @brief Constructs an empty table.
+ * @param capacity how many slots to start with, rounded up to a power of two.
+ */
+SpaceTimeTable::SpaceTimeTable(size_t capacity) : m_size{ 0 }, m_used{ 0 }, m_generation{ 1 }, m_shift{ 64 }
+{
+    rehash(max(capacity, size_t{ 16 }));
+}
+
+/**
+ * @brief Removes all the entries, keeping the slots.
+ */
+void SpaceTimeTable::clear() noexcept
+{
+    m_size = 0;
+    m_used = 0;
+    if (++m_generation == 0) {
+        // after wrapping around, old slots could look current again
+        for (auto& slot : m_slots) {
+            slot.generation = 0;
+        }
+        m_generation = 1;
+    }
+}
+
+/**
+ * @brief Looks an entry up.
+ * @return the value stored for the pair, npos when there is none.
+ */
+uint32_t SpaceTimeTable::find(uint32_t cell, uint32_t time) const noexcept
+{
+    const auto key = make_key(cell, time);
+    const size_t mask = m_slots.size() - 1;
+    for (size_t i = slot_of(key); in_use(m_slots[i]); i = (i + 1) & mask) {
+        if (m_slots[i].key == key) {
+            return m_slots[i].value;
+        }
+    }
+    return npos;
+}
+
+/**
+ * @brief Stores the value for the pair, replacing the previous one if there is any.
+ */
+void SpaceTimeTable::assign(uint32_t cell, uint32_t time, uint32_t value)
+{
+    // at most half of the slots in use keeps the probe chains short
+    if ((m_used + 1) * 2 > m_slots.size()) {
+        rehash(m_size * 4 > m_slots.size() ? m_slots.size() * 2 : m_slots.size());
+    }
+
+    const auto key = make_key(cell, time);
+    const size_t mask = m_slots.size() - 1;
+    size_t target = m_slots.size();
+    size_t i = slot_of(key);
+    for (; in_use(m_slots[i]); i = (i + 1) & mask) {
+        if (m_slots[i].key == key) {
+            m_slots[i].value = value;
+            return;
+        }
+        if (m_slots[i].key == erased && target == m_slots.size()) {
+            target = i;
+        }
+    }
+
+    if (target == m_slots.size()) {
+        target = i;
+        ++m_used;
+    }
+    m_slots[target] = { key, value, m_generation };
+    ++m_size;
+}
+
+/**
+ * @brief Removes the entry for the pair.
+ * @return false if there was none.
+ */
+bool SpaceTimeTable::erase(uint32_t cell, uint32_t time) noexcept
+{
+    const auto key = make_key(cell, time);
+    const size_t mask = m_slots.size() - 1;
+    for (size_t i = slot_of(key); in_use(m_slots[i]); i = (i + 1) & mask) {
+        if (m_slots[i].key == key) {
+            m_slots[i].key = erased;
+            --m_size;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Moves the entries to a new set of slots, dropping the erased ones.
+ * @param capacity at least how many slots to have, rounded up to a power of two.
+ */
+void SpaceTimeTable::rehash(size_t capacity)
+{
+    size_t slots = 16;
+    int shift = 60;
+    while (slots < capacity) {
+        slots *= 2;
+        --shift;
+    }
+
+    auto previous = std::move(m_slots);
+    const auto generation = m_generation;
+    m_slots.assign(slots, Slot{ 0, 0, 0 });
+    m_shift = shift;
+    m_generation = 1;
+    m_size = 0;
+    m_used = 0;
+
+    for (const auto& slot : previous) {
+        if (slot.generation == generation && slot.key != erased) {
+            size_t i = slot_of(slot.key);
+            while (in_use(m_slots[i])) {
+                i = (i + 1) & (slots - 1);
+            }
+            m_slots[i] = { slot.key, slot.value, m_generation };
+            ++m_size;
+            ++m_used;
+        }
+    }
+}
+
+/**
+ * @brief Constructs a planner over a snapshot of the map.
+ * @param map the map to move on, it is not modified
+ * @param window how many ticks ahead each agent plans its moves
+ */
+CooperativePlanner::CooperativePlanner(const Map& map, int window) : CooperativePlanner(map.snapshot(), window)
+{
+}
+
+/**
+ * @brief Constructs a planner over a snapshot.
+ * @param snapshot the map contents to move on
+ * @param window how many ticks ahead each agent plans its moves
+ */
+CooperativePlanner::CooperativePlanner(shared_ptr<const MapSnapshot> snapshot, int window) :
+    m_snapshot(std::move(snapshot)), m_window(max(window, 1)), m_time{ 0 }, m_reservations(1024), m_open_list(node_budget)
+{
+    assert(m_snapshot != nullptr);
+}
+
+/**
+ * @brief Adds an agent, which starts planning on the next tick.
+ * @param row the row the agent stands on
+ * @param col the column the agent stands on
+ * @param goal_row the row of the cell to move to
+ * @param goal_col the column of the cell to move to
+ * @return the agent number, agents are numbered in the order they are added
+ */
+size_t CooperativePlanner::add_agent(int row, int col, int goal_row, int goal_col)
+{
+    const auto start = cell_index(row, col);
+    const auto goal = cell_index(goal_row, goal_col);
+    field(goal);
+
+    const auto agent = static_cast<uint32_t>(m_agents.size());
+    const auto interval = static_cast<uint32_t>(max(m_window / 2, 1));
+    m_agents.push_back({ goal, { start }, m_time, m_time + agent % interval });
+    m_reservations.assign(start, m_time, agent);
+    m_parked.assign(start, 0, agent);
+    return agent;
+}
+
+/**
+ * @brief Sends an agent somewhere else, it plans its new route on the next tick.
+ */
+void CooperativePlanner::set_goal(size_t agent, int row, int col)
+{
+    auto& moving = m_agents[agent];
+    const auto goal = cell_index(row, col);
+    if (goal != moving.goal) {
+        field(goal);
+        release_field(moving.goal);
+        moving.goal = goal;
+    }
+    moving.replan_time = m_time;
+}
+
+/**
+ * @brief The cell an agent stands on at the current time.
+ * @return the row and column of the cell.
+ */
+pair<int, int> CooperativePlanner::position(size_t agent) const noexcept
+{
+    const auto cell = static_cast<int>(current_cell(m_agents[agent]));
+    return { cell / m_snapshot->columns(), cell % m_snapshot->columns() };
+}
+
+/**
+ * @brief Checks if an agent is standing on its goal.
+ */
+bool CooperativePlanner::arrived(size_t agent) const noexcept
+{
+    return current_cell(m_agents[agent]) == m_agents[agent].goal;
+}
+
+/**
+ * @brief Plans the agents whose turn it is, and moves every agent one step along its plan.
+ */
+void CooperativePlanner::tick()
+{
+    SearchTimer timer(m_stats.elapsed);
+
+    for (size_t agent = 0; agent < m_agents.size(); ++agent) {
+        if (m_agents[agent].replan_time <= m_time) {
+            plan(agent);
+        }
+    }
+
+    // the reservations of the tick that is over are not needed anymore
+    for (const auto& agent : m_agents) {
+        m_reservations.erase(current_cell(agent), m_time);
+    }
+    ++m_time;
+}
+
+/**
+ * @brief The distance field towards a goal, created for the first agent heading there.
+ */
+FlowField& CooperativePlanner::field(uint32_t goal)
+{
+    auto& entry = m_fields[goal];
+    if (entry.field == nullptr) {
+        entry.field = make_unique<FlowField>(m_snapshot);
+        entry.field->set_goal(static_cast<int>(goal) / m_snapshot->columns(), static_cast<int>(goal) % m_snapshot->columns());
+    }
+    ++entry.agents;
+    return *entry.field;
+}
+
+/**
+ * @brief Drops the distance field towards a goal once no agent is heading there.
+ */
+void CooperativePlanner::release_field(uint32_t goal)
+{
+    const auto entry = m_fields.find(goal);
+    if (entry != m_fields.end() && --entry->second.agents == 0) {
+        m_fields.erase(entry);
+    }
+}
+
+/**
+ * @brief Replaces the reservations of an agent from now on by a newly searched window.
+ */
+void CooperativePlanner::plan(size_t agent)
+{
+    auto& moving = m_agents[agent];
+    const auto start = current_cell(moving);
+    for (size_t i = m_time - moving.plan_time; i < moving.plan.size(); ++i) {
+        m_reservations.erase(moving.plan[i], moving.plan_time + static_cast<uint32_t>(i));
+    }
+    m_parked.erase(moving.plan.back(), 0);
+
+    const auto last = search(agent, start, *m_fields.at(moving.goal).field);
+
+    moving.plan.assign(static_cast<size_t>(m_nodes[last].time) + 1, start);
+    for (auto node = last; node != none; node = m_nodes[node].parent) {
+        moving.plan[m_nodes[node].time] = m_nodes[node].cell;
+    }
+
+    // stuck before the end of the window, waiting is the best it can do
+    moving.plan.resize(static_cast<size_t>(m_window) + 1, moving.plan.back());
+    moving.plan_time = m_time;
+    for (size_t i = 0; i < moving.plan.size(); ++i) {
+        m_reservations.assign(moving.plan[i], m_time + static_cast<uint32_t>(i), static_cast<uint32_t>(agent));
+    }
+    m_parked.assign(moving.plan.back(), 0, static_cast<uint32_t>(agent));
+
+    moving.replan_time = m_time + static_cast<uint32_t>(max(m_window / 2, 1));
+}
+
+/**
+ * @brief Checks if some agent is going to be on a cell at the given time, either moving
+ * along its plan or waiting where the plan ends.
+ */
+bool CooperativePlanner::reserved(uint32_t cell, uint32_t time) const noexcept
+{
+    if (m_reservations.find(cell, time) != SpaceTimeTable::npos) {
+        return true;
+    }
+    const auto parked = m_parked.find(cell, 0);
+    return parked != SpaceTimeTable::npos && time >= plan_end(m_agents[parked]);
+}
+
+/**
+ * @brief Searches the next window of an agent in (cell, time) space.
+ * @param agent the agent searching, its own reservations are already released
+ * @param start the cell it stands on now
+ * @param heuristic the distances to its goal
+ * @return the node where the path found ends, its time is the window unless it got stuck.
+ */
+uint32_t CooperativePlanner::search(size_t agent, uint32_t start, FlowField& heuristic)
+{
+    const int columns = m_snapshot->columns();
+    const auto goal = m_agents[agent].goal;
+    const auto window = static_cast<uint32_t>(m_window);
+
+    m_nodes.clear();
+    m_visited.clear();
+    m_open_list.clear();
+
+    const auto estimate = [&](uint32_t cell) {
+        return heuristic.distance(static_cast<int>(cell) / columns, static_cast<int>(cell) % columns);
+    };
+
+    m_nodes.push_back({ start, 0, 0.0, none, false });
+    m_visited.assign(start, 0, 0);
+    m_open_list.push(0, estimate(start));
+    ++m_stats.pushes;
+
+    uint32_t best = 0;
+    while (!m_open_list.empty()) {
+        m_stats.peak_open = max(m_stats.peak_open, m_open_list.size());
+
+        const auto current = static_cast<uint32_t>(m_open_list.pop());
+        ++m_stats.pops;
+
+        auto& node = m_nodes[current];
+        node.closed = true;
+        const auto cell = node.cell;
+        const auto time = node.time;
+        const double cost = node.cost;
+
+        if (time > m_nodes[best].time) {
+            best = current;
+        }
+        if (time == window) {
+            break;
+        }
+
+        ++m_stats.expansions;
+        const int row = static_cast<int>(cell) / columns;
+        const int col = static_cast<int>(cell) % columns;
+
+        const auto visit = [&](uint32_t next, double step) {
+            // someone else is there by then, or is coming the opposite way
+            const auto arrival = m_time + time + 1;
+            if (reserved(next, arrival)) {
+                return;
+            }
+            if (next != cell) {
+                const auto other = m_reservations.find(next, arrival - 1);
+                if (other != SpaceTimeTable::npos && other == m_reservations.find(cell, arrival)) {
+                    return;
+                }
+            }
+
+            const double remaining = estimate(next);
+            if (remaining == numeric_limits<double>::infinity()) {
+                return;
+            }
+
+            const double next_cost = cost + step;
+            // the deeper of equal keys goes first, as in PreferDeeper
+            const double key = next_cost + remaining * (1.0 + 1e-6);
+            const auto existing = m_visited.find(next, time + 1);
+            if (existing == SpaceTimeTable::npos) {
+                if (m_nodes.size() >= node_budget) {
+                    return;
+                }
+                const auto index = static_cast<uint32_t>(m_nodes.size());
+                m_nodes.push_back({ next, time + 1, next_cost, current, false });
+                m_visited.assign(next, time + 1, index);
+                m_open_list.push(index, key);
+                ++m_stats.pushes;
+            }
+            else if (!m_nodes[existing].closed && next_cost < m_nodes[existing].cost) {
+                m_nodes[existing].cost = next_cost;
+                m_nodes[existing].parent = current;
+                m_open_list.decrease_key(existing, key);
+                ++m_stats.decrease_keys;
+            }
+        };
+
+        // waiting on the goal is free, anywhere else it costs as much as a straight move
+        visit(cell, cell == goal ? 0.0 : StandardCost::straight);
+        NeighbourMask::for_each(row, col, m_snapshot->neighbours(row, col), [&](int next_row, int next_col, bool diagonal) {
+            visit(cell_index(next_row, next_col), diagonal ? StandardCost::diagonal : StandardCost::straight);
+        });
+    }
+
+    return best;
+}
@@ -0,0 +1,261 @@
+/* ExpansionStream.ixx - Lock free stream of search events, for live drawing
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+export module ExpansionStream;
+
+import <algorithm>;
+import <atomic>;
+import <bit>;
+import <cstddef>;
+import <cstdint>;
+import <limits>;
+import <memory>;
+
+import SearchContext;
+
+export namespace AStarLib {
+
+    /**
+     * One cell changing its state during a search.
+     *
+     * The cell is given as row * columns + col. An UNSEEN state marks the start of
+     * a new search, everything received before it is stale.
+     */
+    export struct ExpansionEvent {
+        std::uint32_t cell;
+        SearchContext::CellState state;
+    };
+
+    /**
+     * Single producer, single consumer ring buffer of expansion events.
+     *
+     * The search thread publishes into it without taking any lock, and the drawing
+     * thread drains it once per frame, so neither one waits for the other. When the
+     * consumer falls behind, the events that don't fit are dropped and the stream is
+     * marked as overflowed, the search never waits for room.
+     *
+     * The latest state of the cells given to track() is kept aside as well, so that
+     * the next drain() after an overflow hands the consumer a full refresh instead: an
+     * UNSEEN event, as on a new search, followed by one event per cell seen so far.
+     * Without tracked cells that refresh only has the UNSEEN event.
+     */
+    export class ExpansionStream final
+    {
+    public:
+        explicit ExpansionStream(std::size_t capacity = 1 << 16);
+
+        ExpansionStream(const ExpansionStream&) = delete;
+        ExpansionStream& operator=(const ExpansionStream&) = delete;
+
+        void track(std::size_t cells);
+
+        // producer side
+        bool try_publish(ExpansionEvent event) noexcept;
+        void publish(ExpansionEvent event) noexcept;
+
+        // consumer side
+        template<typename Consumer>
+        std::size_t drain(Consumer&& consumer, std::size_t limit = std::numeric_limits<std::size_t>::max());
+        void discard() noexcept;
+        bool overflowed() const noexcept { return m_overflow.load(std::memory_order_acquire); }
+
+        void open() noexcept { m_closed.store(false, std::memory_order_release); }
+        void close() noexcept { m_closed.store(true, std::memory_order_release); }
+        bool closed() const noexcept { return m_closed.load(std::memory_order_acquire); }
+
+        std::size_t capacity() const noexcept { return m_mask + 1; }
+        std::size_t dropped() const noexcept { return m_dropped.load(std::memory_order_relaxed); }
+
+    private:
+        std::unique_ptr<ExpansionEvent[]> m_events;
+        std::size_t m_mask;
+        std::atomic<bool> m_closed{ false };
+        std::atomic<std::size_t> m_dropped{ 0 };
+        std::atomic<bool> m_overflow{ false };
+
+        // the latest state of each tracked cell, written by the producer before publishing
+        std::unique_ptr<std::atomic<SearchContext::CellState>[]> m_states;
+        std::size_t m_cells = 0;
+
+        // written by the producer, with its last view of the consumer position
+        alignas(64) std::atomic<std::size_t> m_head{ 0 };
+        std::size_t m_tail_cache = 0;
+
+        // written by the consumer, with its last view of the producer position
+        alignas(64) std::atomic<std::size_t> m_tail{ 0 };
+        std::size_t m_head_cache = 0;
+    };
+
+    /**
+     * Publishes the cells being opened and closed by a search into a stream.
+     */
+    export class StreamObserver
+    {
+    public:
+        StreamObserver(ExpansionStream& stream, int columns) noexcept;
+
+        void on_push(int row, int col, double) noexcept { publish(row, col, SearchContext::CellState::OPEN); }
+        void on_decrease_key(int, int, double) noexcept {}
+        void on_close(int row, int col) noexcept { publish(row, col, SearchContext::CellState::CLOSED); }
+        void on_expand(int, int, double) noexcept {}
+
+    private:
+        ExpansionStream& m_stream;
+        int m_columns;
+
+        void publish(int row, int col, SearchContext::CellState state) noexcept {
+            m_stream.publish({ static_cast<std::uint32_t>(row * m_columns + col), state });
+        }
+    };
+
+    /**
+     * Hands every queued event to the consumer, oldest first, or a full refresh after an overflow.
+     * @param consumer called with each ExpansionEvent
+     * @param limit the most events to take, so that a frame never takes too long, a refresh ignores it
+     * @return how many events were taken.
+     */
+    template<typename Consumer>
+    std::size_t ExpansionStream::drain(Consumer&& consumer, std::size_t limit)
+    {
+        if (m_overflow.load(std::memory_order_relaxed) && m_overflow.exchange(false, std::memory_order_acquire)) {
+            // the queued events are older than the tracked states, and those published from now on newer
+            discard();
+
+            consumer(ExpansionEvent{ 0, SearchContext::CellState::UNSEEN });
+            std::size_t count = 1;
+            for (std::size_t cell = 0; cell < m_cells; ++cell) {
+                const auto state = m_states[cell].load(std::memory_order_relaxed);
+                if (state != SearchContext::CellState::UNSEEN) {
+                    consumer(ExpansionEvent{ static_cast<std::uint32_t>(cell), state });
+                    ++count;
+                }
+            }
+            return count;
+        }
+
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (m_head_cache == tail) {
+            m_head_cache = m_head.load(std::memory_order_acquire);
+        }
+
+        const std::size_t count = std::min(m_head_cache - tail, limit);
+        for (std::size_t i = 0; i < count; ++i) {
+            consumer(m_events[(tail + i) & m_mask]);
+        }
+
+        m_tail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+}
+
+// make the standard C++ library available on the local namespace
+using namespace std;
+
+// also to reduce typing
+using namespace AStarLib;
+
+
+/**
+ * @brief Creates an empty stream.
+ * @param capacity how many events can be queued, rounded up to a power of two.
+ */
+ExpansionStream::ExpansionStream(size_t capacity) :
+    m_events(make_unique<ExpansionEvent[]>(bit_ceil(max(capacity, size_t{ 2 })))),
+    m_mask(bit_ceil(max(capacity, size_t{ 2 })) - 1)
+{
+}
+
+/**
+ * @brief Keeps the latest state of the cells below the given index, for the refreshes
+ * after an overflow. Must not be called while events are being published.
+ * @param cells how many cells to track, usually rows * columns of the searched map.
+ */
+void ExpansionStream::track(size_t cells)
+{
+    if (cells != m_cells) {
+        m_states = make_unique<atomic<SearchContext::CellState>[]>(cells);
+        m_cells = cells;
+    }
+    for (size_t cell = 0; cell < m_cells; ++cell) {
+        m_states[cell].store(SearchContext::CellState::UNSEEN, memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Queues an event, if there is room for it.
+ * @return false when the stream is full.
+ */
+bool ExpansionStream::try_publish(ExpansionEvent event) noexcept
+{
+    const size_t head = m_head.load(memory_order_relaxed);
+    if (head - m_tail_cache > m_mask) {
+        m_tail_cache = m_tail.load(memory_order_acquire);
+        if (head - m_tail_cache > m_mask) {
+            return false;
+        }
+    }
+
+    m_events[head & m_mask] = event;
+    m_head.store(head + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Queues an event, dropping it when there is no room, so that a search never
+ * waits for the consumer. Dropping marks the stream as overflowed, unless it is closed,
+ * which means that nobody is draining it anyway.
+ */
+void ExpansionStream::publish(ExpansionEvent event) noexcept
+{
+    if (event.state == SearchContext::CellState::UNSEEN) {
+        for (size_t cell = 0; cell < m_cells; ++cell) {
+            m_states[cell].store(SearchContext::CellState::UNSEEN, memory_order_relaxed);
+        }
+    }
+    else if (event.cell < m_cells) {
+        m_states[event.cell].store(event.state, memory_order_relaxed);
+    }
+
+    if (closed()) {
+        m_dropped.fetch_add(1, memory_order_relaxed);
+    }
+    else if (!try_publish(event)) {
+        m_dropped.fetch_add(1, memory_order_relaxed);
+        m_overflow.store(true, memory_order_release);
+    }
+}
+
+/**
+ * @brief Throws away every queued event, from the consumer side.
+ */
+void ExpansionStream::discard() noexcept
+{
+    m_head_cache = m_head.load(memory_order_acquire);
+    m_tail.store(m_head_cache, memory_order_release);
+}
+
+
+/**
+ * @brief Creates an observer publishing into the given stream.
+ * A search start marker is published right away.
+ * @param columns the number of columns of the searched map, to compute the cell indexes.
+ */
+StreamObserver::StreamObserver(ExpansionStream& stream, int columns) noexcept : m_stream(stream), m_columns(columns)
+{
+    m_stream.publish({ 0, SearchContext::CellState::UNSEEN });
+}
@@ -0,0 +1,316 @@
+/* FlowField.ixx - Goal rooted distance and direction fields
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+export module FlowField;
+
+import <memory>;
+import <vector>;
+import <algorithm>;
+import <cassert>;
+import <cstddef>;
+import <cstdint>;
+import <limits>;
+
+import Node;
+import Map;
+import OpenList;
+import SearchPolicies;
+
+export namespace AStarLib {
+
+    /**
+     * Distance and direction towards a single goal, for every cell of the map.
+     *
+     * The field is filled by a Dijkstra search running backwards from the goal, so
+     * that any number of units heading to the same goal can follow it, instead of
+     * each one searching on its own. The search is lazy: it only goes as far as
+     * the cells asked about so far, and resumes from there on the next request.
+     * It can be forced to cover the whole map with expand_all().
+     *
+     * The field stays valid for as long as no cell gets blocked or unblocked. When
+     * built from a Map, such changes are detected on the next request and the
+     * search starts again on a new snapshot.
+     */
+    export class FlowField final
+    {
+    public:
+        using NodePtr = std::shared_ptr<Node>;
+
+        static constexpr int no_direction = -1;
+
+        explicit FlowField(const Map& map);
+        explicit FlowField(std::shared_ptr<const MapSnapshot> snapshot);
+
+        void set_goal(int row, int col);
+
+        int goal_row() const noexcept { return m_goal_row; }
+        int goal_col() const noexcept { return m_goal_col; }
+
+        double distance(int row, int col);
+        int direction(int row, int col);
+        NodePtr find(NodePtr start);
+
+        void expand_all();
+
+        std::size_t settled_cells() const noexcept { return m_settled; }
+
+        /**
+         * @brief Row offset of the given direction.
+         */
+        static int row_step(int direction) noexcept { return direction / 3 - 1; }
+
+        /**
+         * @brief Column offset of the given direction.
+         */
+        static int col_step(int direction) noexcept { return direction % 3 - 1; }
+
+    private:
+        static constexpr float unreached = std::numeric_limits<float>::infinity();
+        static constexpr std::uint8_t none = 0xFF;
+
+        const Map* m_map;
+        std::shared_ptr<const MapSnapshot> m_snapshot;
+        int m_goal_row, m_goal_col;
+        std::vector<float> m_distance;
+        std::vector<std::uint8_t> m_direction;
+        IndexedHeap m_open_list;
+        std::size_t m_settled;
+
+        std::uint32_t cell_index(int row, int col) const noexcept {
+            return static_cast<std::uint32_t>(row * m_snapshot->columns() + col);
+        }
+
+        bool settled(std::uint32_t index) const noexcept {
+            return m_distance[index] != unreached && !m_open_list.contains(index);
+        }
+
+        void refresh();
+        void restart();
+        void expand();
+        bool expand_until(int row, int col);
+    };
+}
+
+// make the standard C++ library available on the local namespace
+using namespace std;
+
+// also to reduce typing
+using namespace AStarLib;
+
+
+/**
+ * @brief Constructs a field over the live map, following its changes.
+ * No goal is set, set_goal() has to be called before using it.
+ * @param map the map to search on, it is not modified
+ */
+FlowField::FlowField(const Map& map) : m_map(&map), m_snapshot(map.snapshot()), m_goal_row{ -1 }, m_goal_col{ -1 }, m_settled{ 0 }
+{
+}
+
+/**
+ * @brief Constructs a field over a fixed snapshot.
+ * No goal is set, set_goal() has to be called before using it.
+ * @param snapshot the map contents to search on
+ */
+FlowField::FlowField(shared_ptr<const MapSnapshot> snapshot) : m_map(nullptr), m_snapshot(std::move(snapshot)), m_goal_row{ -1 }, m_goal_col{ -1 }, m_settled{ 0 }
+{
+    assert(m_snapshot != nullptr);
+}
+
+/**
+ * @brief Changes the goal, the previous field is only dropped when the goal is a different one.
+ * @param row the goal row
+ * @param col the goal column
+ */
+void FlowField::set_goal(int row, int col)
+{
+    assert(row >= 0 && row < m_snapshot->rows() && col >= 0 && col < m_snapshot->columns());
+    if (row != m_goal_row || col != m_goal_col) {
+        m_goal_row = row;
+        m_goal_col = col;
+        restart();
+    }
+}
+
+/**
+ * @brief Cost of the shortest path from the given cell to the goal.
+ * @param row the cell row
+ * @param col the cell column
+ * @return the path cost, infinity if the goal can't be reached from there
+ */
+double FlowField::distance(int row, int col)
+{
+    refresh();
+    return expand_until(row, col) ? m_distance[cell_index(row, col)] : numeric_limits<double>::infinity();
+}
+
+/**
+ * @brief The first step of the shortest path from the given cell to the goal.
+ * @param row the cell row
+ * @param col the cell column
+ * @return the direction to move to, to be decoded with row_step() and col_step(),
+ * or no_direction at the goal itself and where it can't be reached from
+ */
+int FlowField::direction(int row, int col)
+{
+    refresh();
+    if (!expand_until(row, col)) {
+        return no_direction;
+    }
+    const auto direction = m_direction[cell_index(row, col)];
+    return direction == none ? no_direction : direction;
+}
+
+/**
+ * @brief Walks the field from the given start to the goal.
+ * @param start where to start walking from
+ * @return null if the goal can't be reached, the reversed path otherwise, like AStarSolver::find.
+ */
+FlowField::NodePtr FlowField::find(NodePtr start)
+{
+    refresh();
+    if (!expand_until(start->row(), start->col())) {
+        return nullptr;
+    }
+
+    // the costs along the path are what is left to travel, taken from the start distance
+    const double total = m_distance[cell_index(start->row(), start->col())];
+    start->set_cost(0.0);
+    start->set_parent(nullptr);
+
+    auto node = start;
+    int row = start->row();
+    int col = start->col();
+    for (auto direction = m_direction[cell_index(row, col)]; direction != none; direction = m_direction[cell_index(row, col)]) {
+        row += row_step(direction);
+        col += col_step(direction);
+
+        auto next = make_shared<Node>(row, col);
+        next->set_cost(total - m_distance[cell_index(row, col)]);
+        next->set_parent(node);
+        node = next;
+    }
+
+    return node;
+}
+
+/**
+ * @brief Settles every cell that can reach the goal, afterwards no request needs to search anymore.
+ */
+void FlowField::expand_all()
+{
+    refresh();
+    while (!m_open_list.empty()) {
+        expand();
+    }
+}
+
+/**
+ * @brief When following a live map, starts over if any cell was blocked or unblocked.
+ */
+void FlowField::refresh()
+{
+    assert(m_goal_row >= 0 && m_goal_col >= 0);
+    if (m_map != nullptr && m_map->passability_version() != m_snapshot->passability_version()) {
+        m_snapshot = m_map->snapshot();
+        restart();
+    }
+}
+
+/**
+ * @brief Drops the whole field, and seeds the search again with the goal.
+ */
+void FlowField::restart()
+{
+    const size_t cells = static_cast<size_t>(m_snapshot->rows()) * m_snapshot->columns();
+    if (cells != m_distance.size()) {
+        m_open_list.reset(cells);
+    }
+    else {
+        m_open_list.clear();
+    }
+    m_distance.assign(cells, unreached);
+    m_direction.assign(cells, none);
+    m_settled = 0;
+
+    if (m_goal_row < 0 || m_goal_row >= m_snapshot->rows() || m_goal_col < 0 || m_goal_col >= m_snapshot->columns()) {
+        // the map was resized and the goal is gone
+        return;
+    }
+
+    if (m_snapshot->passable(m_goal_row, m_goal_col)) {
+        const auto goal = cell_index(m_goal_row, m_goal_col);
+        m_distance[goal] = 0.0f;
+        m_open_list.push(goal, 0.0);
+    }
+}
+
+/**
+ * @brief Settles the closest open cell, updating its neighbours.
+ * The moves are symmetric, so the distance from a neighbour to the goal
+ * through this cell is the same as the forward one.
+ */
+void FlowField::expand()
+{
+    const auto current = static_cast<uint32_t>(m_open_list.pop());
+    ++m_settled;
+
+    const int columns = m_snapshot->columns();
+    const int row = static_cast<int>(current) / columns;
+    const int col = static_cast<int>(current) % columns;
+    const float cost = m_distance[current];
+
+    for (int direction = 0; direction < 9; ++direction) {
+        const int next_row = row + row_step(direction);
+        const int next_col = col + col_step(direction);
+        if (direction == 4 || !m_snapshot->passable(next_row, next_col)) {
+            continue;
+        }
+
+        const uint32_t next = cell_index(next_row, next_col);
+        const float next_cost = cost + static_cast<float>((next_row != row && next_col != col) ? StandardCost::diagonal : StandardCost::straight);
+        if (next_cost < m_distance[next]) {
+            if (m_distance[next] == unreached) {
+                m_open_list.push(next, next_cost);
+            }
+            else {
+                m_open_list.decrease_key(next, next_cost);
+            }
+            m_distance[next] = next_cost;
+            // the neighbour has to move the opposite way to get here
+            m_direction[next] = static_cast<uint8_t>(8 - direction);
+        }
+    }
+}
+
+/**
+ * @brief Resumes the search until the given cell is settled, or nothing else can be reached.
+ * @return true if the cell can reach the goal
+ */
+bool FlowField::expand_until(int row, int col)
+{
+    if (row < 0 || row >= m_snapshot->rows() || col < 0 || col >= m_snapshot->columns() || !m_snapshot->passable(row, col)) {
+        return false;
+    }
+
+    const auto index = cell_index(row, col);
+    while (!settled(index) && !m_open_list.empty()) {
+        expand();
+    }
+    return settled(index);
+}
@@ -0,0 +1,785 @@
+/* HierarchicalSolver.ixx - Hierarchical path finding (HPA*) over a Map
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+export module HierarchicalSolver;
+
+import <memory>;
+import <vector>;
+import <algorithm>;
+import <utility>;
+import <cassert>;
+import <cstddef>;
+import <cstdint>;
+import <cmath>;
+import <limits>;
+
+import Node;
+import Map;
+import OpenList;
+import SearchContext;
+import SearchObserver;
+import SearchPolicies;
+
+export namespace AStarLib {
+
+    /**
+     * Hierarchical path finding, following HPA* (Botea, Muller and Schaeffer, 2004).
+     *
+     * The map is split into square clusters. Cells where a path can cross from one
+     * cluster into another become entrances, and the distances between entrances of
+     * the same cluster are precomputed. Queries search this much smaller abstract
+     * graph first, and then only refine the cluster crossings along the way into
+     * cells.
+     *
+     * The paths are near optimal, usually within a few percent of the AStarSolver ones.
+     *
+     * Every search first looks at the cells changed on the map since the previous one,
+     * see Map::changes_since(), and only the clusters around the cells that got blocked
+     * or unblocked are rebuilt. When the change log doesn't go back that far, or the map
+     * was reloaded, the whole graph is rebuilt.
+     *
+     * Observers and stats() only cover the abstract search, over the entrances.
+     */
+    export class HierarchicalSolver
+    {
+    public:
+        using NodePtr = std::shared_ptr<Node>;
+        explicit HierarchicalSolver(Map& map, int cluster_size = 16);
+
+        NodePtr find(NodePtr start, NodePtr goal);
+
+        template<SearchObserver Observer>
+        NodePtr find(NodePtr start, NodePtr goal, Observer& observer);
+
+        const SearchStats& stats() const noexcept { return m_stats; }
+
+        void cell_changed(int row, int col);
+        void rebuild();
+        void sync();
+
+        int cluster_size() const noexcept { return m_cluster_size; }
+        std::size_t abstract_nodes() const noexcept;
+
+    private:
+        struct Edge {
+            std::uint32_t to;
+            double cost;
+        };
+
+        struct Cluster {
+            int row, col, rows, cols;
+            bool dirty;
+            std::vector<Edge> crossings;                // from an entrance of this cluster, stored on the edge
+            std::vector<std::uint32_t> crossing_from;   // the entrance each crossing leaves from
+            std::vector<std::uint32_t> entrances;
+            std::vector<std::vector<Edge>> edges;       // per entrance, intra and inter cluster edges
+        };
+
+        static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+
+        Map& m_map;
+
+        // the map versions the graph was last brought up to date with
+        std::uint64_t m_change_version = 0;
+        std::uint64_t m_passability_version = 0;
+        std::vector<std::pair<int, int>> m_changed;
+
+        int m_cluster_size;
+        int m_rows, m_cols;
+        int m_cluster_rows, m_cluster_cols;
+        std::vector<Cluster> m_clusters;
+        std::vector<int> m_dirty;
+
+        // area searched directly when the start and the goal are on neighbouring clusters
+        Cluster m_window;
+
+        // per cell, the component label inside its cluster and the entrance slot
+        std::vector<std::uint32_t> m_component;
+        std::vector<std::uint32_t> m_slot;
+
+        SearchContext m_abstract;
+        SearchContext m_local;
+        SearchStats m_stats;
+        std::vector<Edge> m_start_edges;
+        std::vector<double> m_goal_distance;
+        std::vector<std::uint32_t> m_abstract_path;
+        std::vector<std::uint32_t> m_segment;
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> m_pairs;
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> m_connected;
+
+        int cluster_of(int row, int col) const noexcept {
+            return (row / m_cluster_size) * m_cluster_cols + col / m_cluster_size;
+        }
+
+        std::uint32_t cell_index(int row, int col) const noexcept {
+            return static_cast<std::uint32_t>(row * m_cols + col);
+        }
+
+        void update();
+        void label_components(Cluster& cluster);
+        void border_crossings(int first, int second, std::vector<std::pair<std::uint32_t, std::uint32_t>>& pairs);
+        void build_crossings(int id);
+        void build_edges(Cluster& cluster);
+        bool local_search(const Cluster& cluster, std::uint32_t from, std::uint32_t target);
+        NodePtr build_path(NodePtr start, const Node& target);
+
+        template<typename Observer>
+        bool search(NodePtr start, const Node& goal, Observer& observer, NodePtr& path);
+
+        template<typename Observer>
+        bool abstract_search(std::uint32_t start, std::uint32_t goal, const Node& target, Observer& observer);
+
+        double estimate(int row, int col, const Node& goal) const noexcept;
+    };
+}
+
+// make the standard C++ library available on the local namespace
+using namespace std;
+
+// also to reduce typing
+using namespace AStarLib;
+
+namespace {
+    double step_cost(int from_row, int from_col, int to_row, int to_col) noexcept
+    {
+        return (from_row != to_row && from_col != to_col) ? StandardCost::diagonal : StandardCost::straight;
+    }
+
+    // entrances longer than this get one transition at each end, instead of one in the middle
+    constexpr size_t long_entrance = 6;
+}
+
+/**
+ * @brief Builds the abstract graph for the given map.
+ * @param map the map to search on
+ * @param cluster_size the width and height of each cluster, in cells
+ */
+HierarchicalSolver::HierarchicalSolver(Map& map, int cluster_size) : m_map(map), m_cluster_size(cluster_size),
+    m_rows(0), m_cols(0), m_cluster_rows(0), m_cluster_cols(0)
+{
+    assert(cluster_size > 1);
+    rebuild();
+}
+
+/**
+ * @brief Throws away the whole abstract graph and builds it again, required after Map::load.
+ */
+void HierarchicalSolver::rebuild()
+{
+    // read before the map, so that edits made meanwhile are picked up by the next sync()
+    m_change_version = m_map.version();
+    m_passability_version = m_map.passability_version();
+
+    m_rows = m_map.rows();
+    m_cols = m_map.columns();
+    m_cluster_rows = (m_rows + m_cluster_size - 1) / m_cluster_size;
+    m_cluster_cols = (m_cols + m_cluster_size - 1) / m_cluster_size;
+
+    const size_t cells = static_cast<size_t>(m_rows) * m_cols;
+    m_component.assign(cells, none);
+    m_slot.assign(cells, none);
+
+    m_clusters.clear();
+    m_clusters.resize(static_cast<size_t>(m_cluster_rows) * m_cluster_cols);
+    m_dirty.clear();
+
+    for (int id = 0; id < static_cast<int>(m_clusters.size()); ++id) {
+        auto& cluster = m_clusters[id];
+        cluster.row = (id / m_cluster_cols) * m_cluster_size;
+        cluster.col = (id % m_cluster_cols) * m_cluster_size;
+        cluster.rows = min(m_cluster_size, m_rows - cluster.row);
+        cluster.cols = min(m_cluster_size, m_cols - cluster.col);
+        cluster.dirty = true;
+        m_dirty.push_back(id);
+    }
+
+    update();
+}
+
+/**
+ * @brief Brings the graph up to date with the map, rebuilding only the clusters around
+ * the cells that got blocked or unblocked since the last time. Called by find().
+ */
+void HierarchicalSolver::sync()
+{
+    // a passability change bumps both counters, the plane one first
+    const auto version = m_map.version();
+    const auto passability = m_map.passability_version();
+    if (m_rows != m_map.rows() || m_cols != m_map.columns()) {
+        rebuild();
+        return;
+    }
+    if (passability == m_passability_version) {
+        m_change_version = version;
+        return;
+    }
+
+    const auto changes = m_map.changes_since(m_change_version, m_changed);
+    if (changes.everything) {
+        rebuild();
+        return;
+    }
+
+    // visited and path cells are on the log as well, only flipped ones matter
+    for (const auto& [row, col] : m_changed) {
+        if (m_map.passable(row, col) != (m_component[cell_index(row, col)] != none)) {
+            cell_changed(row, col);
+        }
+    }
+    m_change_version = changes.version;
+    m_passability_version = passability;
+}
+
+/**
+ * @brief Forces the clusters around a cell to be rebuilt before the next search.
+ * Changes made through the map are already found by sync(), this is only needed
+ * when the graph must be rebuilt for some other reason.
+ */
+void HierarchicalSolver::cell_changed(int row, int col)
+{
+    if (row < 0 || row >= m_rows || col < 0 || col >= m_cols) {
+        return;
+    }
+
+    auto& cluster = m_clusters[cluster_of(row, col)];
+    if (!cluster.dirty) {
+        cluster.dirty = true;
+        m_dirty.push_back(cluster_of(row, col));
+    }
+}
+
+/**
+ * @brief The amount of entrances on the abstract graph.
+ */
+size_t HierarchicalSolver::abstract_nodes() const noexcept
+{
+    size_t count = 0;
+    for (const auto& cluster : m_clusters) {
+        count += cluster.entrances.size();
+    }
+    return count;
+}
+
+/**
+ * Rebuilds the dirty clusters, and their neighbours, as they share the entrances.
+ */
+void HierarchicalSolver::update()
+{
+    if (m_dirty.empty()) {
+        return;
+    }
+
+    vector<int> affected;
+    for (const int id : m_dirty) {
+        label_components(m_clusters[id]);
+
+        const int cluster_row = id / m_cluster_cols;
+        const int cluster_col = id % m_cluster_cols;
+        for (int r = max(cluster_row - 1, 0); r <= min(cluster_row + 1, m_cluster_rows - 1); ++r) {
+            for (int c = max(cluster_col - 1, 0); c <= min(cluster_col + 1, m_cluster_cols - 1); ++c) {
+                affected.push_back(r * m_cluster_cols + c);
+            }
+        }
+    }
+    sort(affected.begin(), affected.end());
+    affected.erase(unique(affected.begin(), affected.end()), affected.end());
+
+    for (const int id : affected) {
+        for (const auto cell : m_clusters[id].entrances) {
+            m_slot[cell] = none;
+        }
+        build_crossings(id);
+    }
+    for (const int id : affected) {
+        build_edges(m_clusters[id]);
+    }
+
+    for (const int id : m_dirty) {
+        m_clusters[id].dirty = false;
+    }
+    m_dirty.clear();
+}
+
+/**
+ * Labels the connected areas inside the cluster, using the first cell of each area as label.
+ */
+void HierarchicalSolver::label_components(Cluster& cluster)
+{
+    vector<uint32_t> pending;
+
+    for (int row = cluster.row; row < cluster.row + cluster.rows; ++row) {
+        for (int col = cluster.col; col < cluster.col + cluster.cols; ++col) {
+            m_component[cell_index(row, col)] = none;
+        }
+    }
+
+    for (int row = cluster.row; row < cluster.row + cluster.rows; ++row) {
+        for (int col = cluster.col; col < cluster.col + cluster.cols; ++col) {
+            const uint32_t first = cell_index(row, col);
+            if (m_component[first] != none || !m_map.passable(row, col)) {
+                continue;
+            }
+
+            m_component[first] = first;
+            pending.push_back(first);
+            while (!pending.empty()) {
+                const uint32_t cell = pending.back();
+                pending.pop_back();
+
+                const int cell_row = cell / m_cols;
+                const int cell_col = cell % m_cols;
+                for (int r = max(cell_row - 1, cluster.row); r <= min(cell_row + 1, cluster.row + cluster.rows - 1); ++r) {
+                    for (int c = max(cell_col - 1, cluster.col); c <= min(cell_col + 1, cluster.col + cluster.cols - 1); ++c) {
+                        const uint32_t next = cell_index(r, c);
+                        if (m_component[next] == none && m_map.passable(r, c)) {
+                            m_component[next] = first;
+                            pending.push_back(next);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Finds the cells where paths cross from the first cluster into the second one, which must
+ * be at its east, south, south east or south west. The same pairs are returned no matter
+ * which of the clusters is being rebuilt.
+ */
+void HierarchicalSolver::border_crossings(int first, int second, vector<pair<uint32_t, uint32_t>>& pairs)
+{
+    const auto& a = m_clusters[first];
+    const auto& b = m_clusters[second];
+
+    pairs.clear();
+    m_connected.clear();
+
+    const auto connected = [this](uint32_t from, uint32_t to) {
+        return std::find(m_connected.begin(), m_connected.end(), make_pair(m_component[from], m_component[to])) != m_connected.end();
+    };
+    const auto add = [this, &pairs](uint32_t from, uint32_t to) {
+        pairs.emplace_back(from, to);
+        m_connected.emplace_back(m_component[from], m_component[to]);
+    };
+    const auto valid = [this](uint32_t from, uint32_t to) {
+        return m_component[from] != none && m_component[to] != none;
+    };
+
+    if (b.row == a.row || b.col == a.col) {
+        // a straight border, walked along with position i
+        const bool east = b.row == a.row;
+        const int length = east ? a.rows : a.cols;
+        const auto cell_a = [&](int i) { return east ? cell_index(a.row + i, a.col + a.cols - 1) : cell_index(a.row + a.rows - 1, a.col + i); };
+        const auto cell_b = [&](int i) { return east ? cell_index(b.row + i, b.col) : cell_index(b.row, b.col + i); };
+
+        // runs of facing cells, between the same pair of areas
+        int run_start = 0;
+        for (int i = 0; i <= length; ++i) {
+            const bool inside = i < length && valid(cell_a(i), cell_b(i));
+            const bool same_run = inside && i > run_start &&
+                m_component[cell_a(i)] == m_component[cell_a(i - 1)] &&
+                m_component[cell_b(i)] == m_component[cell_b(i - 1)];
+
+            if (!same_run) {
+                if (i > run_start) {
+                    const size_t run = static_cast<size_t>(i - run_start);
+                    if (run < long_entrance) {
+                        const int middle = run_start + static_cast<int>(run / 2);
+                        add(cell_a(middle), cell_b(middle));
+                    }
+                    else {
+                        add(cell_a(run_start), cell_b(run_start));
+                        add(cell_a(i - 1), cell_b(i - 1));
+                    }
+                }
+                run_start = inside ? i : i + 1;
+            }
+        }
+
+        // diagonal steps are only needed between areas that are not connected yet
+        for (int i = 0; i + 1 < length; ++i) {
+            if (valid(cell_a(i), cell_b(i + 1)) && !connected(cell_a(i), cell_b(i + 1))) {
+                add(cell_a(i), cell_b(i + 1));
+            }
+            if (valid(cell_a(i + 1), cell_b(i)) && !connected(cell_a(i + 1), cell_b(i))) {
+                add(cell_a(i + 1), cell_b(i));
+            }
+        }
+    }
+    else {
+        // clusters touching at a corner
+        const int row = a.row + a.rows - 1;
+        const uint32_t from = b.col > a.col ? cell_index(row, a.col + a.cols - 1) : cell_index(row, a.col);
+        const uint32_t to = b.col > a.col ? cell_index(b.row, b.col) : cell_index(b.row, b.col + b.cols - 1);
+        if (valid(from, to)) {
+            add(from, to);
+        }
+    }
+}
+
+/**
+ * Collects the crossings leaving the given cluster into its eight neighbours.
+ */
+void HierarchicalSolver::build_crossings(int id)
+{
+    auto& cluster = m_clusters[id];
+    cluster.crossings.clear();
+    cluster.crossing_from.clear();
+
+    const int cluster_row = id / m_cluster_cols;
+    const int cluster_col = id % m_cluster_cols;
+
+    for (int dr = -1; dr <= 1; ++dr) {
+        for (int dc = -1; dc <= 1; ++dc) {
+            const int r = cluster_row + dr;
+            const int c = cluster_col + dc;
+            if ((dr == 0 && dc == 0) || r < 0 || r >= m_cluster_rows || c < 0 || c >= m_cluster_cols) {
+                continue;
+            }
+
+            // always compute from the same side, so both clusters agree on the crossings
+            const int other = r * m_cluster_cols + c;
+            const bool forward = dr > 0 || (dr == 0 && dc > 0);
+            border_crossings(forward ? id : other, forward ? other : id, m_pairs);
+
+            for (const auto& [first, second] : m_pairs) {
+                const uint32_t from = forward ? first : second;
+                const uint32_t to = forward ? second : first;
+                cluster.crossing_from.push_back(from);
+                cluster.crossings.push_back({ to, step_cost(from / m_cols, from % m_cols, to / m_cols, to % m_cols) });
+            }
+        }
+    }
+}
+
+/**
+ * Computes the entrances of the cluster and the edges leaving each one of them.
+ */
+void HierarchicalSolver::build_edges(Cluster& cluster)
+{
+    cluster.entrances = cluster.crossing_from;
+    sort(cluster.entrances.begin(), cluster.entrances.end());
+    cluster.entrances.erase(unique(cluster.entrances.begin(), cluster.entrances.end()), cluster.entrances.end());
+
+    for (uint32_t slot = 0; slot < cluster.entrances.size(); ++slot) {
+        m_slot[cluster.entrances[slot]] = slot;
+    }
+
+    cluster.edges.assign(cluster.entrances.size(), {});
+    for (size_t i = 0; i < cluster.crossings.size(); ++i) {
+        cluster.edges[m_slot[cluster.crossing_from[i]]].push_back(cluster.crossings[i]);
+    }
+
+    for (uint32_t slot = 0; slot < cluster.entrances.size(); ++slot) {
+        const uint32_t from = cluster.entrances[slot];
+        local_search(cluster, from, none);
+
+        for (const auto to : cluster.entrances) {
+            if (to != from && m_local.state(to) == SearchContext::CellState::CLOSED) {
+                cluster.edges[slot].push_back({ to, m_local.cost(to) });
+            }
+        }
+    }
+}
+
+/**
+ * Dijkstra search restricted to a single cluster, the results are left on m_local.
+ * @param target stop as soon as this cell is reached, none to search the whole cluster.
+ * @return true when the target was reached, never for none.
+ */
+bool HierarchicalSolver::local_search(const Cluster& cluster, uint32_t from, uint32_t target)
+{
+    m_local.prepare(static_cast<size_t>(m_rows) * m_cols);
+    auto& open_list = m_local.open_list();
+
+    m_local.open(from, 0.0, SearchContext::no_parent);
+    open_list.push(from, 0.0);
+
+    while (!open_list.empty()) {
+        const uint32_t current = static_cast<uint32_t>(open_list.pop());
+        m_local.close(current);
+        if (current == target) {
+            return true;
+        }
+
+        const int row = current / m_cols;
+        const int col = current % m_cols;
+        for (int r = max(row - 1, cluster.row); r <= min(row + 1, cluster.row + cluster.rows - 1); ++r) {
+            for (int c = max(col - 1, cluster.col); c <= min(col + 1, cluster.col + cluster.cols - 1); ++c) {
+                const uint32_t next = cell_index(r, c);
+                if (next == current || !m_map.passable(r, c)) {
+                    continue;
+                }
+
+                const auto state = m_local.state(next);
+                const double cost = m_local.cost(current) + step_cost(row, col, r, c);
+                if (state == SearchContext::CellState::UNSEEN) {
+                    m_local.open(next, cost, current);
+                    open_list.push(next, cost);
+                }
+                else if (state == SearchContext::CellState::OPEN && cost < m_local.cost(next)) {
+                    m_local.update(next, cost, current);
+                    open_list.decrease_key(next, cost);
+                }
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * HPA* search function
+ *
+ * @param start where to start searching from
+ * @param goal   the target destination
+ * @return null if nothing was found, the reversed path otherwise.
+ */
+HierarchicalSolver::NodePtr HierarchicalSolver::find(NodePtr start, NodePtr goal)
+{
+    NullObserver observer;
+    return find(start, goal, observer);
+}
+
+/**
+ * HPA* search function, reporting the abstract search progress to the given observer.
+ *
+ * @param start where to start searching from
+ * @param goal   the target destination
+ * @param observer called on every open list change and expansion of the abstract search
+ * @return null if nothing was found, the reversed path otherwise.
+ */
+template<SearchObserver Observer>
+HierarchicalSolver::NodePtr HierarchicalSolver::find(NodePtr start, NodePtr goal, Observer& observer)
+{
+    m_stats = {};
+    sync();
+    update();
+
+    if (!m_map.passable(start->row(), start->col()) || !m_map.passable(goal->row(), goal->col())) {
+        return nullptr;
+    }
+
+    // a graph that does not match the map can't be refined, it is rebuilt once and searched again
+    NodePtr path;
+    if (!search(start, *goal, observer, path)) {
+        rebuild();
+        search(start, *goal, observer, path);
+    }
+    return path;
+}
+
+/**
+ * Connects the start and the goal to the graph, searches it and refines the result.
+ * @param path receives the reversed path, null if nothing was found.
+ * @return false when the abstract path could not be refined into cells.
+ */
+template<typename Observer>
+bool HierarchicalSolver::search(NodePtr start, const Node& goal, Observer& observer, NodePtr& path)
+{
+    path = nullptr;
+
+    const uint32_t start_index = cell_index(start->row(), start->col());
+    const uint32_t goal_index = cell_index(goal.row(), goal.col());
+    const auto& start_cluster = m_clusters[cluster_of(start->row(), start->col())];
+    const auto& goal_cluster = m_clusters[cluster_of(goal.row(), goal.col())];
+
+    // connect the goal to the entrances of its cluster
+    local_search(goal_cluster, goal_index, none);
+    m_goal_distance.assign(goal_cluster.entrances.size(), numeric_limits<double>::infinity());
+    for (size_t slot = 0; slot < goal_cluster.entrances.size(); ++slot) {
+        if (m_local.state(goal_cluster.entrances[slot]) == SearchContext::CellState::CLOSED) {
+            m_goal_distance[slot] = m_local.cost(goal_cluster.entrances[slot]);
+        }
+    }
+
+    // and the start to the entrances of its own
+    local_search(start_cluster, start_index, none);
+    m_start_edges.clear();
+    for (const auto entrance : start_cluster.entrances) {
+        if (m_local.state(entrance) == SearchContext::CellState::CLOSED) {
+            m_start_edges.push_back({ entrance, m_local.cost(entrance) });
+        }
+    }
+
+    // short paths through entrances can be quite bad, so also look for a direct one
+    m_window.row = min(start_cluster.row, goal_cluster.row);
+    m_window.col = min(start_cluster.col, goal_cluster.col);
+    m_window.rows = max(start_cluster.row + start_cluster.rows, goal_cluster.row + goal_cluster.rows) - m_window.row;
+    m_window.cols = max(start_cluster.col + start_cluster.cols, goal_cluster.col + goal_cluster.cols) - m_window.col;
+    if (m_window.rows <= 2 * m_cluster_size && m_window.cols <= 2 * m_cluster_size) {
+        local_search(m_window, start_index, goal_index);
+        if (m_local.state(goal_index) == SearchContext::CellState::CLOSED) {
+            m_start_edges.push_back({ goal_index, m_local.cost(goal_index) });
+        }
+    }
+
+    if (!abstract_search(start_index, goal_index, goal, observer)) {
+        return true;
+    }
+
+    path = build_path(start, goal);
+    return path != nullptr;
+}
+
+/**
+ * A* over the entrances, leaving the abstract path from the goal to the start on m_abstract_path.
+ */
+template<typename Observer>
+bool HierarchicalSolver::abstract_search(uint32_t start, uint32_t goal, const Node& target, Observer& observer)
+{
+    SearchTimer timer(m_stats.elapsed);
+    const auto& goal_cluster = m_clusters[cluster_of(target.row(), target.col())];
+
+    m_abstract.prepare(static_cast<size_t>(m_rows) * m_cols);
+    auto& open_list = m_abstract.open_list();
+
+    const double start_key = estimate(start / m_cols, start % m_cols, target);
+    m_abstract.open(start, 0.0, SearchContext::no_parent);
+    open_list.push(start, start_key);
+    observer.on_push(start / m_cols, start % m_cols, start_key);
+    ++m_stats.pushes;
+
+    const auto relax = [&](uint32_t current, uint32_t next, double step) {
+        const auto state = m_abstract.state(next);
+        const double cost = m_abstract.cost(current) + step;
+        if (state == SearchContext::CellState::UNSEEN) {
+            const double key = cost + estimate(next / m_cols, next % m_cols, target);
+            m_abstract.open(next, cost, current);
+            open_list.push(next, key);
+            observer.on_push(next / m_cols, next % m_cols, key);
+            ++m_stats.pushes;
+        }
+        else if (state == SearchContext::CellState::OPEN && cost < m_abstract.cost(next)) {
+            const double key = cost + estimate(next / m_cols, next % m_cols, target);
+            m_abstract.update(next, cost, current);
+            open_list.decrease_key(next, key);
+            observer.on_decrease_key(next / m_cols, next % m_cols, key);
+            ++m_stats.decrease_keys;
+        }
+    };
+
+    while (!open_list.empty()) {
+        m_stats.peak_open = max(m_stats.peak_open, open_list.size());
+
+        const uint32_t current = static_cast<uint32_t>(open_list.pop());
+        m_abstract.close(current);
+        ++m_stats.pops;
+        observer.on_close(current / m_cols, current % m_cols);
+
+        if (current == goal) {
+            m_abstract_path.clear();
+            for (uint32_t cell = goal; cell != SearchContext::no_parent; cell = m_abstract.parent(cell)) {
+                m_abstract_path.push_back(cell);
+            }
+            return true;
+        }
+
+        ++m_stats.expansions;
+        observer.on_expand(current / m_cols, current % m_cols, m_abstract.cost(current));
+
+        if (current == start) {
+            for (const auto& edge : m_start_edges) {
+                relax(current, edge.to, edge.cost);
+            }
+        }
+
+        const uint32_t slot = m_slot[current];
+        if (slot == none) {
+            continue;
+        }
+
+        const auto& cluster = m_clusters[cluster_of(current / m_cols, current % m_cols)];
+        for (const auto& edge : cluster.edges[slot]) {
+            relax(current, edge.to, edge.cost);
+        }
+        if (&cluster == &goal_cluster && m_goal_distance[slot] < numeric_limits<double>::infinity()) {
+            relax(current, goal, m_goal_distance[slot]);
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Refines the abstract path into cells, searching inside each cluster it goes through.
+ * @param start the node where the search started, it becomes the end of the chain.
+ * @param target the goal node, used to fill in the estimations.
+ * @return the node for the goal cell, null when a segment can't be walked on the map,
+ * which means the graph is out of date.
+ */
+HierarchicalSolver::NodePtr HierarchicalSolver::build_path(NodePtr start, const Node& target)
+{
+    start->set_cost(0.0);
+    start->set_estimation(estimate(start->row(), start->col(), target));
+    start->set_parent(nullptr);
+
+    const uint32_t goal = m_abstract_path.front();
+
+    NodePtr current = start;
+    for (auto to = m_abstract_path.rbegin() + 1; to != m_abstract_path.rend(); ++to) {
+        const uint32_t from = cell_index(current->row(), current->col());
+        const int from_cluster = cluster_of(current->row(), current->col());
+
+        m_segment.clear();
+        if (current == start && *to == goal) {
+            // the direct path found on the search window
+            if (!local_search(m_window, from, *to)) {
+                return nullptr;
+            }
+        }
+        else if (from_cluster != cluster_of(*to / m_cols, *to % m_cols)) {
+            // crossing into the next cluster
+            if (!m_map.passable(*to / m_cols, *to % m_cols)) {
+                return nullptr;
+            }
+            m_segment.push_back(*to);
+        }
+        else if (!local_search(m_clusters[from_cluster], from, *to)) {
+            return nullptr;
+        }
+
+        if (m_segment.empty()) {
+            for (uint32_t cell = *to; cell != from; cell = m_local.parent(cell)) {
+                m_segment.push_back(cell);
+            }
+            reverse(m_segment.begin(), m_segment.end());
+        }
+
+        for (const auto cell : m_segment) {
+            const int row = cell / m_cols;
+            const int col = cell % m_cols;
+
+            auto node = make_shared<Node>(row, col);
+            node->set_cost(current->cost() + step_cost(current->row(), current->col(), row, col));
+            node->set_estimation(estimate(row, col, target));
+            node->set_parent(current);
+            current = std::move(node);
+        }
+    }
+
+    return current;
+}
+
+/**
+ * Heuristic function, the same one AStarSolver uses.
+ */
+double HierarchicalSolver::estimate(int row, int col, const Node& goal) const noexcept
+{
+    return EuclideanHeuristic::estimate<StandardCost>(abs(col - goal.col()), abs(row - goal.row()));
+}
@@ -0,0 +1,477 @@
+/* IncrementalSolver.ixx - Replanning with D* Lite as the map changes
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+export module IncrementalSolver;
+
+import <memory>;
+import <vector>;
+import <algorithm>;
+import <span>;
+import <utility>;
+import <cassert>;
+import <cstddef>;
+import <cstdint>;
+import <cmath>;
+import <limits>;
+
+import Node;
+import Map;
+import OpenList;
+import SearchContext;
+import SearchObserver;
+import SearchPolicies;
+
+export namespace AStarLib {
+
+    /**
+     * Searchs for paths with D* Lite (Koenig and Likhachev, 2002), keeping the search
+     * state between calls so that map edits only cost what they actually change.
+     *
+     * The search runs backward from the goal, so the start can move along the path
+     * between calls without invalidating anything. The cells blocked or unblocked since
+     * the last search are taken from Map::changes_since(), and only the part of the
+     * previous search that depends on them is repaired. Asking for another goal, or
+     * edits the log no longer goes back to, start over from scratch.
+     *
+     * The map is only read, through its lock free passability plane.
+     *
+     * Observers see the backward search: the costs are towards the goal, and cells
+     * whose key went up, which D* Lite does when repairing, are reported as pushed again.
+     */
+    export class IncrementalSolver
+    {
+    public:
+        using NodePtr = std::shared_ptr<Node>;
+        explicit IncrementalSolver(const Map& map);
+
+        NodePtr find(NodePtr start, NodePtr goal);
+
+        template<SearchObserver Observer>
+        NodePtr find(NodePtr start, NodePtr goal, Observer& observer);
+
+        void cells_changed(std::span<const std::pair<int, int>> cells);
+        void cell_changed(int row, int col);
+        void reset() noexcept;
+
+        const SearchStats& stats() const noexcept { return m_stats; }
+
+    private:
+        using Key = std::pair<double, double>;
+
+        static constexpr double infinity = std::numeric_limits<double>::infinity();
+        static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+
+        const Map& m_map;
+        int m_rows, m_cols;
+        std::uint32_t m_start, m_goal;
+        double m_key_offset;
+        std::uint64_t m_change_version = 0;
+        std::uint64_t m_passability_version = 0;
+        std::vector<std::pair<int, int>> m_changed;
+        std::vector<double> m_g;
+        std::vector<double> m_rhs;
+        BasicIndexedHeap<Key> m_open_list;
+        SearchStats m_stats;
+
+        int row_of(std::uint32_t cell) const noexcept { return static_cast<int>(cell) / m_cols; }
+        int col_of(std::uint32_t cell) const noexcept { return static_cast<int>(cell) % m_cols; }
+
+        void sync();
+        void initialize(std::uint32_t start, std::uint32_t goal);
+
+        // the goal is the only cell not depending on its neighbours, unless it got blocked
+        double goal_cost() const noexcept { return m_map.passable(row_of(m_goal), col_of(m_goal)) ? 0.0 : infinity; }
+
+        Key calculate_key(std::uint32_t cell) const noexcept;
+
+        template<typename Observer>
+        void update_cell(std::uint32_t cell, Observer& observer);
+
+        double best_successor(std::uint32_t cell, std::uint32_t& next) const noexcept;
+
+        template<typename Observer>
+        void compute_shortest_path(Observer& observer);
+
+        NodePtr build_path(NodePtr start, const Node& goal) const;
+
+        double movement_cost(std::uint32_t from, std::uint32_t to) const noexcept;
+        double estimate(std::uint32_t from, std::uint32_t to) const noexcept;
+    };
+}
+
+// make the standard C++ library available on the local namespace
+using namespace std;
+
+// also to reduce typing
+using namespace AStarLib;
+
+
+/**
+ * D* Lite search function, reporting its progress to the given observer.
+ * Repairs the previous search when the goal is the same one, and the map size is unchanged.
+ *
+ * @param start where to start searching from
+ * @param goal   the target destination
+ * @param observer called on every open list change and expansion, only for the cells repaired
+ * @return null if nothing was found, the reversed path otherwise, like AStarSolver::find.
+ */
+template<SearchObserver Observer>
+IncrementalSolver::NodePtr IncrementalSolver::find(NodePtr start, NodePtr goal, Observer& observer)
+{
+    m_stats = {};
+    SearchTimer timer(m_stats.elapsed);
+
+    if (m_map.rows() != m_rows || m_map.columns() != m_cols) {
+        m_rows = m_map.rows();
+        m_cols = m_map.columns();
+        m_goal = none;
+    }
+    sync();
+
+    const auto start_index = static_cast<uint32_t>(start->row() * m_cols + start->col());
+    const auto goal_index = static_cast<uint32_t>(goal->row() * m_cols + goal->col());
+
+    if (goal_index != m_goal) {
+        initialize(start_index, goal_index);
+    }
+    else if (start_index != m_start) {
+        // the keys already queued are kept, raising all future ones by the distance moved instead
+        m_key_offset += estimate(m_start, start_index);
+        m_start = start_index;
+    }
+
+    // would otherwise flood everything reachable from the goal
+    if (!m_map.passable(start->row(), start->col()) || !m_map.connected(start->row(), start->col(), goal->row(), goal->col())) {
+        return nullptr;
+    }
+
+    compute_shortest_path(observer);
+
+    if (m_g[m_start] == infinity) {
+        return nullptr;
+    }
+    if (auto path = build_path(start, *goal)) {
+        return path;
+    }
+
+    // the kept costs don't match the map anymore, searching again from scratch
+    initialize(start_index, goal_index);
+    compute_shortest_path(observer);
+    return m_g[m_start] == infinity ? nullptr : build_path(start, *goal);
+}
+
+/**
+ * Queues the cell when its cost is out of date, or takes it out of the queue otherwise.
+ */
+template<typename Observer>
+void IncrementalSolver::update_cell(uint32_t cell, Observer& observer)
+{
+    const bool consistent = m_g[cell] == m_rhs[cell];
+    if (!consistent && m_open_list.contains(cell)) {
+        const Key key = calculate_key(cell);
+        if (key < m_open_list.key(cell)) {
+            observer.on_decrease_key(row_of(cell), col_of(cell), key.first);
+        }
+        else {
+            observer.on_push(row_of(cell), col_of(cell), key.first);
+        }
+        m_open_list.update(cell, key);
+    }
+    else if (!consistent) {
+        const Key key = calculate_key(cell);
+        observer.on_push(row_of(cell), col_of(cell), key.first);
+        m_open_list.push(cell, key);
+    }
+    else if (m_open_list.contains(cell)) {
+        m_open_list.remove(cell);
+    }
+}
+
+/**
+ * Expands the queued cells until the start cost is known to be correct.
+ */
+template<typename Observer>
+void IncrementalSolver::compute_shortest_path(Observer& observer)
+{
+    while (!m_open_list.empty() &&
+        (m_open_list.key(m_open_list.top()) < calculate_key(m_start) || m_rhs[m_start] != m_g[m_start])) {
+        m_stats.peak_open = max(m_stats.peak_open, m_open_list.size());
+        ++m_stats.expansions;
+
+        const uint32_t current = static_cast<uint32_t>(m_open_list.top());
+        const Key old_key = m_open_list.key(current);
+        const Key new_key = calculate_key(current);
+        const int row = row_of(current);
+        const int col = col_of(current);
+
+        if (old_key < new_key) {
+            // queued before the start moved, its priority is only a lower bound
+            observer.on_push(row, col, new_key.first);
+            m_open_list.update(current, new_key);
+            continue;
+        }
+
+        observer.on_close(row, col);
+
+        const bool overconsistent = m_g[current] > m_rhs[current];
+        const double old_cost = m_g[current];
+        if (overconsistent) {
+            m_g[current] = m_rhs[current];
+            m_open_list.remove(current);
+        }
+        else {
+            m_g[current] = infinity;
+            update_cell(current, observer);
+        }
+        observer.on_expand(row, col, m_rhs[current]);
+
+        // the cells that move into this one, the moves are symmetric
+        for (int next_row = max(row - 1, 0); next_row <= min(row + 1, m_rows - 1); ++next_row) {
+            for (int next_col = max(col - 1, 0); next_col <= min(col + 1, m_cols - 1); ++next_col) {
+                const auto cell = static_cast<uint32_t>(next_row * m_cols + next_col);
+                if (cell == current || cell == m_goal || !m_map.passable(next_row, next_col)) {
+                    continue;
+                }
+
+                const double cost = movement_cost(cell, current);
+                if (overconsistent) {
+                    m_rhs[cell] = min(m_rhs[cell], cost + m_g[current]);
+                }
+                else if (m_rhs[cell] == cost + old_cost) {
+                    // it was going through this cell, look for its best way again
+                    uint32_t next;
+                    m_rhs[cell] = best_successor(cell, next);
+                }
+                update_cell(cell, observer);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Constructs the solver, the first search is a full one.
+ * @param map the map to search on, it must outlive the solver
+ */
+IncrementalSolver::IncrementalSolver(const Map& map) : m_map(map), m_rows{ 0 }, m_cols{ 0 }, m_start{ none }, m_goal{ none }, m_key_offset{ 0.0 }
+{
+}
+
+/**
+ * D* Lite search function
+ * Repairs the previous search when the goal is the same one, and the map size is unchanged.
+ *
+ * @param start where to start searching from
+ * @param goal   the target destination
+ * @return null if nothing was found, the reversed path otherwise, like AStarSolver::find.
+ */
+IncrementalSolver::NodePtr IncrementalSolver::find(NodePtr start, NodePtr goal)
+{
+    NullObserver observer;
+    return find(std::move(start), std::move(goal), observer);
+}
+
+/**
+ * @brief Reports cells that were blocked or unblocked since the last search.
+ * The cells and their neighbours are updated right away, the search is repaired on the next find.
+ * Edits made through the map are found by find() on its own, reporting them again does no harm.
+ * @param cells the (row, column) of each changed cell
+ */
+void IncrementalSolver::cells_changed(span<const pair<int, int>> cells)
+{
+    if (m_goal == none) {
+        return;
+    }
+
+    NullObserver observer;
+    for (const auto& [row, col] : cells) {
+        assert(row >= 0 && row < m_rows && col >= 0 && col < m_cols);
+
+        // every move into or out of the cell changed its cost
+        for (int next_row = max(row - 1, 0); next_row <= min(row + 1, m_rows - 1); ++next_row) {
+            for (int next_col = max(col - 1, 0); next_col <= min(col + 1, m_cols - 1); ++next_col) {
+                const auto cell = static_cast<uint32_t>(next_row * m_cols + next_col);
+                uint32_t next;
+                m_rhs[cell] = cell == m_goal ? goal_cost() : best_successor(cell, next);
+                update_cell(cell, observer);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Reports a single cell that was blocked or unblocked since the last search.
+ * @param row the cell row
+ * @param col the cell column
+ */
+void IncrementalSolver::cell_changed(int row, int col)
+{
+    const pair<int, int> cell{ row, col };
+    cells_changed(span(&cell, 1));
+}
+
+/**
+ * @brief Forgets the previous search, the next one is done from scratch.
+ */
+void IncrementalSolver::reset() noexcept
+{
+    m_goal = none;
+}
+
+/**
+ * Catches up with the cells flipped since the last search, through the map change log.
+ */
+void IncrementalSolver::sync()
+{
+    // a passability change bumps both counters, the plane one first
+    const auto version = m_map.version();
+    const auto passability = m_map.passability_version();
+    if (passability == m_passability_version) {
+        m_change_version = version;
+        return;
+    }
+
+    const auto changes = m_map.changes_since(m_change_version, m_changed);
+    if (changes.everything) {
+        m_goal = none;
+    }
+    else {
+        // visited and path cells are on the log as well, repairing them changes nothing
+        cells_changed(m_changed);
+    }
+    m_change_version = changes.version;
+    m_passability_version = passability;
+}
+
+/**
+ * Starts a new search towards the given goal.
+ */
+void IncrementalSolver::initialize(uint32_t start, uint32_t goal)
+{
+    const size_t cells = static_cast<size_t>(m_rows) * m_cols;
+    if (m_open_list.capacity() != cells) {
+        m_open_list.reset(cells);
+    }
+    else {
+        m_open_list.clear();
+    }
+    m_g.assign(cells, infinity);
+    m_rhs.assign(cells, infinity);
+
+    m_start = start;
+    m_goal = goal;
+    m_key_offset = 0.0;
+
+    NullObserver observer;
+    m_rhs[goal] = goal_cost();
+    update_cell(goal, observer);
+}
+
+/**
+ * Priority of a cell, first by the estimated path cost through it, then by its own cost.
+ */
+IncrementalSolver::Key IncrementalSolver::calculate_key(uint32_t cell) const noexcept
+{
+    const double cost = min(m_g[cell], m_rhs[cell]);
+    return { cost + estimate(m_start, cell) + m_key_offset, cost };
+}
+
+/**
+ * Cheapest way to reach the goal from the given cell, going through one of its neighbours.
+ * @param cell the cell to move from
+ * @param next receives the neighbour to move to, none when the goal can't be reached
+ * @return the path cost, infinity when the goal can't be reached
+ */
+double IncrementalSolver::best_successor(uint32_t cell, uint32_t& next) const noexcept
+{
+    double best = infinity;
+    next = none;
+
+    const int row = row_of(cell);
+    const int col = col_of(cell);
+    if (!m_map.passable(row, col)) {
+        return best;
+    }
+
+    for (int next_row = row - 1; next_row <= row + 1; ++next_row) {
+        for (int next_col = col - 1; next_col <= col + 1; ++next_col) {
+            // the map border counts as a wall
+            if ((next_row == row && next_col == col) || !m_map.passable(next_row, next_col)) {
+                continue;
+            }
+
+            const auto neighbour = static_cast<uint32_t>(next_row * m_cols + next_col);
+            const double cost = movement_cost(cell, neighbour) + m_g[neighbour];
+            if (cost < best) {
+                best = cost;
+                next = neighbour;
+            }
+        }
+    }
+    return best;
+}
+
+/**
+ * Follows the cheapest neighbour from the start until the goal.
+ * @param start the node where the search started, it becomes the end of the chain.
+ * @param goal the goal node, used to fill in the estimations.
+ * @return the node for the goal cell, null when the costs don't lead there, as after
+ * edits that were missed, where following them could otherwise go round in circles.
+ */
+IncrementalSolver::NodePtr IncrementalSolver::build_path(NodePtr start, const Node& goal) const
+{
+    start->set_cost(0.0);
+    start->set_estimation(estimate(m_start, m_goal));
+    start->set_parent(nullptr);
+
+    NodePtr current = start;
+    double remaining = infinity;
+    for (uint32_t cell = m_start; cell != m_goal;) {
+        // every move costs something, so the cost left has to fall at each step
+        uint32_t next;
+        const double cost = best_successor(cell, next);
+        if (next == none || !(cost < remaining)) {
+            return nullptr;
+        }
+        remaining = cost;
+
+        auto node = make_shared<Node>(row_of(next), col_of(next));
+        node->set_cost(current->cost() + movement_cost(cell, next));
+        node->set_estimation(estimate(next, m_goal));
+        node->set_parent(current);
+        current = std::move(node);
+        cell = next;
+    }
+
+    return current;
+}
+
+/**
+ * Cost function for moving between two neighbour cells, both must be passable.
+ */
+double IncrementalSolver::movement_cost(uint32_t from, uint32_t to) const noexcept
+{
+    return (row_of(from) != row_of(to) && col_of(from) != col_of(to)) ? StandardCost::diagonal : StandardCost::straight;
+}
+
+/**
+ * Heuristic function, the straight line distance between two cells
+ */
+double IncrementalSolver::estimate(uint32_t from, uint32_t to) const noexcept
+{
+    return EuclideanHeuristic::estimate<StandardCost>(abs(col_of(from) - col_of(to)), abs(row_of(from) - row_of(to)));
+}
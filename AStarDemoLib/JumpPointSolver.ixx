@@ -0,0 +1,438 @@
+/* JumpPointSolver.ixx - Jump Point Search solver for uniform cost grids
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+export module JumpPointSolver;
+
+import <memory>;
+import <vector>;
+import <algorithm>;
+import <cassert>;
+import <cstddef>;
+import <cstdint>;
+import <cmath>;
+
+import Node;
+import Map;
+import OpenList;
+import SearchContext;
+import SearchObserver;
+import SearchPolicies;
+
+export namespace AStarLib {
+
+    /**
+     * Searchs for a path with Jump Point Search (Harabor and Grastien, 2011).
+     *
+     * It uses the same movement rules and costs as AStarSolver, so both return paths
+     * with the same cost, but instead of queueing every neighbour it jumps along straight
+     * and diagonal lines until something interesting is found. On open maps this only
+     * expands a small fraction of the cells A* would.
+     *
+     * The returned path contains every cell, not only the jump points, so it can be
+     * used in the same way as the AStarSolver one. Observers only see the jump points.
+     */
+    export class JumpPointSolver
+    {
+    public:
+        using NodePtr = std::shared_ptr<Node>;
+        JumpPointSolver(Map& map);
+        explicit JumpPointSolver(std::shared_ptr<const MapSnapshot> snapshot);
+
+        NodePtr find(NodePtr start, NodePtr goal);
+
+        template<SearchObserver Observer>
+        NodePtr find(NodePtr start, NodePtr goal, Observer& observer);
+
+        const SearchStats& stats() const noexcept { return m_stats; }
+
+    private:
+        struct Direction {
+            int row, col;
+        };
+
+        Map* m_map;
+        std::shared_ptr<const MapSnapshot> m_snapshot;
+        SearchContext m_context;
+        SearchStats m_stats;
+        std::vector<Direction> m_directions;
+        std::vector<std::uint32_t> m_path;
+
+        template<typename Grid, typename Observer>
+        NodePtr search(const Grid& grid, NodePtr start, NodePtr goal, Observer& observer);
+
+        template<typename Grid>
+        void pruned_directions(const Grid& grid, int row, int col, int parent_row, int parent_col);
+
+        template<typename Grid>
+        bool jump(const Grid& grid, int& row, int& col, Direction dir, const Node& goal) const noexcept;
+
+        template<typename Grid>
+        bool jump_straight(const Grid& grid, int row, int col, Direction dir, const Node& goal) const noexcept;
+
+        double estimate(int row, int col, const Node& goal) const noexcept;
+        NodePtr build_path(NodePtr start, std::uint32_t goal, int columns, const Node& target);
+    };
+}
+
+// make the standard C++ library available on the local namespace
+using namespace std;
+
+// also to reduce typing
+using namespace AStarLib;
+
+namespace {
+    /**
+     * Cost of moving along a straight or diagonal line, which is how jump points connect.
+     */
+    double line_cost(int from_row, int from_col, int to_row, int to_col) noexcept
+    {
+        const int dx = abs(from_col - to_col);
+        const int dy = abs(from_row - to_row);
+        return dx != 0 && dy != 0 ? dx * StandardCost::diagonal : (dx + dy) * StandardCost::straight;
+    }
+
+    int sign(int value) noexcept
+    {
+        return (value > 0) - (value < 0);
+    }
+}
+
+
+JumpPointSolver::JumpPointSolver(Map& map) : m_map(&map)
+{
+    m_directions.reserve(8);
+}
+
+/**
+ * @brief Constructs a solver that only reads the given snapshot.
+ * @param snapshot the map contents to search on
+ */
+JumpPointSolver::JumpPointSolver(shared_ptr<const MapSnapshot> snapshot) : m_map(nullptr), m_snapshot(std::move(snapshot))
+{
+    assert(m_snapshot != nullptr);
+    m_directions.reserve(8);
+}
+
+/**
+ * Jump Point Search function
+ *
+ * @param start where to start searching from
+ * @param goal   the target destination
+ * @return null if nothing was found, the reversed path otherwise.
+ */
+JumpPointSolver::NodePtr JumpPointSolver::find(NodePtr start, NodePtr goal)
+{
+    NullObserver observer;
+    return find(start, goal, observer);
+}
+
+/**
+ * Jump Point Search function, reporting its progress to the given observer.
+ *
+ * @param start where to start searching from
+ * @param goal   the target destination
+ * @param observer called on every open list change and expansion of a jump point
+ * @return null if nothing was found, the reversed path otherwise.
+ */
+template<SearchObserver Observer>
+JumpPointSolver::NodePtr JumpPointSolver::find(NodePtr start, NodePtr goal, Observer& observer)
+{
+    if (m_map != nullptr) {
+        return search(*m_map, start, goal, observer);
+    }
+    else {
+        return search(*m_snapshot, start, goal, observer);
+    }
+}
+
+/**
+ * The search itself, shared between live maps and snapshots.
+ */
+template<typename Grid, typename Observer>
+JumpPointSolver::NodePtr JumpPointSolver::search(const Grid& grid, NodePtr start, NodePtr goal, Observer& observer)
+{
+    const int columns = grid.columns();
+    const auto cell_index = [columns](int row, int col) noexcept {
+        return static_cast<uint32_t>(row * columns + col);
+    };
+
+    m_context.prepare(static_cast<size_t>(grid.rows()) * columns);
+    auto& open_list = m_context.open_list();
+    m_stats = {};
+    SearchTimer timer(m_stats.elapsed);
+
+    // otherwise every jump point reachable from the start would be expanded before giving up
+    if (!grid.connected(start->row(), start->col(), goal->row(), goal->col())) {
+        return nullptr;
+    }
+
+    const uint32_t start_index = cell_index(start->row(), start->col());
+    const uint32_t goal_index = cell_index(goal->row(), goal->col());
+
+    const double start_key = estimate(start->row(), start->col(), *goal);
+    m_context.open(start_index, 0.0, SearchContext::no_parent);
+    open_list.push(start_index, start_key);
+    observer.on_push(start->row(), start->col(), start_key);
+    ++m_stats.pushes;
+
+    while (!open_list.empty()) {
+        m_stats.peak_open = max(m_stats.peak_open, open_list.size());
+
+        const uint32_t current = static_cast<uint32_t>(open_list.pop());
+        const int row = current / columns;
+        const int col = current % columns;
+        ++m_stats.pops;
+
+        m_context.close(current);
+        observer.on_close(row, col);
+
+        if (current == goal_index) {
+            return build_path(start, current, columns, *goal);
+        }
+
+        ++m_stats.expansions;
+        observer.on_expand(row, col, m_context.cost(current));
+
+        const uint32_t parent = m_context.parent(current);
+        if (parent == SearchContext::no_parent) {
+            pruned_directions(grid, row, col, row, col);
+        }
+        else {
+            pruned_directions(grid, row, col, parent / columns, parent % columns);
+        }
+
+        for (const auto dir : m_directions) {
+            int next_row = row;
+            int next_col = col;
+            if (!jump(grid, next_row, next_col, dir, *goal)) {
+                continue;
+            }
+
+            const uint32_t next_node = cell_index(next_row, next_col);
+            const auto state = m_context.state(next_node);
+            if (state == SearchContext::CellState::CLOSED) {
+                continue;
+            }
+
+            const double cost = m_context.cost(current) + line_cost(row, col, next_row, next_col);
+
+            if (state == SearchContext::CellState::OPEN) {
+                if (cost < m_context.cost(next_node)) {
+                    const double key = cost + estimate(next_row, next_col, *goal);
+                    m_context.update(next_node, cost, current);
+                    open_list.decrease_key(next_node, key);
+                    observer.on_decrease_key(next_row, next_col, key);
+                    ++m_stats.decrease_keys;
+                }
+            }
+            else {
+                const double key = cost + estimate(next_row, next_col, *goal);
+                m_context.open(next_node, cost, current);
+                open_list.push(next_node, key);
+                observer.on_push(next_row, next_col, key);
+                ++m_stats.pushes;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+/**
+ * Computes the directions worth exploring from a jump point, given where it was reached from.
+ * The start node has itself as parent, and explores all directions.
+ */
+template<typename Grid>
+void JumpPointSolver::pruned_directions(const Grid& grid, int row, int col, int parent_row, int parent_col)
+{
+    m_directions.clear();
+
+    const int dr = sign(row - parent_row);
+    const int dc = sign(col - parent_col);
+
+    if (dr == 0 && dc == 0) {
+        for (int r = -1; r <= 1; ++r) {
+            for (int c = -1; c <= 1; ++c) {
+                if ((r != 0 || c != 0) && grid.passable(row + r, col + c)) {
+                    m_directions.push_back({ r, c });
+                }
+            }
+        }
+    }
+    else if (dr != 0 && dc != 0) {
+        // natural neighbours
+        if (grid.passable(row + dr, col)) {
+            m_directions.push_back({ dr, 0 });
+        }
+        if (grid.passable(row, col + dc)) {
+            m_directions.push_back({ 0, dc });
+        }
+        if (grid.passable(row + dr, col + dc)) {
+            m_directions.push_back({ dr, dc });
+        }
+
+        // forced neighbours
+        if (!grid.passable(row, col - dc) && grid.passable(row + dr, col - dc)) {
+            m_directions.push_back({ dr, -dc });
+        }
+        if (!grid.passable(row - dr, col) && grid.passable(row - dr, col + dc)) {
+            m_directions.push_back({ -dr, dc });
+        }
+    }
+    else if (dc != 0) {
+        if (grid.passable(row, col + dc)) {
+            m_directions.push_back({ 0, dc });
+        }
+        if (!grid.passable(row + 1, col) && grid.passable(row + 1, col + dc)) {
+            m_directions.push_back({ 1, dc });
+        }
+        if (!grid.passable(row - 1, col) && grid.passable(row - 1, col + dc)) {
+            m_directions.push_back({ -1, dc });
+        }
+    }
+    else {
+        if (grid.passable(row + dr, col)) {
+            m_directions.push_back({ dr, 0 });
+        }
+        if (!grid.passable(row, col + 1) && grid.passable(row + dr, col + 1)) {
+            m_directions.push_back({ dr, 1 });
+        }
+        if (!grid.passable(row, col - 1) && grid.passable(row + dr, col - 1)) {
+            m_directions.push_back({ dr, -1 });
+        }
+    }
+}
+
+/**
+ * Moves from the given position along the direction, until a jump point is found.
+ * @param row,col the starting position, updated with the jump point position
+ * @return false if a wall or the map border was reached first.
+ */
+template<typename Grid>
+bool JumpPointSolver::jump(const Grid& grid, int& row, int& col, Direction dir, const Node& goal) const noexcept
+{
+    if (dir.row == 0 || dir.col == 0) {
+        // straight moves are checked in the loop below, without moving
+        while (true) {
+            row += dir.row;
+            col += dir.col;
+
+            if (!grid.passable(row, col)) {
+                return false;
+            }
+            if (row == goal.row() && col == goal.col()) {
+                return true;
+            }
+
+            if (dir.col != 0) {
+                if ((!grid.passable(row + 1, col) && grid.passable(row + 1, col + dir.col)) ||
+                    (!grid.passable(row - 1, col) && grid.passable(row - 1, col + dir.col))) {
+                    return true;
+                }
+            }
+            else {
+                if ((!grid.passable(row, col + 1) && grid.passable(row + dir.row, col + 1)) ||
+                    (!grid.passable(row, col - 1) && grid.passable(row + dir.row, col - 1))) {
+                    return true;
+                }
+            }
+        }
+    }
+
+    while (true) {
+        row += dir.row;
+        col += dir.col;
+
+        if (!grid.passable(row, col)) {
+            return false;
+        }
+        if (row == goal.row() && col == goal.col()) {
+            return true;
+        }
+
+        if ((!grid.passable(row, col - dir.col) && grid.passable(row + dir.row, col - dir.col)) ||
+            (!grid.passable(row - dir.row, col) && grid.passable(row - dir.row, col + dir.col))) {
+            return true;
+        }
+
+        // a diagonal step is a jump point when one of its straight components leads somewhere
+        if (jump_straight(grid, row, col, { 0, dir.col }, goal) ||
+            jump_straight(grid, row, col, { dir.row, 0 }, goal)) {
+            return true;
+        }
+    }
+}
+
+/**
+ * Checks if a straight jump from the given position finds a jump point.
+ */
+template<typename Grid>
+bool JumpPointSolver::jump_straight(const Grid& grid, int row, int col, Direction dir, const Node& goal) const noexcept
+{
+    return jump(grid, row, col, dir, goal);
+}
+
+/**
+ * Converts the jump points into a chain of nodes, filling in the cells between them.
+ * @param start the node where the search started, it becomes the end of the chain.
+ * @param goal the cell where the search ended.
+ * @param columns the width of the searched map.
+ * @param target the goal node, used to fill in the estimations.
+ * @return the node for the goal cell.
+ */
+JumpPointSolver::NodePtr JumpPointSolver::build_path(NodePtr start, uint32_t goal, int columns, const Node& target)
+{
+    m_path.clear();
+    for (uint32_t cell = goal; cell != SearchContext::no_parent; cell = m_context.parent(cell)) {
+        m_path.push_back(cell);
+    }
+
+    start->set_cost(0.0);
+    start->set_estimation(estimate(start->row(), start->col(), target));
+    start->set_parent(nullptr);
+
+    NodePtr current = start;
+    for (auto cell = m_path.rbegin() + 1; cell != m_path.rend(); ++cell) {
+        const int to_row = *cell / columns;
+        const int to_col = *cell % columns;
+        const int dr = sign(to_row - current->row());
+        const int dc = sign(to_col - current->col());
+        const double step = dr != 0 && dc != 0 ? StandardCost::diagonal : StandardCost::straight;
+
+        while (current->row() != to_row || current->col() != to_col) {
+            const int row = current->row() + dr;
+            const int col = current->col() + dc;
+
+            auto node = make_shared<Node>(row, col);
+            node->set_cost(current->cost() + step);
+            node->set_estimation(estimate(row, col, target));
+            node->set_parent(current);
+            current = std::move(node);
+        }
+    }
+
+    return current;
+}
+
+/**
+ * Heuristic function, the same one AStarSolver uses.
+ */
+double JumpPointSolver::estimate(int row, int col, const Node& goal) const noexcept
+{
+    return EuclideanHeuristic::estimate<StandardCost>(abs(col - goal.col()), abs(row - goal.row()));
+}
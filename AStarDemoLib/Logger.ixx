@@ -18,7 +18,13 @@
  */
 module;
 
+#ifdef _WIN32
 #include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#endif
 
 export module Logger;
 
@@ -56,6 +62,7 @@ export namespace AStarLib {
      */
 	void LogErrno()
 	{
+#ifdef _WIN32
 		constexpr size_t errmsglen = 1024; // 1KB
 		wchar_t errmsg[errmsglen] = { 0 };
 		_wcserror_s(errmsg, errno);
@@ -64,6 +71,10 @@ export namespace AStarLib {
 		OutputDebugString(L"[ERROR] ");
 		OutputDebugString(errmsg);
 		OutputDebugString(L"\n");
+#else
+		// there is no debug console outside Windows, the standard error stream takes its place
+		std::clog << "[ERROR] " << std::strerror(errno) << '\n';
+#endif
 	}
 }
 
@@ -76,8 +87,12 @@ module :private;
  */
 void OutputMessage(const std::string& message)
 {
+#ifdef _WIN32
 	const std::wstring buffer(message.begin(), message.end());
 	OutputDebugString(buffer.c_str());
 	OutputDebugString(L"\n");
+#else
+	std::clog << message << '\n';
+#endif
 }
 
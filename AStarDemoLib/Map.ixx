@@ -18,10 +18,19 @@
  */
 export module Map;
 
+import <algorithm>;
+import <array>;
+import <atomic>;
+import <bit>;
 import <cassert>;
+import <cstddef>;
+import <cstdint>;
+import <cstring>;
 import <string>;
 import <memory>;
 import <mutex>;
+import <span>;
+import <stdexcept>;
 import <utility>;
 import <vector>;
 import <iostream>;
@@ -29,22 +38,106 @@ import <sstream>;
 import <fstream>;
 
 import Node;
+import Path;
+import Connectivity;
 
 export namespace AStarLib {
 
+    class MapSnapshot;
+
+    /**
+     * Bits of the per cell neighbour masks, set for the neighbours that can be walked on.
+     *
+     * They follow the order the solvers always visited the neighbours in, row by row from
+     * the top left, so that scanning a mask from its lowest bit keeps the same search order.
+     * The bit of a neighbour looking back at the cell is always 7 minus the original one.
+     */
+    export struct NeighbourMask {
+        static constexpr std::uint8_t UP_LEFT = 1 << 0;
+        static constexpr std::uint8_t UP = 1 << 1;
+        static constexpr std::uint8_t UP_RIGHT = 1 << 2;
+        static constexpr std::uint8_t LEFT = 1 << 3;
+        static constexpr std::uint8_t RIGHT = 1 << 4;
+        static constexpr std::uint8_t DOWN_LEFT = 1 << 5;
+        static constexpr std::uint8_t DOWN = 1 << 6;
+        static constexpr std::uint8_t DOWN_RIGHT = 1 << 7;
+
+        static constexpr std::uint8_t ORTHOGONAL = UP | LEFT | RIGHT | DOWN;
+        static constexpr std::uint8_t DIAGONAL = UP_LEFT | UP_RIGHT | DOWN_LEFT | DOWN_RIGHT;
+
+        static constexpr int row_offset[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+        static constexpr int col_offset[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+
+        /**
+         * @brief Drops the diagonals that would squeeze past a blocked cell.
+         */
+        static constexpr std::uint8_t without_corner_cutting(std::uint8_t mask) noexcept {
+            const bool up = mask & UP;
+            const bool down = mask & DOWN;
+            const bool left = mask & LEFT;
+            const bool right = mask & RIGHT;
+
+            const std::uint8_t allowed = ORTHOGONAL |
+                (up && left ? UP_LEFT : 0) | (up && right ? UP_RIGHT : 0) |
+                (down && left ? DOWN_LEFT : 0) | (down && right ? DOWN_RIGHT : 0);
+            return mask & allowed;
+        }
+
+        /**
+         * @brief Calls visit(row, col, diagonal) for every neighbour on the mask, lowest bit first.
+         */
+        template<typename Visit>
+        static void for_each(int row, int col, std::uint8_t mask, Visit&& visit) {
+            unsigned bits = mask;
+            while (bits != 0) {
+                const int bit = std::countr_zero(bits);
+                bits &= bits - 1;
+                visit(row + row_offset[bit], col + col_offset[bit], ((DIAGONAL >> bit) & 1) != 0);
+            }
+        }
+    };
+
+    void build_neighbour_masks(std::span<const std::uint64_t> plane, int rows, int cols, std::span<std::uint8_t> masks);
+
+    /**
+     * What Map::changes_since() found out.
+     */
+    export struct MapChanges {
+        // the map version the changes lead to, to ask from on the next call
+        std::uint64_t version = 0;
+
+        // the log does not go back far enough, or the whole map was replaced since
+        bool everything = false;
+    };
+
     /**
      * Class to represent the maps used for the A* algorithm.
+     *
+     * The cells are stored row-major in a single buffer surrounded by a border of
+     * blocked cells, so that neighbour lookups never fall outside of it. A separate
+     * bit plane tracks which cells can be walked on, and can be read without taking
+     * the map lock.
+     *
+     * Threads that only read the map can take an immutable snapshot instead, which is
+     * only rebuilt after the map was changed, and stays valid for as long as they hold it.
+     *
+     * The cells changed by set_pos(), visit() and add_path() are kept on a bounded log,
+     * so that consumers like the view only need to look at the cells that changed since
+     * the version they last saw, see changes_since().
      */
     export class Map final
     {
     public:
-        enum class CellType { FREE, BLOCKED, VISITED, NODE_PATH, START, END };
+        enum class CellType : std::uint8_t { FREE, BLOCKED, VISITED, NODE_PATH, START, END };
 
         explicit Map() noexcept;
         explicit Map(int rows, int cols);
 
 
         bool load(std::wistream& fd);
+        void load(const MapSnapshot& source);
+
+        void set_tileset(int width, int height, std::wstring filename);
 
         void clear() noexcept;
 
@@ -60,18 +153,26 @@ export namespace AStarLib {
 
         // Declared as inline member function so that we get the abstraction
         // without speed penalty. 
-        [[gsl::suppress(bounds.4)]]
         CellType at(int row, int col) const {
-            // already bound checked, hence disabling the check above
+            const auto pos = checked_offset(row, col);
             std::lock_guard<std::mutex> lock(m_map_mutex);
-            return m_map.at(row).at(col);
+            return m_cells[pos];
         }
 
-        [[gsl::suppress(bounds.4)]]
         void set_pos(int row, int col, CellType cell) {
-            // already bound checked, hence disabling the check above
+            const auto pos = checked_offset(row, col);
             std::lock_guard<std::mutex> lock(m_map_mutex);
-            m_map.at(row).at(col) = cell;
+            m_cells[pos] = cell;
+            if (set_passable(pos, cell != CellType::BLOCKED)) {
+                update_neighbours(row, col, cell != CellType::BLOCKED);
+                if (cell == CellType::BLOCKED) {
+                    m_components.block(*this, row, col);
+                }
+                else {
+                    m_components.unblock(*this, row, col);
+                }
+            }
+            log_change(row, col, m_version.fetch_add(1, std::memory_order_release) + 1);
             if (cell == CellType::START) {
                 start = std::make_pair(row, col);
             }
@@ -80,26 +181,212 @@ export namespace AStarLib {
             }
         }
 
-        [[gsl::suppress(bounds.4)]]
         void visit(int row, int col) {
-            // already bound checked, hence disabling the check above
+            const auto pos = checked_offset(row, col);
             std::lock_guard<std::mutex> lock(m_map_mutex);
-            m_map.at(row).at(col) = CellType::VISITED;
+            m_cells[pos] = CellType::VISITED;
+            log_change(row, col, m_version.fetch_add(1, std::memory_order_release) + 1);
+        }
+
+        /**
+         * @brief Lock free check if a cell can be walked on.
+         * The coordinates may be one cell outside of the map, which is always blocked,
+         * so callers looking at neighbours don't need to check the map bounds.
+         */
+        bool passable(int row, int col) const noexcept {
+            assert(row >= -1 && row <= mapRows && col >= -1 && col <= mapCols);
+            const auto pos = offset(row, col);
+            return (m_passable[pos >> 6].load(std::memory_order_relaxed) >> (pos & 63)) & 1;
         }
 
+        /**
+         * @brief Lock free mask of the neighbours that can be walked on, see NeighbourMask.
+         * Kept up to date by set_pos, so that successors don't need eight passable() calls.
+         */
+        std::uint8_t neighbours(int row, int col) const noexcept {
+            assert(row >= 0 && row < mapRows && col >= 0 && col < mapCols);
+            return m_neighbours[static_cast<std::size_t>(row) * mapCols + col].load(std::memory_order_relaxed);
+        }
+
+        bool connected(int from_row, int from_col, int to_row, int to_col) const;
+
+        std::shared_ptr<const MapSnapshot> snapshot() const;
+
+        /**
+         * @brief Counter incremented on every change to the map contents.
+         */
+        std::uint64_t version() const noexcept { return m_version.load(std::memory_order_acquire); }
+
+        /**
+         * @brief Counter incremented only when cells get blocked or unblocked, or the map is reloaded.
+         * Marking cells as visited or part of a path leaves it unchanged.
+         */
+        std::uint64_t passability_version() const noexcept { return m_plane_version.load(std::memory_order_acquire); }
+
+        MapChanges changes_since(std::uint64_t version, std::vector<std::pair<int, int>>& cells) const;
+
+        // how many changed cells are remembered, older ones are reported as everything having changed
+        static constexpr std::size_t change_log_capacity = 16384;
+
         void dump_map();
         void add_path(AStarLib::Node* path);
+        void add_path(const AStarLib::Path& path);
 
         const std::pair<int, int>& get_start() const noexcept { return start; }
         const std::pair<int, int>& get_end() const noexcept { return end; }
 
     private:
-        std::vector<std::vector<CellType>> m_map;
+        std::vector<CellType> m_cells;
+        std::vector<std::atomic<std::uint64_t>> m_passable;
+        std::vector<std::atomic<std::uint8_t>> m_neighbours;
+        mutable Connectivity m_components;
         mutable std::mutex m_map_mutex;
+        std::atomic<std::uint64_t> m_version;
+        std::atomic<std::uint64_t> m_plane_version;
+        mutable std::atomic<std::shared_ptr<const MapSnapshot>> m_snapshot;
+
+        // ring of the latest changed cells, oldest at m_change_next once it is full
+        struct Change {
+            std::uint64_t version;
+            std::uint32_t cell;
+        };
+        std::vector<Change> m_changes;
+        std::size_t m_change_next = 0;
+
+        // changes up to this version are not on the log anymore
+        std::uint64_t m_changes_floor = 0;
+
         std::pair<int, int> start, end;
         int mapRows, mapCols;
         int tileWidth, tileHeigth;
         std::wstring tileset;
+
+        std::size_t stride() const noexcept { return static_cast<std::size_t>(mapCols) + 2; }
+
+        std::size_t offset(int row, int col) const noexcept {
+            return (static_cast<std::size_t>(row) + 1) * stride() + (static_cast<std::size_t>(col) + 1);
+        }
+
+        std::size_t checked_offset(int row, int col) const {
+            if (row < 0 || row >= mapRows || col < 0 || col >= mapCols) {
+                throw std::out_of_range("map position out of range");
+            }
+            return offset(row, col);
+        }
+
+        /**
+         * @return true when the cell passability changed.
+         */
+        bool set_passable(std::size_t pos, bool passable) noexcept {
+            const std::uint64_t mask = std::uint64_t{ 1 } << (pos & 63);
+            const auto previous = passable ?
+                m_passable[pos >> 6].fetch_or(mask, std::memory_order_relaxed) :
+                m_passable[pos >> 6].fetch_and(~mask, std::memory_order_relaxed);
+
+            if (((previous & mask) != 0) != passable) {
+                m_plane_version.fetch_add(1, std::memory_order_release);
+                return true;
+            }
+            return false;
+        }
+
+        void update_neighbours(int row, int col, bool passable) noexcept;
+        void rebuild_neighbours();
+        void log_change(int row, int col, std::uint64_t version);
+        void log_everything() noexcept;
+        void resize(int rows, int cols);
+        void reset_cells() noexcept;
+    };
+
+    /**
+     * Immutable copy of a Map, as returned by Map::snapshot().
+     *
+     * Snapshots taken while the map is not being changed are shared, and the passability
+     * plane is shared between snapshots for as long as no cell gets blocked or unblocked.
+     * Any number of threads can read the same snapshot without synchronization.
+     */
+    export class MapSnapshot final
+    {
+    public:
+        using CellType = Map::CellType;
+
+        int columns() const noexcept { return m_cols; }
+
+        int rows() const noexcept { return m_rows; }
+
+        std::uint64_t version() const noexcept { return m_version; }
+
+        std::uint64_t passability_version() const noexcept { return m_plane_version; }
+
+        /**
+         * @brief Cell contents, snapshots made from a bare passability plane only know about free and blocked cells.
+         */
+        CellType at(int row, int col) const {
+            if (row < 0 || row >= m_rows || col < 0 || col >= m_cols) {
+                throw std::out_of_range("map position out of range");
+            }
+            if (m_cells == nullptr) {
+                return passable(row, col) ? CellType::FREE : CellType::BLOCKED;
+            }
+            return (*m_cells)[offset(row, col)];
+        }
+
+        /**
+         * @brief Check if a cell can be walked on, with the same border rules as Map::passable.
+         */
+        bool passable(int row, int col) const noexcept {
+            assert(row >= -1 && row <= m_rows && col >= -1 && col <= m_cols);
+            const auto pos = offset(row, col);
+            return (m_plane[pos >> 6] >> (pos & 63)) & 1;
+        }
+
+        /**
+         * @brief Mask of the neighbours that can be walked on, see NeighbourMask.
+         */
+        std::uint8_t neighbours(int row, int col) const noexcept {
+            assert(row >= 0 && row < m_rows && col >= 0 && col < m_cols);
+            return (*m_neighbours)[static_cast<std::size_t>(row) * m_cols + col];
+        }
+
+        bool connected(int from_row, int from_col, int to_row, int to_col) const;
+
+        /**
+         * @brief The passability bits, one per cell of the map and its border, in Map's padded row-major order.
+         */
+        std::span<const std::uint64_t> plane() const noexcept { return { m_plane, plane_words(m_rows, m_cols) }; }
+
+        static std::size_t plane_words(int rows, int cols) noexcept {
+            return ((static_cast<std::size_t>(rows) + 2) * (static_cast<std::size_t>(cols) + 2) + 63) / 64;
+        }
+
+        static std::shared_ptr<const MapSnapshot> from_plane(int rows, int cols, const std::uint64_t* plane, std::shared_ptr<const void> owner);
+
+    private:
+        friend class Map;
+
+        // labelled on the first query, and shared by the snapshots with the same passability
+        struct Components {
+            std::once_flag built;
+            Connectivity connectivity;
+        };
+
+        MapSnapshot(int rows, int cols, std::uint64_t version, std::uint64_t plane_version,
+            std::shared_ptr<const std::vector<CellType>> cells,
+            const std::uint64_t* plane, std::shared_ptr<const void> plane_owner,
+            std::shared_ptr<const std::vector<std::uint8_t>> neighbours, std::shared_ptr<Components> components) noexcept;
+
+        std::size_t offset(int row, int col) const noexcept {
+            return (static_cast<std::size_t>(row) + 1) * (static_cast<std::size_t>(m_cols) + 2) + (static_cast<std::size_t>(col) + 1);
+        }
+
+        int m_rows, m_cols;
+        std::uint64_t m_version;
+        std::uint64_t m_plane_version;
+        std::shared_ptr<const std::vector<CellType>> m_cells;
+        const std::uint64_t* m_plane;
+        std::shared_ptr<const void> m_plane_owner;
+        std::shared_ptr<const std::vector<std::uint8_t>> m_neighbours;
+        std::shared_ptr<Components> m_components;
     };
 };
 
@@ -112,9 +399,9 @@ using namespace AStarLib;
 /**
  * @brief Constructs the map by setting its contents to empty.
  */
-Map::Map() noexcept : start{ -1, -1 }, end{ -1, -1 }, mapRows{ 0 }, mapCols{ 0 }
+Map::Map() noexcept : m_version{ 0 }, m_plane_version{ 0 }, start{ -1, -1 }, end{ -1, -1 }, mapRows{ 0 }, mapCols{ 0 }
 {
-    clear();
+    reset_cells();
 }
 
 /**
@@ -122,12 +409,27 @@ Map::Map() noexcept : start{ -1, -1 }, end{ -1, -1 }, mapRows{ 0 }, mapCols{ 0 }
  * @param rows the amount of map rows.
  * @param cols the amount of map columns.
  */
-Map::Map(int rows, int cols) : start{ -1, -1 }, end{ -1, -1 }, mapRows{ rows }, mapCols{ cols }
+Map::Map(int rows, int cols) : m_version{ 0 }, m_plane_version{ 0 }, start{ -1, -1 }, end{ -1, -1 }, mapRows{ 0 }, mapCols{ 0 }
 {
-    m_map.resize(mapRows);
-    for (auto& col : m_map) {
-        col.resize(mapCols);
-    }
+    resize(rows, cols);
+}
+
+/**
+ * @brief Allocates the storage for the given size, with all cells free.
+ * @param rows the amount of map rows.
+ * @param cols the amount of map columns.
+ */
+void Map::resize(int rows, int cols)
+{
+    mapRows = rows;
+    mapCols = cols;
+
+    const size_t cells = (static_cast<size_t>(rows) + 2) * stride();
+    m_cells.assign(cells, CellType::BLOCKED);
+    m_passable = vector<atomic<uint64_t>>((cells + 63) / 64);
+    m_neighbours = vector<atomic<uint8_t>>(static_cast<size_t>(rows) * cols);
+
+    reset_cells();
 }
 
 /**
@@ -143,6 +445,13 @@ bool Map::load(std::wistream& fd)
     size_t row = 0;
     wstring str;
 
+    lock_guard<std::mutex> lock(m_map_mutex);
+
+    // whatever happens, the contents are going to change
+    m_version.fetch_add(1, memory_order_release);
+    m_plane_version.fetch_add(1, memory_order_release);
+    log_everything();
+
     while (!fd.eof()) {
         if (row == 0) {
             fd >> str;
@@ -154,44 +463,265 @@ bool Map::load(std::wistream& fd)
             fd >> tileWidth >> tileHeigth >> tileset;
         }
         else if (row == 2) {
-            fd >> mapRows >> mapCols;
-            m_map.resize(mapRows);
-            for (auto& col : m_map) {
-                col.resize(mapCols);
-            }
+            int rows = 0;
+            int cols = 0;
+            fd >> rows >> cols;
+            resize(rows, cols);
         }
-        else {
-            fd >> str;
+        else if (row - MaxRow < static_cast<size_t>(mapRows)) {
+            if (!(fd >> str)) {
+                break;
+            }
 
-            for (size_t i = 0; i < mapCols - 1; ++i) {
-                if (str.at(i) == '.') {
-                    m_map.at(row - MaxRow).at(i) = CellType::FREE;
-                }
-                else {
-                    m_map.at(row - MaxRow).at(i) = CellType::BLOCKED;
-                }
+            // the map files have one character less per row than the declared width
+            const int cols = min(static_cast<int>(str.size()), mapCols - 1);
+            for (int i = 0; i < cols; ++i) {
+                const auto pos = offset(static_cast<int>(row - MaxRow), i);
+                const bool free = str[i] == '.';
+                m_cells[pos] = free ? CellType::FREE : CellType::BLOCKED;
+                set_passable(pos, free);
             }
         }
+        else {
+            break;
+        }
         ++row;
     }
 
+    rebuild_neighbours();
+    m_components.invalidate();
     return true;
 }
 
+/**
+ * @brief Replaces the map contents by the ones of a snapshot, without any parsing.
+ * The passability plane is copied word by word, the tileset information is kept.
+ * @param source the snapshot to copy from, it may belong to another map.
+ */
+void Map::load(const MapSnapshot& source)
+{
+    const auto plane = source.plane();
+
+    lock_guard<std::mutex> lock(m_map_mutex);
+
+    m_version.fetch_add(1, memory_order_release);
+    log_everything();
+
+    mapRows = source.rows();
+    mapCols = source.columns();
+    m_cells.assign((static_cast<size_t>(mapRows) + 2) * stride(), CellType::BLOCKED);
+    m_passable = vector<atomic<uint64_t>>(plane.size());
+    for (size_t i = 0; i < plane.size(); ++i) {
+        m_passable[i].store(plane[i], memory_order_relaxed);
+    }
+
+    const auto& masks = *source.m_neighbours;
+    m_neighbours = vector<atomic<uint8_t>>(masks.size());
+    for (size_t i = 0; i < masks.size(); ++i) {
+        m_neighbours[i].store(masks[i], memory_order_relaxed);
+    }
+    m_components.invalidate();
+
+    for (int row = 0; row < mapRows; ++row) {
+        for (int col = 0; col < mapCols; ++col) {
+            const auto pos = offset(row, col);
+            m_cells[pos] = source.at(row, col);
+        }
+    }
+
+    start = { -1, -1 };
+    end = { -1, -1 };
+
+    m_plane_version.fetch_add(1, memory_order_release);
+}
+
+/**
+ * @brief Sets the tileset used to draw the map.
+ * @param width the width of each tile.
+ * @param height the height of each tile.
+ * @param filename the image with the tiles.
+ */
+void Map::set_tileset(int width, int height, wstring filename)
+{
+    lock_guard<std::mutex> lock(m_map_mutex);
+    tileWidth = width;
+    tileHeigth = height;
+    tileset = std::move(filename);
+}
+
 /**
  * @brief Clears the map contents
  */
-[[gsl::suppress(bounds.4)]] // The for loop already takes care, no need for double check.
 void Map::clear() noexcept
 {
-    for (int row = 0; row < m_map.size(); ++row) {
-        for (int col = 0; col < m_map[row].size(); ++col) {
-            m_map[row][col] = CellType::FREE;
+    lock_guard<std::mutex> lock(m_map_mutex);
+    reset_cells();
+    m_version.fetch_add(1, memory_order_release);
+    log_everything();
+}
+
+/**
+ * @brief Sets all cells to free, leaving only the border blocked.
+ * Nothing gets allocated, the neighbour masks follow from the map bounds alone.
+ */
+void Map::reset_cells() noexcept
+{
+    for (auto& word : m_passable) {
+        word.store(0, memory_order_relaxed);
+    }
+
+    // with every cell free, a neighbour is walkable exactly when it is inside the map
+    for (int row = 0; row < mapRows; ++row) {
+        const uint8_t edges =
+            (row == 0 ? NeighbourMask::UP_LEFT | NeighbourMask::UP | NeighbourMask::UP_RIGHT : 0) |
+            (row == mapRows - 1 ? NeighbourMask::DOWN_LEFT | NeighbourMask::DOWN | NeighbourMask::DOWN_RIGHT : 0);
+
+        for (int col = 0; col < mapCols; ++col) {
+            const auto pos = offset(row, col);
+            m_cells[pos] = CellType::FREE;
+            set_passable(pos, true);
+
+            const uint8_t outside = edges |
+                (col == 0 ? NeighbourMask::UP_LEFT | NeighbourMask::LEFT | NeighbourMask::DOWN_LEFT : 0) |
+                (col == mapCols - 1 ? NeighbourMask::UP_RIGHT | NeighbourMask::RIGHT | NeighbourMask::DOWN_RIGHT : 0);
+            m_neighbours[static_cast<size_t>(row) * mapCols + col].store(static_cast<uint8_t>(~outside), memory_order_relaxed);
         }
     }
+    m_components.invalidate();
 
     start = { -1, -1 };
     end = { -1, -1 };
+
+    m_plane_version.fetch_add(1, memory_order_release);
+}
+
+/**
+ * @brief Flips the bit pointing back at a cell on the masks of its neighbours.
+ * @param row the row of the cell whose passability changed.
+ * @param col the column of the cell whose passability changed.
+ * @param passable whether the cell can now be walked on.
+ */
+void Map::update_neighbours(int row, int col, bool passable) noexcept
+{
+    for (int bit = 0; bit < 8; ++bit) {
+        const int next_row = row + NeighbourMask::row_offset[bit];
+        const int next_col = col + NeighbourMask::col_offset[bit];
+        if (next_row < 0 || next_row >= mapRows || next_col < 0 || next_col >= mapCols) {
+            continue;
+        }
+
+        const auto back = static_cast<uint8_t>(1 << (7 - bit));
+        auto& mask = m_neighbours[static_cast<size_t>(next_row) * mapCols + next_col];
+        if (passable) {
+            mask.fetch_or(back, memory_order_relaxed);
+        }
+        else {
+            mask.fetch_and(static_cast<uint8_t>(~back), memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * @brief Recomputes all the neighbour masks from the passability plane, after it was rewritten.
+ * Works on plain copies of the atomics, and may throw bad_alloc.
+ */
+void Map::rebuild_neighbours()
+{
+    vector<uint64_t> plane(m_passable.size());
+    for (size_t i = 0; i < plane.size(); ++i) {
+        plane[i] = m_passable[i].load(memory_order_relaxed);
+    }
+
+    vector<uint8_t> masks(m_neighbours.size());
+    build_neighbour_masks(plane, mapRows, mapCols, masks);
+    for (size_t i = 0; i < masks.size(); ++i) {
+        m_neighbours[i].store(masks[i], memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Checks if a path may exist between two cells, without searching for it.
+ * After a change that may have split a component, the answer comes from a snapshot, whose
+ * labels are built without holding the map lock, and taken over when no cell flipped meanwhile.
+ * @return false when the goal is blocked or can't be reached by any moves from the start.
+ */
+bool Map::connected(int from_row, int from_col, int to_row, int to_col) const
+{
+    {
+        lock_guard<std::mutex> lock(m_map_mutex);
+        if (m_components.valid()) {
+            return m_components.connected(*this, from_row, from_col, to_row, to_col);
+        }
+    }
+
+    // labelling visits every cell, the map must stay usable in the meantime
+    const auto current = snapshot();
+    const bool reachable = current->connected(from_row, from_col, to_row, to_col);
+    Connectivity labels = current->m_components->connectivity;
+
+    lock_guard<std::mutex> lock(m_map_mutex);
+    if (!m_components.valid() && m_plane_version.load(memory_order_relaxed) == current->m_plane_version) {
+        m_components = std::move(labels);
+    }
+    return reachable;
+}
+
+/**
+ * @brief Provides a read-only copy of the map, that is safe to share across threads.
+ * A new copy is only made when the map was changed since the last call, otherwise the
+ * previous one is returned.
+ * @return the snapshot for the current map contents.
+ */
+shared_ptr<const MapSnapshot> Map::snapshot() const
+{
+    auto current = m_snapshot.load(memory_order_acquire);
+    if (current != nullptr && current->version() == version()) {
+        return current;
+    }
+
+    lock_guard<std::mutex> lock(m_map_mutex);
+
+    // someone else might have published it in the meantime
+    current = m_snapshot.load(memory_order_acquire);
+    const auto latest = m_version.load(memory_order_acquire);
+    if (current != nullptr && current->version() == latest) {
+        return current;
+    }
+
+    auto cells = make_shared<const vector<CellType>>(m_cells);
+
+    const uint64_t* plane = nullptr;
+    shared_ptr<const void> plane_owner;
+    shared_ptr<const vector<uint8_t>> neighbours;
+    shared_ptr<MapSnapshot::Components> components;
+    const auto plane_version = m_plane_version.load(memory_order_relaxed);
+    if (current != nullptr && current->m_plane_version == plane_version) {
+        plane = current->m_plane;
+        plane_owner = current->m_plane_owner;
+        neighbours = current->m_neighbours;
+        components = current->m_components;
+    }
+    else {
+        auto words = make_shared<vector<uint64_t>>(m_passable.size());
+        for (size_t i = 0; i < words->size(); ++i) {
+            (*words)[i] = m_passable[i].load(memory_order_relaxed);
+        }
+        plane = words->data();
+        plane_owner = std::move(words);
+
+        auto masks = make_shared<vector<uint8_t>>(m_neighbours.size());
+        for (size_t i = 0; i < masks->size(); ++i) {
+            (*masks)[i] = m_neighbours[i].load(memory_order_relaxed);
+        }
+        neighbours = std::move(masks);
+        components = make_shared<MapSnapshot::Components>();
+    }
+
+    shared_ptr<const MapSnapshot> fresh(new MapSnapshot(mapRows, mapCols, latest, plane_version, std::move(cells),
+        plane, std::move(plane_owner), std::move(neighbours), std::move(components)));
+    m_snapshot.store(fresh, memory_order_release);
+
+    return fresh;
 }
 
 /**
@@ -201,7 +731,7 @@ void Map::dump_map()
 {
     for (int row = 0; row < mapRows; ++row) {
         for (int col = 0; col < mapCols; ++col) {
-            switch (m_map.at(row).at(col)) {
+            switch (m_cells[offset(row, col)]) {
             case CellType::FREE:
                 cout << '.';
                 break;
@@ -243,21 +773,231 @@ void Map::dump_map()
 void Map::add_path(Node* path)
 {
     lock_guard<std::mutex> lock(m_map_mutex);
-    auto current = path;
+    const Node* current = path;
+
+    const auto version = m_version.fetch_add(1, memory_order_release) + 1;
 
     bool first = true;
     while (current != nullptr) {
+        const auto pos = checked_offset(current->row(), current->col());
+        log_change(current->row(), current->col(), version);
         if (first) {
-            m_map.at(current->row()).at(current->col()) = CellType::END;
+            m_cells[pos] = CellType::END;
             first = false;
         }
-        else if (current->get_parent() == nullptr) {
-            m_map.at(current->row()).at(current->col()) = CellType::START;
+        else if (current->parent() == nullptr) {
+            m_cells[pos] = CellType::START;
         }
         else {
-            m_map.at(current->row()).at(current->col()) = CellType::NODE_PATH;
+            m_cells[pos] = CellType::NODE_PATH;
         }
-        current = current->get_parent().get();
+        current = current->parent();
+    }
+}
+
+/**
+ * @brief Updates the map information adding the path, every cell of it, so a path of
+ * waypoints needs to be expanded first.
+ *
+ * @param path the cells from the start to the end
+ */
+void Map::add_path(const Path& path)
+{
+    lock_guard<std::mutex> lock(m_map_mutex);
+    if (path.empty()) {
+        return;
+    }
+
+    const auto version = m_version.fetch_add(1, memory_order_release) + 1;
+
+    for (const auto& point : path) {
+        m_cells[checked_offset(point.row, point.col)] = CellType::NODE_PATH;
+        log_change(point.row, point.col, version);
     }
+    m_cells[checked_offset(path.front().row, path.front().col)] = CellType::START;
+    m_cells[checked_offset(path.back().row, path.back().col)] = CellType::END;
 }
 
+/**
+ * @brief Finds the cells changed after a given version, to refresh only those.
+ * A cell changed several times is only reported once.
+ *
+ * @param version the map version the caller is up to date with, 0 for none.
+ * @param cells replaced by the changed cells, as (row, col) pairs.
+ * @return the version the changes lead to, and whether every cell must be assumed
+ * to have changed instead, in which case cells is left empty.
+ */
+MapChanges Map::changes_since(uint64_t version, vector<pair<int, int>>& cells) const
+{
+    cells.clear();
+
+    lock_guard<std::mutex> lock(m_map_mutex);
+    MapChanges changes{ m_version.load(memory_order_relaxed), version < m_changes_floor };
+    if (changes.everything || version >= changes.version) {
+        return changes;
+    }
+
+    // the versions only grow along the ring, starting from its oldest entry
+    const auto seen = [version](const Change& change) { return change.version <= version; };
+    const auto oldest = m_changes.begin() + static_cast<ptrdiff_t>(m_change_next);
+    vector<uint32_t> changed;
+    for (const auto& [first, last] : { pair{ oldest, m_changes.end() }, pair{ m_changes.begin(), oldest } }) {
+        for (auto change = partition_point(first, last, seen); change != last; ++change) {
+            changed.push_back(change->cell);
+        }
+    }
+
+    sort(changed.begin(), changed.end());
+    changed.erase(unique(changed.begin(), changed.end()), changed.end());
+
+    cells.reserve(changed.size());
+    for (const auto cell : changed) {
+        cells.emplace_back(static_cast<int>(cell) / mapCols, static_cast<int>(cell) % mapCols);
+    }
+    return changes;
+}
+
+/**
+ * @brief Records a changed cell on the log, dropping the oldest one when it is full.
+ * @param version the map version the change lead to.
+ */
+void Map::log_change(int row, int col, uint64_t version)
+{
+    const Change change{ version, static_cast<uint32_t>(static_cast<size_t>(row) * mapCols + col) };
+    if (m_changes.size() < change_log_capacity) {
+        m_changes.push_back(change);
+        return;
+    }
+
+    m_changes_floor = m_changes[m_change_next].version;
+    m_changes[m_change_next] = change;
+    m_change_next = (m_change_next + 1) % change_log_capacity;
+}
+
+/**
+ * @brief Forgets the logged changes, after the whole map changed at once.
+ */
+void Map::log_everything() noexcept
+{
+    m_changes.clear();
+    m_change_next = 0;
+    m_changes_floor = m_version.load(memory_order_relaxed);
+}
+
+/**
+ * @brief Constructs the snapshot from data already copied out of the map.
+ */
+MapSnapshot::MapSnapshot(int rows, int cols, uint64_t version, uint64_t plane_version,
+    shared_ptr<const vector<CellType>> cells, const uint64_t* plane, shared_ptr<const void> plane_owner,
+    shared_ptr<const vector<uint8_t>> neighbours, shared_ptr<Components> components) noexcept :
+    m_rows{ rows }, m_cols{ cols }, m_version{ version }, m_plane_version{ plane_version },
+    m_cells{ std::move(cells) }, m_plane{ plane }, m_plane_owner{ std::move(plane_owner) }, m_neighbours{ std::move(neighbours) },
+    m_components{ std::move(components) }
+{
+}
+
+/**
+ * @brief Checks if a path may exist between two cells, without searching for it.
+ * The components are labelled on the first call, from whichever thread makes it.
+ * @return false when the goal is blocked or can't be reached by any moves from the start.
+ */
+bool MapSnapshot::connected(int from_row, int from_col, int to_row, int to_col) const
+{
+    call_once(m_components->built, [this] { m_components->connectivity.build(*this); });
+    return m_components->connectivity.connected(*this, from_row, from_col, to_row, to_col);
+}
+
+/**
+ * @brief Wraps an existing passability plane without copying it, e.g. one that was memory mapped from a file.
+ * The cells on the border of the plane must be cleared. The neighbour masks are the only thing computed,
+ * but that visits every cell, so the snapshot is meant to be built once and shared, as BinaryMap does.
+ * @param rows the amount of map rows.
+ * @param cols the amount of map columns.
+ * @param plane plane_words(rows, cols) words laid out as in Map.
+ * @param owner keeps the plane memory alive for as long as the snapshot is used.
+ * @return the snapshot, whose cells are either free or blocked.
+ */
+shared_ptr<const MapSnapshot> MapSnapshot::from_plane(int rows, int cols, const uint64_t* plane, shared_ptr<const void> owner)
+{
+    assert(plane != nullptr);
+    auto neighbours = make_shared<vector<uint8_t>>(static_cast<size_t>(rows) * cols);
+    build_neighbour_masks({ plane, plane_words(rows, cols) }, rows, cols, *neighbours);
+    return shared_ptr<const MapSnapshot>(new MapSnapshot(rows, cols, 0, 0, nullptr, plane, std::move(owner),
+        std::move(neighbours), make_shared<Components>()));
+}
+
+namespace {
+    /**
+     * The bits of every byte spread over 8 bytes, each one holding 0 or 1.
+     */
+    constexpr auto spread_bits = [] {
+        array<array<uint8_t, 8>, 256> table{};
+        for (size_t value = 0; value < table.size(); ++value) {
+            for (size_t bit = 0; bit < 8; ++bit) {
+                table[value][bit] = (value >> bit) & 1;
+            }
+        }
+        return table;
+    }();
+
+    /**
+     * @brief Unpacks the passability bits of a padded row into one byte per cell, 8 cells at a time.
+     * @param out at least the row width rounded up to a multiple of 8 bytes.
+     */
+    void unpack_plane_row(span<const uint64_t> plane, size_t first, size_t width, uint8_t* out) noexcept
+    {
+        for (size_t i = 0; i < width; i += 8) {
+            const size_t pos = first + i;
+            const size_t word = pos >> 6;
+            const unsigned shift = pos & 63;
+
+            uint64_t bits = plane[word] >> shift;
+            if (shift > 56 && word + 1 < plane.size()) {
+                bits |= plane[word + 1] << (64 - shift);
+            }
+            memcpy(out + i, spread_bits[bits & 0xff].data(), 8);
+        }
+    }
+}
+
+/**
+ * @brief Computes the neighbour masks of every cell of a map from its passability plane.
+ *
+ * Each padded row is unpacked once into bytes, and the masks of a row are then put together
+ * from the rows above, beside and below it with shifts and ors over plain byte arrays,
+ * which the compilers turn into SSE2 or NEON code.
+ * @param plane the passability bits, laid out as in Map, with the border cleared.
+ * @param rows the amount of map rows.
+ * @param cols the amount of map columns.
+ * @param masks rows * cols bytes, written row-major without the border.
+ */
+void AStarLib::build_neighbour_masks(span<const uint64_t> plane, int rows, int cols, span<uint8_t> masks)
+{
+    assert(masks.size() >= static_cast<size_t>(rows) * cols);
+    if (rows <= 0 || cols <= 0) {
+        return;
+    }
+
+    const size_t stride = static_cast<size_t>(cols) + 2;
+    const size_t width = (stride + 7) & ~size_t{ 7 };
+    vector<uint8_t> buffer(width * 3);
+    uint8_t* above = buffer.data();
+    uint8_t* middle = above + width;
+    uint8_t* below = middle + width;
+
+    unpack_plane_row(plane, 0, stride, above);
+    unpack_plane_row(plane, stride, stride, middle);
+    for (int row = 0; row < rows; ++row) {
+        unpack_plane_row(plane, (static_cast<size_t>(row) + 2) * stride, stride, below);
+
+        uint8_t* out = masks.data() + static_cast<size_t>(row) * cols;
+        for (int col = 0; col < cols; ++col) {
+            out[col] = static_cast<uint8_t>(above[col] | (above[col + 1] << 1) | (above[col + 2] << 2) |
+                (middle[col] << 3) | (middle[col + 2] << 4) |
+                (below[col] << 5) | (below[col + 1] << 6) | (below[col + 2] << 7));
+        }
+
+        swap(above, middle);
+        swap(middle, below);
+    }
+}
@@ -0,0 +1,517 @@
+/* MapFile.ixx - Binary map format, loaded by memory mapping the file
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+module;
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+export module MapFile;
+
+import <bit>;
+import <cstddef>;
+import <cstdint>;
+import <cstring>;
+import <filesystem>;
+import <fstream>;
+import <iostream>;
+import <memory>;
+import <mutex>;
+import <span>;
+import <string>;
+import <utility>;
+import <vector>;
+
+import Map;
+
+export namespace AStarLib {
+
+    /**
+     * Read-only view of a whole file, mapped into memory.
+     */
+    export class MappedFile final
+    {
+    public:
+        MappedFile() noexcept = default;
+        explicit MappedFile(const std::filesystem::path& path);
+        ~MappedFile();
+
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool is_open() const noexcept { return m_data != nullptr; }
+
+        std::span<const std::byte> bytes() const noexcept { return { m_data, m_size }; }
+
+    private:
+        const std::byte* m_data = nullptr;
+        std::size_t m_size = 0;
+
+        void close() noexcept;
+    };
+
+    /**
+     * @brief Builds the identifier of a metadata block out of four characters.
+     */
+    constexpr std::uint32_t block_tag(const char(&name)[5]) noexcept
+    {
+        return static_cast<std::uint32_t>(static_cast<unsigned char>(name[0]))
+            | static_cast<std::uint32_t>(static_cast<unsigned char>(name[1])) << 8
+            | static_cast<std::uint32_t>(static_cast<unsigned char>(name[2])) << 16
+            | static_cast<std::uint32_t>(static_cast<unsigned char>(name[3])) << 24;
+    }
+
+    /**
+     * Precomputed data stored along the map, identified by its tag.
+     */
+    export struct MapBlock {
+        std::uint32_t tag;
+        std::span<const std::byte> data;
+    };
+
+    /**
+     * Map stored in the binary format, see Map/Format.txt.
+     *
+     * The file is memory mapped and validated once when opened, after that its
+     * passability plane is used in place: snapshots read the mapped pages directly,
+     * and loading it into a Map is a plain copy of the plane words.
+     */
+    export class BinaryMap final : public std::enable_shared_from_this<BinaryMap>
+    {
+    public:
+        static constexpr std::uint32_t format_version = 1;
+        static constexpr std::uint32_t tileset_block = block_tag("TSET");
+
+        static std::shared_ptr<const BinaryMap> open(const std::filesystem::path& path);
+
+        int rows() const noexcept { return m_rows; }
+
+        int columns() const noexcept { return m_cols; }
+
+        int tilesWidth() const noexcept { return m_tile_width; }
+
+        int tilesHeigth() const noexcept { return m_tile_height; }
+
+        std::wstring tilesetFilename() const;
+
+        std::span<const std::uint64_t> plane() const noexcept { return m_plane; }
+
+        std::span<const std::byte> block(std::uint32_t tag) const noexcept;
+
+        std::shared_ptr<const MapSnapshot> snapshot() const;
+
+        void load(Map& map) const;
+
+    private:
+        MappedFile m_file;
+        int m_rows = 0;
+        int m_cols = 0;
+        int m_tile_width = 0;
+        int m_tile_height = 0;
+        std::span<const std::uint64_t> m_plane;
+        std::vector<MapBlock> m_blocks;
+
+        // built on the first snapshot() call, it doesn't own the plane, the snapshots handed out own this map
+        mutable std::once_flag m_snapshot_built;
+        mutable std::shared_ptr<const MapSnapshot> m_snapshot;
+
+        explicit BinaryMap(MappedFile file) noexcept;
+
+        bool validate();
+    };
+
+    bool save_binary_map(const Map& map, std::ostream& out, std::span<const MapBlock> blocks = {});
+
+    bool convert_text_map(std::wistream& text, std::ostream& binary);
+    bool convert_text_map(const std::filesystem::path& from, const std::filesystem::path& to);
+}
+
+// make the standard C++ library available on the local namespace
+using namespace std;
+
+// also to reduce typing
+using namespace AStarLib;
+
+namespace {
+    constexpr char magic[8] = { 'A', 'S', 't', 'a', 'r', 'b', 'i', 'n' };
+
+    // everything after the header starts on a multiple of this
+    constexpr uint64_t plane_alignment = 64;
+    constexpr uint64_t block_alignment = 8;
+
+    /**
+     * Layout of the file header, all fields are little endian.
+     */
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t header_size;
+        int32_t rows;
+        int32_t cols;
+        int32_t tile_width;
+        int32_t tile_height;
+        uint64_t plane_offset;
+        uint64_t plane_words;
+        uint64_t blocks_offset;
+        uint32_t block_count;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(FileHeader) == 64);
+
+    struct BlockHeader {
+        uint32_t tag;
+        uint32_t reserved;
+        uint64_t size;
+    };
+    static_assert(sizeof(BlockHeader) == 16);
+
+    uint64_t align_up(uint64_t value, uint64_t alignment) noexcept
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    void write_padding(ostream& out, uint64_t from, uint64_t to)
+    {
+        static constexpr char zeros[plane_alignment] = {};
+        out.write(zeros, static_cast<streamsize>(to - from));
+    }
+}
+
+/**
+ * @brief Maps the whole file for reading, is_open() tells if it worked.
+ * @param path the file to map.
+ */
+MappedFile::MappedFile(const filesystem::path& path)
+{
+#ifdef _WIN32
+    // the FromApp variants also work on files the user granted access to through a picker
+    HANDLE file = CreateFile2FromAppW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    LARGE_INTEGER size{};
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingFromApp(file, nullptr, PAGE_READONLY, 0, nullptr);
+        if (mapping != nullptr) {
+            // the view keeps the mapping alive on its own
+            m_data = static_cast<const byte*>(MapViewOfFileFromApp(mapping, FILE_MAP_READ, 0, 0));
+            m_size = m_data != nullptr ? static_cast<size_t>(size.QuadPart) : 0;
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat info {};
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            m_data = static_cast<const byte*>(data);
+            m_size = static_cast<size_t>(info.st_size);
+        }
+    }
+    ::close(fd);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept :
+    m_data{ exchange(other.m_data, nullptr) }, m_size{ exchange(other.m_size, 0) }
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        close();
+        m_data = exchange(other.m_data, nullptr);
+        m_size = exchange(other.m_size, 0);
+    }
+    return *this;
+}
+
+/**
+ * @brief Unmaps the file, if any.
+ */
+void MappedFile::close() noexcept
+{
+    if (m_data != nullptr) {
+#ifdef _WIN32
+        UnmapViewOfFile(m_data);
+#else
+        munmap(const_cast<byte*>(m_data), m_size);
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+}
+
+BinaryMap::BinaryMap(MappedFile file) noexcept : m_file(std::move(file))
+{
+}
+
+/**
+ * @brief Opens a map in the binary format.
+ * @param path the file to load.
+ * @return null if the file could not be mapped or is not a valid map.
+ */
+shared_ptr<const BinaryMap> BinaryMap::open(const filesystem::path& path)
+{
+    // the plane words are used as they are stored
+    if constexpr (endian::native != endian::little) {
+        return nullptr;
+    }
+
+    MappedFile file(path);
+    if (!file.is_open()) {
+        return nullptr;
+    }
+
+    shared_ptr<BinaryMap> result(new BinaryMap(std::move(file)));
+    if (!result->validate()) {
+        return nullptr;
+    }
+    return result;
+}
+
+/**
+ * @brief Checks that the header, the plane and the blocks are consistent with the file size.
+ * Only the border of the plane is looked at, the map cells themselves are not parsed.
+ * @return false if the file cannot be used as a map.
+ */
+bool BinaryMap::validate()
+{
+    const auto bytes = m_file.bytes();
+
+    FileHeader header;
+    if (bytes.size() < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, bytes.data(), sizeof(header));
+
+    if (memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != format_version || header.header_size != sizeof(header)) {
+        return false;
+    }
+
+    if (header.rows <= 0 || header.cols <= 0 || header.plane_words != MapSnapshot::plane_words(header.rows, header.cols)) {
+        return false;
+    }
+
+    if (header.plane_offset % plane_alignment != 0 || header.plane_offset < sizeof(header)
+        || header.plane_offset > bytes.size() || header.plane_words > (bytes.size() - header.plane_offset) / sizeof(uint64_t)) {
+        return false;
+    }
+
+    m_rows = header.rows;
+    m_cols = header.cols;
+    m_tile_width = header.tile_width;
+    m_tile_height = header.tile_height;
+    m_plane = { reinterpret_cast<const uint64_t*>(bytes.data() + header.plane_offset), header.plane_words };
+
+    // the solvers rely on the border being blocked
+    const size_t stride = static_cast<size_t>(m_cols) + 2;
+    const auto is_set = [this](size_t pos) noexcept { return (m_plane[pos >> 6] >> (pos & 63)) & 1; };
+    for (size_t pos = 0; pos < stride; ++pos) {
+        if (is_set(pos) || is_set((static_cast<size_t>(m_rows) + 1) * stride + pos)) {
+            return false;
+        }
+    }
+    for (size_t row = 1; row <= static_cast<size_t>(m_rows); ++row) {
+        if (is_set(row * stride) || is_set(row * stride + stride - 1)) {
+            return false;
+        }
+    }
+
+    uint64_t position = header.blocks_offset;
+    m_blocks.reserve(header.block_count);
+    for (uint32_t i = 0; i < header.block_count; ++i) {
+        BlockHeader block;
+        if (position % block_alignment != 0 || position > bytes.size() || bytes.size() - position < sizeof(block)) {
+            return false;
+        }
+        memcpy(&block, bytes.data() + position, sizeof(block));
+        position += sizeof(block);
+
+        if (block.size > bytes.size() - position) {
+            return false;
+        }
+        m_blocks.push_back({ block.tag, bytes.subspan(position, block.size) });
+        position = align_up(position + block.size, block_alignment);
+    }
+
+    return true;
+}
+
+/**
+ * @brief The image with the tiles, as stored on the tileset block.
+ */
+wstring BinaryMap::tilesetFilename() const
+{
+    const auto data = block(tileset_block);
+
+    wstring filename(data.size() / sizeof(char16_t), L'\0');
+    for (size_t i = 0; i < filename.size(); ++i) {
+        char16_t unit;
+        memcpy(&unit, data.data() + i * sizeof(unit), sizeof(unit));
+        filename[i] = static_cast<wchar_t>(unit);
+    }
+    return filename;
+}
+
+/**
+ * @brief Looks up a metadata block.
+ * @param tag the block identifier, see block_tag().
+ * @return the contents of the first block with the tag, empty if there is none.
+ */
+span<const byte> BinaryMap::block(uint32_t tag) const noexcept
+{
+    for (const auto& entry : m_blocks) {
+        if (entry.tag == tag) {
+            return entry.data;
+        }
+    }
+    return {};
+}
+
+/**
+ * @brief Provides a snapshot that reads the mapped plane, without copying it.
+ * The neighbour masks are computed on the first call, after that the same snapshot is shared,
+ * connectivity labels included. It keeps the file mapped for as long as it is alive.
+ */
+shared_ptr<const MapSnapshot> BinaryMap::snapshot() const
+{
+    call_once(m_snapshot_built, [this] { m_snapshot = MapSnapshot::from_plane(m_rows, m_cols, m_plane.data(), nullptr); });
+    return shared_ptr<const MapSnapshot>(shared_from_this(), m_snapshot.get());
+}
+
+/**
+ * @brief Replaces the contents of the given map with this one.
+ * Map needs its own plane to be edited, so the words are copied, but nothing gets parsed.
+ * @param map the map to load.
+ */
+void BinaryMap::load(Map& map) const
+{
+    map.load(*snapshot());
+    map.set_tileset(m_tile_width, m_tile_height, tilesetFilename());
+}
+
+/**
+ * @brief Writes the map in the binary format.
+ * Only the passability of the cells is stored, visited and path cells are saved as free.
+ * @param map the map to save.
+ * @param out where to write to, it should have been opened in binary mode.
+ * @param blocks additional metadata to store after the plane, the tileset block is always written.
+ * @return false if writing failed.
+ */
+bool AStarLib::save_binary_map(const Map& map, ostream& out, span<const MapBlock> blocks)
+{
+    if constexpr (endian::native != endian::little) {
+        return false;
+    }
+
+    const auto plane = map.snapshot()->plane();
+
+    const wstring tileset = map.tilesetFilename();
+    vector<char16_t> tileset_units(tileset.begin(), tileset.end());
+
+    vector<MapBlock> all_blocks;
+    all_blocks.push_back({ BinaryMap::tileset_block, as_bytes(span<const char16_t>(tileset_units)) });
+    all_blocks.insert(all_blocks.end(), blocks.begin(), blocks.end());
+
+    FileHeader header{};
+    memcpy(header.magic, magic, sizeof(magic));
+    header.version = BinaryMap::format_version;
+    header.header_size = sizeof(header);
+    header.rows = map.rows();
+    header.cols = map.columns();
+    header.tile_width = map.tilesWidth();
+    header.tile_height = map.tilesHeigth();
+    header.plane_offset = align_up(sizeof(header), plane_alignment);
+    header.plane_words = plane.size();
+    header.blocks_offset = align_up(header.plane_offset + plane.size_bytes(), block_alignment);
+    header.block_count = static_cast<uint32_t>(all_blocks.size());
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_padding(out, sizeof(header), header.plane_offset);
+    out.write(reinterpret_cast<const char*>(plane.data()), static_cast<streamsize>(plane.size_bytes()));
+    write_padding(out, header.plane_offset + plane.size_bytes(), header.blocks_offset);
+
+    uint64_t position = header.blocks_offset;
+    for (const auto& block : all_blocks) {
+        const BlockHeader block_header{ block.tag, 0, block.data.size() };
+        out.write(reinterpret_cast<const char*>(&block_header), sizeof(block_header));
+        out.write(reinterpret_cast<const char*>(block.data.data()), static_cast<streamsize>(block.data.size()));
+
+        position += sizeof(block_header) + block.data.size();
+        const auto next = align_up(position, block_alignment);
+        write_padding(out, position, next);
+        position = next;
+    }
+
+    return static_cast<bool>(out);
+}
+
+/**
+ * @brief Converts a map from the AStarv20 text format into the binary one.
+ * @param text the text map.
+ * @param binary where to write the converted map.
+ * @return false if the text map could not be loaded or the output written.
+ */
+bool AStarLib::convert_text_map(wistream& text, ostream& binary)
+{
+    Map map;
+    if (!map.load(text) || map.rows() <= 0 || map.columns() <= 0) {
+        return false;
+    }
+    return save_binary_map(map, binary);
+}
+
+/**
+ * @brief Converts a map file from the AStarv20 text format into the binary one.
+ * @param from the text map file.
+ * @param to the binary file to write.
+ * @return false if either file could not be used.
+ */
+bool AStarLib::convert_text_map(const filesystem::path& from, const filesystem::path& to)
+{
+    wifstream text(from);
+    if (!text) {
+        return false;
+    }
+
+    ofstream binary(to, ios::binary | ios::trunc);
+    return binary && convert_text_map(text, binary);
+}
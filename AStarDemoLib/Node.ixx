@@ -30,10 +30,17 @@ export namespace AStarLib {
 	{
 	public:
 		explicit Node(int row, int col) noexcept;
+		~Node();
+
+		Node(const Node&) = default;
+		Node& operator= (const Node&) = default;
 
 		void set_parent(std::shared_ptr<Node> parent) noexcept { m_parent = parent; }
 		std::shared_ptr<Node> get_parent() noexcept { return m_parent; }
 
+		// walks the chain without touching the reference counts
+		const Node* parent() const noexcept { return m_parent.get(); }
+
 		// accessor functions
 		int row() const noexcept { return m_row; }
 		int col() const noexcept { return m_col; }
@@ -70,6 +77,18 @@ Node::Node(int row, int col) noexcept : m_row(row), m_col(col), m_cost(0.0), m_e
 
 }
 
+/**
+ * @brief Releases the parents no one else holds one at a time, as letting each one
+ * release the next would recurse once per node and overflow the stack on long paths.
+ */
+Node::~Node()
+{
+	auto parent = std::move(m_parent);
+	while (parent != nullptr && parent.use_count() == 1) {
+		parent = std::move(parent->m_parent);
+	}
+}
+
 /**
  * @brief Assume that two nodes for the same cell are the same node.
  * @param other node to compare
@@ -0,0 +1,513 @@
+/* OpenList.ixx - Indexed priority queue used as the A* open list
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+export module OpenList;
+
+import <algorithm>;
+import <bit>;
+import <cassert>;
+import <cstddef>;
+import <cstdint>;
+import <limits>;
+import <vector>;
+
+export namespace AStarLib {
+
+    /**
+     * 4-ary min heap keyed by cell index.
+     *
+     * Each map cell can be at most once in the heap, and its position is tracked
+     * on a side table, so membership tests are O(1) and decrease-key is O(log n),
+     * instead of the linear search plus full heap rebuild the solver used to do.
+     *
+     * The priorities can be any totally ordered type, the solvers use plain costs,
+     * while incremental searches need lexicographic pairs.
+     */
+    template<typename Key>
+    class BasicIndexedHeap final
+    {
+    public:
+        explicit BasicIndexedHeap(std::size_t capacity = 0);
+
+        void reset(std::size_t capacity);
+        void clear() noexcept;
+
+        bool empty() const noexcept { return m_heap.empty(); }
+        std::size_t size() const noexcept { return m_heap.size(); }
+        std::size_t capacity() const noexcept { return m_position.size(); }
+
+        bool contains(std::size_t index) const noexcept {
+            return index < m_position.size() && m_position[index] != npos;
+        }
+
+        const Key& key(std::size_t index) const noexcept {
+            assert(contains(index));
+            return m_heap[m_position[index]].key;
+        }
+
+        std::size_t top() const noexcept {
+            assert(!empty());
+            return m_heap.front().index;
+        }
+
+        void push(std::size_t index, const Key& key);
+        void decrease_key(std::size_t index, const Key& key) noexcept;
+        void update(std::size_t index, const Key& key) noexcept;
+        void remove(std::size_t index) noexcept;
+        std::size_t pop() noexcept;
+
+    private:
+        static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+        static constexpr std::size_t arity = 4;
+
+        struct Entry {
+            Key key;
+            std::uint32_t index;
+        };
+
+        std::vector<Entry> m_heap;
+        std::vector<std::uint32_t> m_position;
+
+        void sift_up(std::size_t pos) noexcept;
+        void sift_down(std::size_t pos) noexcept;
+        void place(std::size_t pos, const Entry& entry) noexcept;
+    };
+
+    using IndexedHeap = BasicIndexedHeap<double>;
+
+    /**
+     * Bucket queue for small integer priorities, one bucket per priority value.
+     *
+     * The buckets form a ring covering the priorities between the smallest and the
+     * biggest one queued, so when that spread stays bounded, like the f values of an
+     * A* search with integer costs and a consistent heuristic, pushing and popping are
+     * O(1). The ring grows when the spread does not fit anymore.
+     *
+     * Changing a priority queues the cell again, the outdated entry is skipped when
+     * its bucket is reached. Cells with the same priority come out last in, first out.
+     */
+    class BucketQueue final
+    {
+    public:
+        explicit BucketQueue(std::size_t capacity = 0);
+
+        void reset(std::size_t capacity);
+        void clear() noexcept;
+
+        bool empty() const noexcept { return m_size == 0; }
+        std::size_t size() const noexcept { return m_size; }
+        std::size_t capacity() const noexcept { return m_key.size(); }
+
+        bool contains(std::size_t index) const noexcept {
+            return index < m_key.size() && m_key[index] != npos;
+        }
+
+        std::uint32_t key(std::size_t index) const noexcept {
+            assert(contains(index));
+            return m_key[index];
+        }
+
+        void push(std::size_t index, std::uint32_t key);
+        void decrease_key(std::size_t index, std::uint32_t key);
+        void update(std::size_t index, std::uint32_t key);
+        void remove(std::size_t index) noexcept;
+        std::size_t pop() noexcept;
+
+    private:
+        static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+        struct Entry {
+            std::uint32_t index;
+            std::uint32_t key;
+        };
+
+        std::vector<std::vector<Entry>> m_buckets;
+        std::vector<std::uint32_t> m_key;
+        std::size_t m_size = 0;
+        std::uint32_t m_mask = 0;
+
+        // every entry, outdated ones included, has a priority in [m_first, m_last]
+        std::uint32_t m_first = 0;
+        std::uint32_t m_last = 0;
+
+        void insert(std::size_t index, std::uint32_t key);
+        void grow(std::uint32_t spread);
+    };
+}
+
+// make the standard C++ library available on the local namespace
+using namespace std;
+
+// also to reduce typing
+using namespace AStarLib;
+
+/**
+ * @brief Constructs the heap, able to index cells in the range [0, capacity).
+ * @param capacity the amount of cells that can be stored.
+ */
+template<typename Key>
+BasicIndexedHeap<Key>::BasicIndexedHeap(size_t capacity)
+{
+    reset(capacity);
+}
+
+/**
+ * @brief Empties the heap and resizes the index table to the given amount of cells.
+ * @param capacity the amount of cells that can be stored.
+ */
+template<typename Key>
+void BasicIndexedHeap<Key>::reset(size_t capacity)
+{
+    assert(capacity < npos);
+
+    clear();
+    m_position.assign(capacity, npos);
+    m_heap.reserve(capacity / 4);
+}
+
+/**
+ * @brief Removes all elements, only touching the cells that were still queued.
+ */
+template<typename Key>
+void BasicIndexedHeap<Key>::clear() noexcept
+{
+    for (const auto& entry : m_heap) {
+        m_position[entry.index] = npos;
+    }
+    m_heap.clear();
+}
+
+/**
+ * @brief Adds a new cell into the heap.
+ * @param index the cell index, it must not be already queued.
+ * @param key the priority, smaller values are popped first.
+ */
+template<typename Key>
+void BasicIndexedHeap<Key>::push(size_t index, const Key& key)
+{
+    assert(index < m_position.size());
+    assert(!contains(index));
+
+    m_heap.push_back({ key, static_cast<uint32_t>(index) });
+    m_position[index] = static_cast<uint32_t>(m_heap.size() - 1);
+    sift_up(m_heap.size() - 1);
+}
+
+/**
+ * @brief Lowers the priority of a cell that is already queued.
+ * @param index the cell index.
+ * @param key the new priority, it must not be bigger than the current one.
+ */
+template<typename Key>
+void BasicIndexedHeap<Key>::decrease_key(size_t index, const Key& key) noexcept
+{
+    assert(contains(index));
+
+    const size_t pos = m_position[index];
+    assert(key <= m_heap[pos].key);
+
+    m_heap[pos].key = key;
+    sift_up(pos);
+}
+
+/**
+ * @brief Changes the priority of a cell that is already queued, in either direction.
+ * @param index the cell index.
+ * @param key the new priority.
+ */
+template<typename Key>
+void BasicIndexedHeap<Key>::update(size_t index, const Key& key) noexcept
+{
+    assert(contains(index));
+
+    const size_t pos = m_position[index];
+    const bool lower = key < m_heap[pos].key;
+
+    m_heap[pos].key = key;
+    if (lower) {
+        sift_up(pos);
+    }
+    else {
+        sift_down(pos);
+    }
+}
+
+/**
+ * @brief Takes a cell out of the heap, wherever it is.
+ * @param index the cell index, it must be queued.
+ */
+template<typename Key>
+void BasicIndexedHeap<Key>::remove(size_t index) noexcept
+{
+    assert(contains(index));
+
+    const size_t pos = m_position[index];
+    m_position[index] = npos;
+
+    const Entry last = m_heap.back();
+    m_heap.pop_back();
+    if (pos < m_heap.size()) {
+        // the last entry fills the hole, and may need to move either way
+        const bool lower = last.key < m_heap[pos].key;
+        place(pos, last);
+        if (lower) {
+            sift_up(pos);
+        }
+        else {
+            sift_down(pos);
+        }
+    }
+}
+
+/**
+ * @brief Removes the cell with the smallest priority.
+ * @return the removed cell index.
+ */
+template<typename Key>
+size_t BasicIndexedHeap<Key>::pop() noexcept
+{
+    assert(!empty());
+
+    const size_t index = m_heap.front().index;
+    m_position[index] = npos;
+
+    const Entry last = m_heap.back();
+    m_heap.pop_back();
+    if (!m_heap.empty()) {
+        place(0, last);
+        sift_down(0);
+    }
+
+    return index;
+}
+
+/**
+ * Stores the entry at the given position, keeping the index table in sync.
+ */
+template<typename Key>
+void BasicIndexedHeap<Key>::place(size_t pos, const Entry& entry) noexcept
+{
+    m_heap[pos] = entry;
+    m_position[entry.index] = static_cast<uint32_t>(pos);
+}
+
+template<typename Key>
+void BasicIndexedHeap<Key>::sift_up(size_t pos) noexcept
+{
+    const Entry entry = m_heap[pos];
+
+    while (pos > 0) {
+        const size_t parent = (pos - 1) / arity;
+        if (m_heap[parent].key <= entry.key) {
+            break;
+        }
+        place(pos, m_heap[parent]);
+        pos = parent;
+    }
+    place(pos, entry);
+}
+
+template<typename Key>
+void BasicIndexedHeap<Key>::sift_down(size_t pos) noexcept
+{
+    const Entry entry = m_heap[pos];
+    const size_t count = m_heap.size();
+
+    while (true) {
+        const size_t first = pos * arity + 1;
+        if (first >= count) {
+            break;
+        }
+
+        // pick the smallest child
+        const size_t last = min(first + arity, count);
+        size_t best = first;
+        for (size_t child = first + 1; child < last; ++child) {
+            if (m_heap[child].key < m_heap[best].key) {
+                best = child;
+            }
+        }
+
+        if (entry.key <= m_heap[best].key) {
+            break;
+        }
+        place(pos, m_heap[best]);
+        pos = best;
+    }
+    place(pos, entry);
+}
+
+
+/**
+ * @brief Constructs the queue, able to index cells in the range [0, capacity).
+ * @param capacity the amount of cells that can be stored.
+ */
+BucketQueue::BucketQueue(size_t capacity) : m_buckets(8)
+{
+    m_mask = static_cast<uint32_t>(m_buckets.size() - 1);
+    reset(capacity);
+}
+
+/**
+ * @brief Empties the queue and resizes the index table to the given amount of cells.
+ * @param capacity the amount of cells that can be stored.
+ */
+void BucketQueue::reset(size_t capacity)
+{
+    assert(capacity < npos);
+
+    clear();
+    m_key.assign(capacity, npos);
+}
+
+/**
+ * @brief Removes all elements, only touching the buckets and the cells that were still queued.
+ */
+void BucketQueue::clear() noexcept
+{
+    for (auto& bucket : m_buckets) {
+        for (const auto& entry : bucket) {
+            m_key[entry.index] = npos;
+        }
+        bucket.clear();
+    }
+    m_size = 0;
+}
+
+/**
+ * @brief Adds a new cell into the queue.
+ * @param index the cell index, it must not be already queued.
+ * @param key the priority, smaller values are popped first.
+ */
+void BucketQueue::push(size_t index, uint32_t key)
+{
+    assert(index < m_key.size());
+    assert(!contains(index));
+
+    if (m_size == 0) {
+        // only outdated entries are left, start the ring over at this priority
+        clear();
+        m_first = key;
+        m_last = key;
+    }
+
+    ++m_size;
+    insert(index, key);
+}
+
+/**
+ * @brief Lowers the priority of a cell that is already queued.
+ * @param index the cell index.
+ * @param key the new priority, it must not be bigger than the current one.
+ */
+void BucketQueue::decrease_key(size_t index, uint32_t key)
+{
+    assert(contains(index));
+    assert(key <= m_key[index]);
+
+    insert(index, key);
+}
+
+/**
+ * @brief Changes the priority of a cell that is already queued, in either direction.
+ * @param index the cell index.
+ * @param key the new priority.
+ */
+void BucketQueue::update(size_t index, uint32_t key)
+{
+    assert(contains(index));
+
+    insert(index, key);
+}
+
+/**
+ * @brief Takes a cell out of the queue, its entry is left behind as outdated.
+ * @param index the cell index, it must be queued.
+ */
+void BucketQueue::remove(size_t index) noexcept
+{
+    assert(contains(index));
+
+    m_key[index] = npos;
+    --m_size;
+}
+
+/**
+ * @brief Removes the cell with the smallest priority.
+ * @return the removed cell index.
+ */
+size_t BucketQueue::pop() noexcept
+{
+    assert(!empty());
+
+    while (true) {
+        auto& bucket = m_buckets[m_first & m_mask];
+        while (!bucket.empty()) {
+            const Entry entry = bucket.back();
+            bucket.pop_back();
+
+            // skip the entries left behind by priority changes and removals
+            if (m_key[entry.index] == entry.key) {
+                m_key[entry.index] = npos;
+                --m_size;
+                return entry.index;
+            }
+        }
+
+        assert(m_first < m_last);
+        ++m_first;
+    }
+}
+
+/**
+ * Queues an entry for the cell, growing the ring when its priority does not fit.
+ */
+void BucketQueue::insert(size_t index, uint32_t key)
+{
+    const uint32_t first = min(m_first, key);
+    const uint32_t last = max(m_last, key);
+    if (last - first > m_mask) {
+        grow(last - first);
+    }
+
+    m_first = first;
+    m_last = last;
+    m_key[index] = key;
+    m_buckets[key & m_mask].push_back({ static_cast<uint32_t>(index), key });
+}
+
+/**
+ * Enlarges the ring to cover the given spread of priorities, moving the entries to their new buckets.
+ */
+void BucketQueue::grow(uint32_t spread)
+{
+    vector<vector<Entry>> buckets(bit_ceil(static_cast<size_t>(spread) + 1));
+    const uint32_t mask = static_cast<uint32_t>(buckets.size() - 1);
+
+    for (auto& bucket : m_buckets) {
+        for (const auto& entry : bucket) {
+            // the outdated entries can be dropped on the way
+            if (m_key[entry.index] == entry.key) {
+                buckets[entry.key & mask].push_back(entry);
+            }
+        }
+    }
+
+    m_buckets = std::move(buckets);
+    m_mask = mask;
+}
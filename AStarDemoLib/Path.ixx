@@ -0,0 +1,191 @@
+/* Path.ixx - Paths stored as contiguous cells
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+export module Path;
+
+import <algorithm>;
+import <cstddef>;
+import <cstdint>;
+import <cstdlib>;
+import <span>;
+import <vector>;
+
+import Node;
+
+export namespace AStarLib {
+
+    /**
+     * A cell along a path.
+     */
+    export struct PathPoint {
+        std::int32_t row;
+        std::int32_t col;
+
+        bool operator==(const PathPoint&) const noexcept = default;
+    };
+
+    /**
+     * A path stored as its cells one after the other, from the start to the goal.
+     *
+     * Unlike a chain of Node, copying or dropping it costs a single allocation at most,
+     * and it can be reused across searches without giving its memory back.
+     *
+     * waypoints() only keeps the cells where the path turns, the ones in between are on
+     * a straight or diagonal line and expanded() puts them back.
+     */
+    export class Path final
+    {
+    public:
+        Path() = default;
+        Path(std::vector<PathPoint> points, double cost) noexcept;
+
+        static Path from_nodes(const Node* end);
+
+        bool empty() const noexcept { return m_points.empty(); }
+        std::size_t size() const noexcept { return m_points.size(); }
+        double cost() const noexcept { return m_cost; }
+
+        const PathPoint& operator[](std::size_t index) const noexcept { return m_points[index]; }
+        const PathPoint& front() const noexcept { return m_points.front(); }
+        const PathPoint& back() const noexcept { return m_points.back(); }
+        auto begin() const noexcept { return m_points.begin(); }
+        auto end() const noexcept { return m_points.end(); }
+        std::span<const PathPoint> points() const noexcept { return m_points; }
+
+        std::span<PathPoint> resize(std::size_t size, double cost);
+        void clear() noexcept;
+
+        Path waypoints() const;
+        Path expanded() const;
+
+    private:
+        std::vector<PathPoint> m_points;
+        double m_cost = 0.0;
+    };
+}
+
+// make the standard C++ library available on the local namespace
+using namespace std;
+
+// also to reduce typing
+using namespace AStarLib;
+
+
+Path::Path(vector<PathPoint> points, double cost) noexcept : m_points(std::move(points)), m_cost(cost)
+{
+}
+
+/**
+ * @brief Copies a chain of nodes, as returned by the solvers find().
+ * @param end the goal node, its parents lead back to the start
+ * @return an empty path for a null node.
+ */
+Path Path::from_nodes(const Node* end)
+{
+    Path path;
+    if (end == nullptr) {
+        return path;
+    }
+
+    for (auto node = end; node != nullptr; node = node->parent()) {
+        path.m_points.push_back({ node->row(), node->col() });
+    }
+    reverse(path.m_points.begin(), path.m_points.end());
+    path.m_cost = end->cost();
+    return path;
+}
+
+/**
+ * @brief Changes the number of cells, keeping the memory already allocated.
+ * @param size how many cells the path has
+ * @param cost the cost of walking the path
+ * @return the cells, for the caller to fill in.
+ */
+span<PathPoint> Path::resize(size_t size, double cost)
+{
+    m_points.resize(size);
+    m_cost = cost;
+    return m_points;
+}
+
+/**
+ * @brief Empties the path, keeping the memory already allocated.
+ */
+void Path::clear() noexcept
+{
+    m_points.clear();
+    m_cost = 0.0;
+}
+
+/**
+ * @brief The same path, only with its first and last cells and the ones where it turns.
+ */
+Path Path::waypoints() const
+{
+    Path compressed;
+    compressed.m_cost = m_cost;
+    if (m_points.size() <= 2) {
+        compressed.m_points = m_points;
+        return compressed;
+    }
+
+    const auto direction = [](const PathPoint& from, const PathPoint& to) {
+        return PathPoint{ (to.row > from.row) - (to.row < from.row), (to.col > from.col) - (to.col < from.col) };
+    };
+
+    compressed.m_points.push_back(m_points.front());
+    for (size_t i = 1; i + 1 < m_points.size(); ++i) {
+        if (direction(m_points[i - 1], m_points[i]) != direction(m_points[i], m_points[i + 1])) {
+            compressed.m_points.push_back(m_points[i]);
+        }
+    }
+    compressed.m_points.push_back(m_points.back());
+    return compressed;
+}
+
+/**
+ * @brief The same path with every cell, filling in the lines between the waypoints.
+ * When two waypoints are not on a straight or diagonal line, the cells in between go
+ * diagonally first, as an octile move would.
+ */
+Path Path::expanded() const
+{
+    Path full;
+    full.m_cost = m_cost;
+    if (m_points.empty()) {
+        return full;
+    }
+
+    size_t cells = 1;
+    for (size_t i = 1; i < m_points.size(); ++i) {
+        cells += static_cast<size_t>(max(abs(m_points[i].row - m_points[i - 1].row), abs(m_points[i].col - m_points[i - 1].col)));
+    }
+    full.m_points.reserve(cells);
+
+    full.m_points.push_back(m_points.front());
+    for (size_t i = 1; i < m_points.size(); ++i) {
+        auto current = m_points[i - 1];
+        const auto& target = m_points[i];
+        while (current != target) {
+            current.row += (target.row > current.row) - (target.row < current.row);
+            current.col += (target.col > current.col) - (target.col < current.col);
+            full.m_points.push_back(current);
+        }
+    }
+    return full;
+}
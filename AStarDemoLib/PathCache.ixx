@@ -0,0 +1,382 @@
+/* PathCache.ixx - Caches found paths until the map changes around them
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+export module PathCache;
+
+import <memory>;
+import <list>;
+import <unordered_map>;
+import <optional>;
+import <vector>;
+import <utility>;
+import <algorithm>;
+import <cassert>;
+import <cstddef>;
+import <cstdint>;
+import <cmath>;
+
+import Node;
+import Map;
+import SearchPolicies;
+
+export namespace AStarLib {
+
+    /**
+     * Least recently used cache of the paths found on a map.
+     *
+     * Besides the exact (start, goal) pairs, queries that share the start or the goal
+     * of a cached path and have the other end on it are answered from that path too,
+     * as any part of a shortest path is a shortest path itself.
+     *
+     * Edits need not be reported, the cells changed since the last call are taken
+     * from Map::changes_since() once the passability version moves, and only the paths
+     * they can affect are evicted: those going through or next to a blocked cell, and
+     * those that could get shorter through an unblocked one. When the log does not go
+     * back far enough, or the whole map was replaced, the cache is emptied.
+     *
+     * The returned paths are shared with the cache and must not be modified.
+     */
+    export class PathCache final
+    {
+    public:
+        using NodePtr = std::shared_ptr<Node>;
+
+        explicit PathCache(const Map& map, std::size_t capacity = 1024);
+
+        std::optional<NodePtr> lookup(int start_row, int start_col, int goal_row, int goal_col);
+        void store(int start_row, int start_col, int goal_row, int goal_col, NodePtr path);
+
+        template<typename Solver>
+        NodePtr find(Solver& solver, NodePtr start, NodePtr goal);
+
+        void clear() noexcept;
+
+        std::size_t size() const noexcept { return m_entries.size(); }
+        std::size_t capacity() const noexcept { return m_capacity; }
+        std::size_t hits() const noexcept { return m_hits; }
+        std::size_t misses() const noexcept { return m_misses; }
+
+    private:
+        struct Entry {
+            std::uint64_t key;
+            std::uint32_t start, goal;
+            NodePtr path;
+            int min_row, min_col, max_row, max_col;
+        };
+
+        using Iterator = std::list<Entry>::iterator;
+
+        const Map& m_map;
+        std::size_t m_capacity;
+        std::uint64_t m_version;
+        std::uint64_t m_change_version;
+        int m_columns;
+        std::list<Entry> m_entries;
+        std::unordered_map<std::uint64_t, Iterator> m_index;
+        std::unordered_multimap<std::uint32_t, Iterator> m_by_start;
+        std::unordered_multimap<std::uint32_t, Iterator> m_by_goal;
+        std::size_t m_hits, m_misses;
+        std::vector<std::pair<int, int>> m_changed;
+
+        std::uint32_t cell_index(int row, int col) const noexcept {
+            return static_cast<std::uint32_t>(row * m_columns + col);
+        }
+
+        static std::uint64_t make_key(std::uint32_t start, std::uint32_t goal) noexcept {
+            return (std::uint64_t{ start } << 32) | goal;
+        }
+
+        void validate();
+        void cell_changed(int row, int col);
+        void evict(Iterator entry);
+        NodePtr prefix(const Entry& entry, std::uint32_t goal) const;
+        NodePtr suffix(const Entry& entry, std::uint32_t start) const;
+        bool touches(const Entry& entry, int row, int col) const;
+        bool could_shorten(const Entry& entry, int row, int col) const;
+    };
+}
+
+// make the standard C++ library available on the local namespace
+using namespace std;
+
+// also to reduce typing
+using namespace AStarLib;
+
+/**
+ * @brief Looks the query up, and only runs the solver on a miss, caching what it finds.
+ * @param solver any solver with the AStarSolver::find interface, searching the same map
+ * @param start where to start searching from
+ * @param goal the target destination
+ * @return null if nothing was found, the reversed path otherwise.
+ */
+template<typename Solver>
+PathCache::NodePtr PathCache::find(Solver& solver, NodePtr start, NodePtr goal)
+{
+    const int start_row = start->row(), start_col = start->col();
+    const int goal_row = goal->row(), goal_col = goal->col();
+
+    if (auto cached = lookup(start_row, start_col, goal_row, goal_col)) {
+        return *cached;
+    }
+
+    auto path = solver.find(std::move(start), std::move(goal));
+    store(start_row, start_col, goal_row, goal_col, path);
+    return path;
+}
+
+/**
+ * @brief Constructs an empty cache.
+ * @param map the map the paths are searched on, it must outlive the cache
+ * @param capacity the amount of paths kept at most
+ */
+PathCache::PathCache(const Map& map, size_t capacity) :
+    m_map(map), m_capacity{ max<size_t>(capacity, 1) }, m_version{ map.passability_version() }, m_change_version{ map.version() },
+    m_columns{ map.columns() },
+    m_hits{ 0 }, m_misses{ 0 }
+{
+}
+
+/**
+ * @brief Finds a cached answer for the query.
+ * @return nothing on a miss, otherwise the path, which is null when the goal is known to be unreachable
+ */
+optional<PathCache::NodePtr> PathCache::lookup(int start_row, int start_col, int goal_row, int goal_col)
+{
+    validate();
+
+    const auto start = cell_index(start_row, start_col);
+    const auto goal = cell_index(goal_row, goal_col);
+
+    if (const auto found = m_index.find(make_key(start, goal)); found != m_index.end()) {
+        m_entries.splice(m_entries.begin(), m_entries, found->second);
+        ++m_hits;
+        return found->second->path;
+    }
+
+    // same start, the goal somewhere along the path
+    for (auto [entry, last] = m_by_start.equal_range(start); entry != last; ++entry) {
+        if (auto path = prefix(*entry->second, goal)) {
+            m_entries.splice(m_entries.begin(), m_entries, entry->second);
+            ++m_hits;
+            return path;
+        }
+    }
+
+    // same goal, the start somewhere along the path
+    for (auto [entry, last] = m_by_goal.equal_range(goal); entry != last; ++entry) {
+        if (auto path = suffix(*entry->second, start)) {
+            m_entries.splice(m_entries.begin(), m_entries, entry->second);
+            ++m_hits;
+            return path;
+        }
+    }
+
+    ++m_misses;
+    return nullopt;
+}
+
+/**
+ * @brief Caches the answer of a query, evicting the least recently used one when full.
+ * @param path the path found, as returned by the solvers, or null when there is none
+ */
+void PathCache::store(int start_row, int start_col, int goal_row, int goal_col, NodePtr path)
+{
+    validate();
+
+    const auto start = cell_index(start_row, start_col);
+    const auto goal = cell_index(goal_row, goal_col);
+    const auto key = make_key(start, goal);
+
+    if (const auto found = m_index.find(key); found != m_index.end()) {
+        evict(found->second);
+    }
+    if (m_entries.size() == m_capacity) {
+        evict(prev(m_entries.end()));
+    }
+
+    Entry entry{ key, start, goal, path, start_row, start_col, start_row, start_col };
+    for (auto node = path; node != nullptr; node = node->get_parent()) {
+        entry.min_row = min(entry.min_row, node->row());
+        entry.min_col = min(entry.min_col, node->col());
+        entry.max_row = max(entry.max_row, node->row());
+        entry.max_col = max(entry.max_col, node->col());
+    }
+
+    m_entries.push_front(std::move(entry));
+    m_index.emplace(key, m_entries.begin());
+    if (path != nullptr) {
+        m_by_start.emplace(start, m_entries.begin());
+        m_by_goal.emplace(goal, m_entries.begin());
+    }
+}
+
+/**
+ * @brief Drops every cached path, the counters are kept.
+ */
+void PathCache::clear() noexcept
+{
+    m_index.clear();
+    m_by_start.clear();
+    m_by_goal.clear();
+    m_entries.clear();
+}
+
+/**
+ * Catches up with the edits made to the map since the last call.
+ * The log doesn't say which cells flipped, so every changed cell is taken to be one.
+ */
+void PathCache::validate()
+{
+    // read first, a flip landing after it is also in the log and simply seen twice
+    const auto version = m_map.passability_version();
+    if (m_columns != m_map.columns()) {
+        clear();
+        m_version = version;
+        m_change_version = m_map.version();
+        m_columns = m_map.columns();
+        return;
+    }
+    if (version == m_version) {
+        return;
+    }
+
+    const auto changes = m_map.changes_since(m_change_version, m_changed);
+    if (changes.everything) {
+        clear();
+    } else {
+        for (const auto& [row, col] : m_changed) {
+            cell_changed(row, col);
+        }
+    }
+    m_version = version;
+    m_change_version = changes.version;
+}
+
+/**
+ * Evicts the paths a flip of the cell can affect, going by its current state.
+ */
+void PathCache::cell_changed(int row, int col)
+{
+    const bool blocked = !m_map.passable(row, col);
+
+    for (auto entry = m_entries.begin(); entry != m_entries.end();) {
+        const auto current = entry++;
+        const bool affected = blocked ?
+            current->path != nullptr && touches(*current, row, col) :
+            current->path == nullptr || could_shorten(*current, row, col);
+        if (affected) {
+            evict(current);
+        }
+    }
+}
+
+void PathCache::evict(Iterator entry)
+{
+    const auto unindex = [entry](unordered_multimap<uint32_t, Iterator>& index, uint32_t cell) {
+        for (auto [found, last] = index.equal_range(cell); found != last; ++found) {
+            if (found->second == entry) {
+                index.erase(found);
+                return;
+            }
+        }
+    };
+
+    unindex(m_by_start, entry->start);
+    unindex(m_by_goal, entry->goal);
+    m_index.erase(entry->key);
+    m_entries.erase(entry);
+}
+
+/**
+ * The part of a cached path from its start to the given cell.
+ * The nodes already link back to the start, so they are shared as they are.
+ * @return the node of the given cell, null if the path doesn't go through it
+ */
+PathCache::NodePtr PathCache::prefix(const Entry& entry, uint32_t goal) const
+{
+    for (auto node = entry.path; node != nullptr; node = node->get_parent()) {
+        if (cell_index(node->row(), node->col()) == goal) {
+            return node;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * The part of a cached path from the given cell to its goal.
+ * The nodes link back to the original start, so that part is copied with its costs rebased.
+ * @return the goal node of the copy, null if the path doesn't go through the cell
+ */
+PathCache::NodePtr PathCache::suffix(const Entry& entry, uint32_t start) const
+{
+    auto from = entry.path;
+    while (from != nullptr && cell_index(from->row(), from->col()) != start) {
+        from = from->get_parent();
+    }
+    if (from == nullptr) {
+        return nullptr;
+    }
+
+    // copied backwards, from the goal down to the new start
+    const double base = from->cost();
+    auto goal = make_shared<Node>(entry.path->row(), entry.path->col());
+    auto copy = goal;
+    for (auto node = entry.path; node != from; node = node->get_parent()) {
+        copy->set_cost(node->cost() - base);
+        copy->set_estimation(node->estimation());
+
+        const auto parent = node->get_parent();
+        auto next = make_shared<Node>(parent->row(), parent->col());
+        copy->set_parent(next);
+        copy = std::move(next);
+    }
+    copy->set_cost(0.0);
+    copy->set_estimation(from->estimation());
+
+    return goal;
+}
+
+/**
+ * Whether the path goes through the cell or one of its neighbours.
+ */
+bool PathCache::touches(const Entry& entry, int row, int col) const
+{
+    if (row < entry.min_row - 1 || row > entry.max_row + 1 || col < entry.min_col - 1 || col > entry.max_col + 1) {
+        return false;
+    }
+
+    for (auto node = entry.path; node != nullptr; node = node->get_parent()) {
+        if (abs(node->row() - row) <= 1 && abs(node->col() - col) <= 1) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Whether going through the cell could beat the cached path. The solvers heuristic
+ * never overestimates the real distances, so paths failing this test can be kept.
+ */
+bool PathCache::could_shorten(const Entry& entry, int row, int col) const
+{
+    const auto distance = [this, row, col](uint32_t cell) {
+        return EuclideanHeuristic::estimate<StandardCost>(abs(static_cast<int>(cell) % m_columns - col), abs(static_cast<int>(cell) / m_columns - row));
+    };
+
+    return distance(entry.start) + distance(entry.goal) < entry.path->cost();
+}
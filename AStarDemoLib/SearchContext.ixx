@@ -0,0 +1,197 @@
+/* SearchContext.ixx - Reusable per search scratch memory
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+export module SearchContext;
+
+import <cassert>;
+import <chrono>;
+import <cstddef>;
+import <cstdint>;
+import <limits>;
+import <vector>;
+
+import OpenList;
+
+export namespace AStarLib {
+
+    /**
+     * Counters describing the last search done by a solver.
+     */
+    export struct SearchStats {
+        std::size_t expansions = 0;
+        std::size_t pushes = 0;
+        std::size_t pops = 0;
+        std::size_t decrease_keys = 0;
+        std::size_t peak_open = 0;
+        std::chrono::nanoseconds elapsed{};
+
+        std::size_t heap_operations() const noexcept { return pushes + pops + decrease_keys; }
+    };
+
+    /**
+     * Where a resumable search stands.
+     */
+    export enum class SearchStatus : std::uint8_t { IDLE, RUNNING, FOUND, NOT_FOUND, CANCELLED };
+
+    /**
+     * Adds the time spent between its construction and destruction, whichever way the search ends.
+     */
+    export class SearchTimer final
+    {
+    public:
+        explicit SearchTimer(std::chrono::nanoseconds& elapsed) noexcept :
+            m_elapsed(elapsed), m_started(std::chrono::steady_clock::now()) {}
+
+        ~SearchTimer() {
+            m_elapsed += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_started);
+        }
+
+        SearchTimer(const SearchTimer&) = delete;
+        SearchTimer& operator=(const SearchTimer&) = delete;
+
+    private:
+        std::chrono::nanoseconds& m_elapsed;
+        std::chrono::steady_clock::time_point m_started;
+    };
+
+    /**
+     * Where a cell stands on a search.
+     */
+    export enum class SearchCellState : std::uint8_t { UNSEEN, OPEN, CLOSED };
+
+    /**
+     * Scratch memory for a search, stored as one array per field and indexed by cell.
+     *
+     * Each cell is tagged with the generation of the search that last touched it,
+     * so starting a new search only requires bumping the generation counter instead
+     * of clearing every array. Once the arrays are sized for a map, searching does not
+     * allocate memory anymore.
+     *
+     * The costs are doubles kept on an IndexedHeap for most solvers, integer costs on a
+     * BucketQueue take less memory per cell and make the open list operations O(1).
+     */
+    template<typename Cost, typename Queue>
+    class BasicSearchContext final
+    {
+    public:
+        using CellState = SearchCellState;
+        using CostType = Cost;
+
+        static constexpr std::uint32_t no_parent = std::numeric_limits<std::uint32_t>::max();
+
+        explicit BasicSearchContext(std::size_t cells = 0);
+
+        void prepare(std::size_t cells);
+
+        std::size_t cells() const noexcept { return m_cost.size(); }
+
+        CellState state(std::size_t index) const noexcept {
+            assert(index < cells());
+            return m_generation[index] == m_current ? m_state[index] : CellState::UNSEEN;
+        }
+
+        Cost cost(std::size_t index) const noexcept {
+            assert(state(index) != CellState::UNSEEN);
+            return m_cost[index];
+        }
+
+        std::uint32_t parent(std::size_t index) const noexcept {
+            assert(state(index) != CellState::UNSEEN);
+            return m_parent[index];
+        }
+
+        void open(std::size_t index, Cost cost, std::uint32_t parent) noexcept {
+            assert(index < cells());
+            m_generation[index] = m_current;
+            m_state[index] = CellState::OPEN;
+            m_cost[index] = cost;
+            m_parent[index] = parent;
+        }
+
+        void update(std::size_t index, Cost cost, std::uint32_t parent) noexcept {
+            assert(state(index) == CellState::OPEN);
+            m_cost[index] = cost;
+            m_parent[index] = parent;
+        }
+
+        void close(std::size_t index) noexcept {
+            assert(state(index) == CellState::OPEN);
+            m_state[index] = CellState::CLOSED;
+        }
+
+        Queue& open_list() noexcept { return m_open_list; }
+
+    private:
+        std::vector<Cost> m_cost;
+        std::vector<std::uint32_t> m_parent;
+        std::vector<std::uint32_t> m_generation;
+        std::vector<CellState> m_state;
+        std::uint32_t m_current;
+        Queue m_open_list;
+    };
+
+    using SearchContext = BasicSearchContext<double, IndexedHeap>;
+    using IntegerSearchContext = BasicSearchContext<std::uint32_t, BucketQueue>;
+}
+
+// make the standard C++ library available on the local namespace
+using namespace std;
+
+// also to reduce typing
+using namespace AStarLib;
+
+/**
+ * @brief Constructs the context with room for the given amount of cells.
+ * @param cells the amount of map cells
+ */
+template<typename Cost, typename Queue>
+BasicSearchContext<Cost, Queue>::BasicSearchContext(size_t cells) : m_current{ 0 }
+{
+    prepare(cells);
+}
+
+/**
+ * @brief Starts a new search, forgetting everything about the previous one.
+ * The arrays are only reallocated when the map size changes.
+ * @param cells the amount of map cells
+ */
+template<typename Cost, typename Queue>
+void BasicSearchContext<Cost, Queue>::prepare(size_t cells)
+{
+    if (cells != this->cells()) {
+        m_cost.resize(cells);
+        m_parent.resize(cells);
+        m_state.resize(cells);
+        m_generation.assign(cells, 0);
+        m_open_list.reset(cells);
+        m_current = 0;
+    }
+    else {
+        m_open_list.clear();
+    }
+
+    // on wrap around the old tags could be mistaken for the current search
+    if (++m_current == 0) {
+        m_generation.assign(cells, 0);
+        m_current = 1;
+    }
+}
+
+// the contexts used by the solvers are compiled once here
+template class AStarLib::BasicSearchContext<double, IndexedHeap>;
+template class AStarLib::BasicSearchContext<uint32_t, BucketQueue>;
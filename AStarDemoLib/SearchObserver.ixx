@@ -0,0 +1,81 @@
+/* SearchObserver.ixx - Hooks into the solvers search loops
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+export module SearchObserver;
+
+import <format>;
+import <string>;
+
+import Map;
+import Logger;
+
+export namespace AStarLib {
+
+    /**
+     * Types that can watch a search, given as a template argument to the solvers find().
+     *
+     * on_push and on_decrease_key get the key the cell was queued with, on_expand the cost
+     * of reaching the cell whose neighbours are about to be looked at. on_close is called
+     * for every cell taken from the open list, including the goal, which is not expanded.
+     */
+    export template<typename T>
+    concept SearchObserver = requires(T& observer, int row, int col, double value) {
+        observer.on_push(row, col, value);
+        observer.on_decrease_key(row, col, value);
+        observer.on_close(row, col);
+        observer.on_expand(row, col, value);
+    };
+
+    /**
+     * Observer used by default, all its hooks compile down to nothing.
+     */
+    export struct NullObserver {
+        void on_push(int, int, double) noexcept {}
+        void on_decrease_key(int, int, double) noexcept {}
+        void on_close(int, int) noexcept {}
+        void on_expand(int, int, double) noexcept {}
+    };
+
+    /**
+     * Marks the closed cells as visited on a map, so that the searched area can be drawn.
+     */
+    export class MapVisitObserver {
+    public:
+        explicit MapVisitObserver(Map& map) noexcept : m_map(map) {}
+
+        void on_push(int, int, double) noexcept {}
+        void on_decrease_key(int, int, double) noexcept {}
+        void on_close(int row, int col) { m_map.visit(row, col); }
+        void on_expand(int, int, double) noexcept {}
+
+    private:
+        Map& m_map;
+    };
+
+    /**
+     * Sends every event to the log, to follow a search step by step.
+     */
+    export struct LogObserver {
+        void on_push(int row, int col, double key) { LogInfo(std::format("Pushing ({}, {}) with key {}", col, row, key)); }
+        void on_decrease_key(int row, int col, double key) { LogInfo(std::format("Decreasing ({}, {}) to key {}", col, row, key)); }
+        void on_close(int row, int col) { LogInfo(std::format("Closing ({}, {})", col, row)); }
+        void on_expand(int row, int col, double cost) { LogInfo(std::format("Expanding ({}, {}) with cost {}", col, row, cost)); }
+    };
+
+    static_assert(SearchObserver<NullObserver> && SearchObserver<MapVisitObserver> && SearchObserver<LogObserver>);
+}
@@ -0,0 +1,207 @@
+/* SearchPolicies.ixx - Heuristics, costs and moves the A* solver can be built with
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+export module SearchPolicies;
+
+import <algorithm>;
+import <cmath>;
+import <cstdint>;
+import <type_traits>;
+
+import Map;
+import SearchContext;
+
+export namespace AStarLib {
+
+    /**
+     * The costs of the moves, the solvers default ones make the diagonals a bit dearer.
+     * Context is the search state the costs are kept on, and scale converts them back
+     * into map distances for the returned paths.
+     */
+    export struct StandardCost {
+        using Context = SearchContext;
+        static constexpr double straight = 1.0;
+        static constexpr double diagonal = 1.5;
+        static constexpr double scale = 1.0;
+    };
+
+    /**
+     * Diagonal moves costing their real length.
+     */
+    export struct OctileCost {
+        using Context = SearchContext;
+        static constexpr double straight = 1.0;
+        static constexpr double diagonal = 1.4142135623730951;
+        static constexpr double scale = 1.0;
+    };
+
+    /**
+     * The standard costs counted in half steps, so that they are exact integers.
+     * The search state then takes less memory, and the open list is a bucket queue.
+     * Needs a consistent heuristic to be fast, like OctileHeuristic or ZeroHeuristic.
+     */
+    export struct IntegerCost {
+        using Context = IntegerSearchContext;
+        static constexpr std::uint32_t straight = 2;
+        static constexpr std::uint32_t diagonal = 3;
+        static constexpr double scale = 0.5;
+    };
+
+    /**
+     * Straight line distance, the solvers default heuristic.
+     * Admissible for any cost model whose diagonals cost at least sqrt(2) straight moves.
+     */
+    export struct EuclideanHeuristic {
+        template<typename Cost>
+        static auto estimate(int dx, int dy) noexcept {
+            using Value = typename Cost::Context::CostType;
+
+            // integer costs round down, so that it stays admissible
+            return static_cast<Value>(std::sqrt(static_cast<double>(dx * dx + dy * dy)) * Cost::straight);
+        }
+    };
+
+    /**
+     * Exact distance on an empty map with 8 connectivity, the tightest admissible one for those moves.
+     */
+    export struct OctileHeuristic {
+        template<typename Cost>
+        static auto estimate(int dx, int dy) noexcept {
+            using Value = typename Cost::Context::CostType;
+            return static_cast<Value>(std::max(dx, dy) * Cost::straight + std::min(dx, dy) * (Cost::diagonal - Cost::straight));
+        }
+    };
+
+    /**
+     * Exact distance on an empty map with 4 connectivity, it overestimates when diagonals are allowed.
+     */
+    export struct ManhattanHeuristic {
+        template<typename Cost>
+        static auto estimate(int dx, int dy) noexcept {
+            using Value = typename Cost::Context::CostType;
+            return static_cast<Value>((dx + dy) * Cost::straight);
+        }
+    };
+
+    /**
+     * No estimate at all, which turns A* into Dijkstra's algorithm.
+     */
+    export struct ZeroHeuristic {
+        template<typename Cost>
+        static auto estimate(int, int) noexcept {
+            using Value = typename Cost::Context::CostType;
+            return Value{};
+        }
+    };
+
+    /**
+     * Moves to the 8 neighbours, diagonals may squeeze between two blocked cells.
+     * This is how the solvers always moved.
+     */
+    export struct EightConnected {
+        template<typename Grid, typename Visit>
+        static void neighbours(const Grid& grid, int row, int col, Visit&& visit) {
+            // the map border counts as a wall, so it is never on the mask
+            NeighbourMask::for_each(row, col, grid.neighbours(row, col), visit);
+        }
+    };
+
+    /**
+     * Moves to the 8 neighbours, diagonals only when both cells beside them are free.
+     */
+    export struct EightConnectedNoCornerCutting {
+        template<typename Grid, typename Visit>
+        static void neighbours(const Grid& grid, int row, int col, Visit&& visit) {
+            const auto mask = NeighbourMask::without_corner_cutting(grid.neighbours(row, col));
+            orthogonal_neighbours(row, col, mask, visit);
+            NeighbourMask::for_each(row, col, mask & NeighbourMask::DIAGONAL, visit);
+        }
+
+        /**
+         * @brief Visits the orthogonal neighbours on the mask.
+         * Up and down go first, the order the heap sees equal keys in changes which of the ties wins.
+         */
+        template<typename Visit>
+        static void orthogonal_neighbours(int row, int col, std::uint8_t mask, Visit& visit) {
+            if (mask & NeighbourMask::UP) {
+                visit(row - 1, col, false);
+            }
+            if (mask & NeighbourMask::DOWN) {
+                visit(row + 1, col, false);
+            }
+            if (mask & NeighbourMask::LEFT) {
+                visit(row, col - 1, false);
+            }
+            if (mask & NeighbourMask::RIGHT) {
+                visit(row, col + 1, false);
+            }
+        }
+    };
+
+    /**
+     * Moves to the 4 orthogonal neighbours only.
+     */
+    export struct FourConnected {
+        template<typename Grid, typename Visit>
+        static void neighbours(const Grid& grid, int row, int col, Visit&& visit) {
+            EightConnectedNoCornerCutting::orthogonal_neighbours(row, col, grid.neighbours(row, col), visit);
+        }
+    };
+
+    /**
+     * Cells with the same cost plus estimate are taken in whatever order the heap gives.
+     */
+    export struct NoTieBreaking {
+        template<typename Value>
+        static Value key(Value cost, Value estimate) noexcept {
+            return cost + estimate;
+        }
+    };
+
+    /**
+     * Among cells with the same cost plus estimate, prefers the ones closer to the goal.
+     *
+     * Open maps have lots of such ties, following the deepest one avoids expanding all
+     * of them. The estimate is scaled up by one millionth, so with an admissible heuristic
+     * the paths cost at most one millionth more than the optimal ones. Integer costs are
+     * left alone, their bucket queue already pops the latest cell among equal priorities.
+     */
+    export struct PreferDeeper {
+        template<typename Value>
+        static Value key(Value cost, Value estimate) noexcept {
+            if constexpr (std::is_floating_point_v<Value>) {
+                return cost + estimate * (1.0 + 1e-6);
+            }
+            else {
+                return cost + estimate;
+            }
+        }
+    };
+
+    /**
+     * How an A* solver moves and estimates, see BasicAStarSolver.
+     */
+    export template<typename HeuristicPolicy = EuclideanHeuristic, typename CostPolicy = StandardCost,
+        typename MovesPolicy = EightConnected, typename TieBreakingPolicy = NoTieBreaking>
+    struct SearchPolicy {
+        using Heuristic = HeuristicPolicy;
+        using Cost = CostPolicy;
+        using Moves = MovesPolicy;
+        using TieBreaking = TieBreakingPolicy;
+    };
+}
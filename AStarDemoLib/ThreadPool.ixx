@@ -0,0 +1,280 @@
+/* ThreadPool.ixx - Persistent work stealing thread pool
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+export module ThreadPool;
+
+import <algorithm>;
+import <atomic>;
+import <condition_variable>;
+import <cstddef>;
+import <cstdint>;
+import <deque>;
+import <exception>;
+import <functional>;
+import <latch>;
+import <memory>;
+import <mutex>;
+import <thread>;
+import <vector>;
+
+export namespace AStarLib {
+
+    /**
+     * Lanes of the ThreadPool queues, interactive tasks are taken before any background one.
+     */
+    export enum class TaskPriority : std::uint8_t { INTERACTIVE, BACKGROUND };
+
+    /**
+     * Fixed set of worker threads that live as long as the pool.
+     *
+     * Each worker owns a task queue, taking work from its front and, once it
+     * runs dry, stealing from the back of the other queues. Tasks get the index
+     * of the worker running them, so callers can keep per worker scratch memory
+     * without any locking.
+     *
+     * Every queue has an interactive and a background lane. A worker looks at the
+     * interactive lanes of all queues before its own background one, so that a query
+     * someone is waiting on doesn't queue behind a large batch. Running tasks are
+     * never interrupted.
+     */
+    export class ThreadPool final
+    {
+    public:
+        using Task = std::function<void(std::size_t)>;
+
+        explicit ThreadPool(std::size_t workers = std::thread::hardware_concurrency());
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        static ThreadPool& default_pool();
+
+        std::size_t size() const noexcept { return m_threads.size(); }
+
+        void submit(Task task, TaskPriority priority = TaskPriority::BACKGROUND);
+
+        template<typename Body>
+        void parallel_for(std::size_t count, Body&& body);
+
+    private:
+        struct Queue {
+            std::mutex lock;
+            std::deque<Task> lanes[2];
+        };
+
+        std::vector<std::unique_ptr<Queue>> m_queues;
+        std::vector<std::thread> m_threads;
+        std::mutex m_lock;
+        std::condition_variable m_wake;
+        std::atomic<std::size_t> m_queued;
+        std::atomic<std::size_t> m_interactive;
+        std::atomic<std::size_t> m_next;
+        bool m_stop;
+
+        void push(std::size_t queue, Task task, TaskPriority priority);
+        bool pop(std::size_t worker, Task& task);
+        bool take(std::size_t worker, TaskPriority priority, Task& task);
+        void run(std::size_t worker);
+    };
+}
+
+// make the standard C++ library available on the local namespace
+using namespace std;
+
+// also to reduce typing
+using namespace AStarLib;
+
+/**
+ * @brief Calls body(worker, index) for every index in [0, count), waiting for all of them.
+ * The range is split in a few chunks per worker, so that idle workers can steal
+ * the remaining chunks of busy ones. The first exception thrown by body is rethrown
+ * here, once every chunk has finished.
+ * Must not be called from inside a task of the same pool, as it blocks the caller.
+ * @param count the amount of indexes
+ * @param body the function to call for each index
+ */
+template<typename Body>
+void ThreadPool::parallel_for(size_t count, Body&& body)
+{
+    if (count == 0) {
+        return;
+    }
+
+    const size_t chunks = min(count, size() * 4);
+    const size_t chunk_size = (count + chunks - 1) / chunks;
+    const size_t tasks = (count + chunk_size - 1) / chunk_size;
+
+    latch done(static_cast<ptrdiff_t>(tasks));
+    exception_ptr error;
+    mutex error_lock;
+
+    for (size_t first = 0; first < count; first += chunk_size) {
+        const size_t last = min(first + chunk_size, count);
+        submit([&, first, last](size_t worker) {
+            try {
+                for (size_t index = first; index < last; ++index) {
+                    body(worker, index);
+                }
+            }
+            catch (...) {
+                lock_guard guard(error_lock);
+                if (!error) {
+                    error = current_exception();
+                }
+            }
+            done.count_down();
+        });
+    }
+
+    done.wait();
+    if (error) {
+        rethrow_exception(error);
+    }
+}
+
+/**
+ * @brief Starts the workers.
+ * @param workers the amount of threads, at least one is always created
+ */
+ThreadPool::ThreadPool(size_t workers) : m_queued{ 0 }, m_interactive{ 0 }, m_next{ 0 }, m_stop{ false }
+{
+    workers = max<size_t>(workers, 1);
+    for (size_t i = 0; i < workers; ++i) {
+        m_queues.push_back(make_unique<Queue>());
+    }
+    for (size_t i = 0; i < workers; ++i) {
+        m_threads.emplace_back([this, i] { run(i); });
+    }
+}
+
+/**
+ * @brief Stops the workers, after the already queued tasks are done.
+ */
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard guard(m_lock);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+/**
+ * @brief Pool shared by the whole process, sized for the available cores.
+ */
+ThreadPool& ThreadPool::default_pool()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+/**
+ * @brief Queues a task, the queues are filled round robin.
+ * @param task the work to do, it gets the index of the worker running it
+ * @param priority the lane to queue it on
+ */
+void ThreadPool::submit(Task task, TaskPriority priority)
+{
+    push(m_next.fetch_add(1, memory_order_relaxed) % m_queues.size(), std::move(task), priority);
+}
+
+void ThreadPool::push(size_t queue, Task task, TaskPriority priority)
+{
+    {
+        // counted first, so that stealing it right away can't make the counter wrap around,
+        // and under the lock so that a worker can't miss the wake up before going to sleep
+        lock_guard guard(m_lock);
+        m_queued.fetch_add(1, memory_order_relaxed);
+        if (priority == TaskPriority::INTERACTIVE) {
+            m_interactive.fetch_add(1, memory_order_relaxed);
+        }
+    }
+    {
+        lock_guard guard(m_queues[queue]->lock);
+        m_queues[queue]->lanes[static_cast<size_t>(priority)].push_back(std::move(task));
+    }
+    m_wake.notify_one();
+}
+
+/**
+ * @brief Takes the next interactive task of any queue, or else the next background one.
+ * @param worker the worker looking for work
+ * @param task where to store the task
+ * @return true if a task was found
+ */
+bool ThreadPool::pop(size_t worker, Task& task)
+{
+    if (m_interactive.load(memory_order_relaxed) > 0 && take(worker, TaskPriority::INTERACTIVE, task)) {
+        m_interactive.fetch_sub(1, memory_order_relaxed);
+        return true;
+    }
+    return take(worker, TaskPriority::BACKGROUND, task);
+}
+
+/**
+ * @brief Takes the next task of one lane of the worker's own queue, or steals one from the others.
+ * @param worker the worker looking for work
+ * @param priority the lane to look at
+ * @param task where to store the task
+ * @return true if a task was found
+ */
+bool ThreadPool::take(size_t worker, TaskPriority priority, Task& task)
+{
+    for (size_t i = 0; i < m_queues.size(); ++i) {
+        const bool own = i == 0;
+        auto& queue = *m_queues[(worker + i) % m_queues.size()];
+        auto& tasks = queue.lanes[static_cast<size_t>(priority)];
+
+        lock_guard guard(queue.lock);
+        if (!tasks.empty()) {
+            if (own) {
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            else {
+                task = std::move(tasks.back());
+                tasks.pop_back();
+            }
+            m_queued.fetch_sub(1, memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run(size_t worker)
+{
+    Task task;
+    for (;;) {
+        if (pop(worker, task)) {
+            task(worker);
+            task = nullptr;
+            continue;
+        }
+
+        unique_lock guard(m_lock);
+        m_wake.wait(guard, [this] { return m_stop || m_queued.load(memory_order_relaxed) > 0; });
+        if (m_stop && m_queued.load(memory_order_relaxed) == 0) {
+            return;
+        }
+    }
+}
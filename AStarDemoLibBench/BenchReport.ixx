@@ -0,0 +1,218 @@
+/* BenchReport.ixx - Measurements summary and JSON output for the benchmarks
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+module;
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+export module BenchReport;
+
+import <algorithm>;
+import <cmath>;
+import <cstddef>;
+import <format>;
+import <iostream>;
+import <numeric>;
+import <span>;
+import <string>;
+import <vector>;
+
+export namespace AStarBench {
+
+    /**
+     * Latency distribution of a set of searches, in microseconds.
+     */
+    export struct LatencySummary {
+        double mean = 0.0;
+        double p50 = 0.0;
+        double p90 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+    /**
+     * Results of running one solver over one set of queries.
+     */
+    export struct CaseResult {
+        std::string name;
+        std::string map;
+        int rows = 0;
+        int cols = 0;
+        std::size_t queries = 0;
+        LatencySummary latency;
+        double expansions_per_second = 0.0;
+        std::size_t expansions = 0;
+        std::size_t peak_open = 0;
+        std::size_t peak_memory_bytes = 0;
+
+        // paths compared against a reference Dijkstra search, when checking is enabled
+        bool checked = false;
+        std::size_t optimal = 0;
+        std::size_t suboptimal = 0;
+        std::size_t unreachable = 0;
+        std::size_t missed = 0;
+    };
+
+    LatencySummary summarize(std::vector<double> samples);
+
+    std::size_t peak_memory_bytes();
+
+    void print_result(std::ostream& out, const CaseResult& result);
+
+    void write_json(std::ostream& out, std::span<const CaseResult> results);
+}
+
+// make the standard C++ library available on the local namespace
+using namespace std;
+
+// also to reduce typing
+using namespace AStarBench;
+
+namespace {
+    /**
+     * @brief Nearest rank percentile of already sorted samples.
+     */
+    double percentile(const vector<double>& sorted, double fraction)
+    {
+        const auto rank = static_cast<size_t>(ceil(fraction * sorted.size()));
+        return sorted[min(max(rank, size_t{ 1 }), sorted.size()) - 1];
+    }
+
+    string json_string(const string& text)
+    {
+        string escaped = "\"";
+        for (const char c : text) {
+            switch (c) {
+            case '"':
+                escaped += "\\\"";
+                break;
+
+            case '\\':
+                escaped += "\\\\";
+                break;
+
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    escaped += format("\\u{:04x}", static_cast<int>(c));
+                }
+                else {
+                    escaped += c;
+                }
+            }
+        }
+        return escaped + '"';
+    }
+}
+
+/**
+ * @brief Computes the latency distribution.
+ * @param samples the duration of each search, in microseconds.
+ */
+LatencySummary AStarBench::summarize(vector<double> samples)
+{
+    LatencySummary summary;
+    if (samples.empty()) {
+        return summary;
+    }
+
+    sort(samples.begin(), samples.end());
+    summary.mean = accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    summary.p50 = percentile(samples, 0.50);
+    summary.p90 = percentile(samples, 0.90);
+    summary.p99 = percentile(samples, 0.99);
+    summary.max = samples.back();
+    return summary;
+}
+
+/**
+ * @brief The largest amount of physical memory used by the process so far.
+ * @return the size in bytes, 0 if the platform does not tell.
+ */
+size_t AStarBench::peak_memory_bytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    // Linux reports it in kilobytes
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+/**
+ * @brief Writes a human readable summary of a case.
+ */
+void AStarBench::print_result(ostream& out, const CaseResult& result)
+{
+    out << format("{} on {} ({}x{}), {} queries:\n", result.name, result.map, result.rows, result.cols, result.queries);
+    out << format("  latency us: mean {:.1f}, p50 {:.1f}, p90 {:.1f}, p99 {:.1f}, max {:.1f}\n",
+        result.latency.mean, result.latency.p50, result.latency.p90, result.latency.p99, result.latency.max);
+    out << format("  {:.0f} expansions/s, peak open list {}, peak memory {} KB\n",
+        result.expansions_per_second, result.peak_open, result.peak_memory_bytes / 1024);
+    if (result.checked) {
+        out << format("  {} optimal, {} suboptimal, {} unreachable, {} missed\n",
+            result.optimal, result.suboptimal, result.unreachable, result.missed);
+    }
+}
+
+/**
+ * @brief Writes the results as a JSON document, so that runs can be compared by scripts.
+ */
+void AStarBench::write_json(ostream& out, span<const CaseResult> results)
+{
+    out << "{\n  \"cases\": [";
+    bool first = true;
+    for (const auto& result : results) {
+        out << (first ? "\n" : ",\n");
+        first = false;
+
+        out << "    {\n";
+        out << format("      \"name\": {},\n", json_string(result.name));
+        out << format("      \"map\": {},\n", json_string(result.map));
+        out << format("      \"rows\": {},\n      \"cols\": {},\n", result.rows, result.cols);
+        out << format("      \"queries\": {},\n", result.queries);
+        out << format("      \"latency_us\": {{ \"mean\": {:.3f}, \"p50\": {:.3f}, \"p90\": {:.3f}, \"p99\": {:.3f}, \"max\": {:.3f} }},\n",
+            result.latency.mean, result.latency.p50, result.latency.p90, result.latency.p99, result.latency.max);
+        out << format("      \"expansions\": {},\n", result.expansions);
+        out << format("      \"expansions_per_second\": {:.0f},\n", result.expansions_per_second);
+        out << format("      \"peak_open\": {},\n", result.peak_open);
+        out << format("      \"peak_memory_bytes\": {}", result.peak_memory_bytes);
+        if (result.checked) {
+            out << format(",\n      \"optimality\": {{ \"optimal\": {}, \"suboptimal\": {}, \"unreachable\": {}, \"missed\": {} }}",
+                result.optimal, result.suboptimal, result.unreachable, result.missed);
+        }
+        out << "\n    }";
+    }
+    out << "\n  ]\n}\n";
+}
@@ -0,0 +1,154 @@
+/* MapGenerators.ixx - Synthetic maps for the benchmarks
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+export module MapGenerators;
+
+import <cstddef>;
+import <random>;
+import <utility>;
+import <vector>;
+
+import AStarLib;
+
+export namespace AStarBench {
+
+    void random_obstacles(AStarLib::Map& map, double density, unsigned seed);
+
+    void maze(AStarLib::Map& map, unsigned seed);
+
+    void rooms(AStarLib::Map& map, int room_size, unsigned seed);
+}
+
+// make the standard C++ library available on the local namespace
+using namespace std;
+
+// also to reduce typing
+using namespace AStarLib;
+using namespace AStarBench;
+
+/**
+ * @brief Blocks cells at random.
+ * @param map the map to fill, with all of its cells free.
+ * @param density the probability of each cell being blocked.
+ * @param seed the random generator seed, the same seed always gives the same map.
+ */
+void AStarBench::random_obstacles(Map& map, double density, unsigned seed)
+{
+    mt19937 random(seed);
+    bernoulli_distribution wall(density);
+    for (int row = 0; row < map.rows(); ++row) {
+        for (int col = 0; col < map.columns(); ++col) {
+            if (wall(random)) {
+                map.set_pos(row, col, Map::CellType::BLOCKED);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Carves a perfect maze of one cell wide corridors, with a randomized depth first search.
+ * The corridors run along the even rows and columns, so there is exactly one path between
+ * any two of their cells.
+ * @param map the map to fill, with all of its cells free.
+ * @param seed the random generator seed, the same seed always gives the same map.
+ */
+void AStarBench::maze(Map& map, unsigned seed)
+{
+    const int rows = map.rows();
+    const int cols = map.columns();
+    vector<bool> open(static_cast<size_t>(rows) * cols, false);
+    const auto index = [cols](int row, int col) { return static_cast<size_t>(row) * cols + col; };
+
+    mt19937 random(seed);
+    vector<pair<int, int>> stack{ { 0, 0 } };
+    open[0] = true;
+
+    constexpr int steps[4][2] = { { -2, 0 }, { 2, 0 }, { 0, -2 }, { 0, 2 } };
+    while (!stack.empty()) {
+        const auto [row, col] = stack.back();
+
+        // pick one of the neighbours not carved yet, if there is any left
+        int choices[4];
+        int count = 0;
+        for (int i = 0; i < 4; ++i) {
+            const int next_row = row + steps[i][0];
+            const int next_col = col + steps[i][1];
+            if (next_row >= 0 && next_row < rows && next_col >= 0 && next_col < cols && !open[index(next_row, next_col)]) {
+                choices[count++] = i;
+            }
+        }
+
+        if (count == 0) {
+            stack.pop_back();
+            continue;
+        }
+
+        const auto& step = steps[choices[uniform_int_distribution<int>(0, count - 1)(random)]];
+        open[index(row + step[0] / 2, col + step[1] / 2)] = true;
+        open[index(row + step[0], col + step[1])] = true;
+        stack.emplace_back(row + step[0], col + step[1]);
+    }
+
+    for (int row = 0; row < rows; ++row) {
+        for (int col = 0; col < cols; ++col) {
+            if (!open[index(row, col)]) {
+                map.set_pos(row, col, Map::CellType::BLOCKED);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Splits the map in square rooms, with one door in each wall between two rooms.
+ * @param map the map to fill, with all of its cells free.
+ * @param room_size how many cells wide each room is, walls excluded.
+ * @param seed the random generator seed, the same seed always gives the same map.
+ */
+void AStarBench::rooms(Map& map, int room_size, unsigned seed)
+{
+    const int rows = map.rows();
+    const int cols = map.columns();
+    const int period = room_size + 1;
+
+    mt19937 random(seed);
+    uniform_int_distribution<int> door(0, room_size - 1);
+
+    // horizontal walls, with a door per room along them
+    for (int row = room_size; row < rows; row += period) {
+        for (int first = 0; first < cols; first += period) {
+            const int door_col = first + door(random);
+            for (int col = first; col < first + period && col < cols; ++col) {
+                if (col != door_col) {
+                    map.set_pos(row, col, Map::CellType::BLOCKED);
+                }
+            }
+        }
+    }
+
+    // vertical walls, the crossings were already blocked above
+    for (int col = room_size; col < cols; col += period) {
+        for (int first = 0; first < rows; first += period) {
+            const int door_row = first + door(random);
+            for (int row = first; row < first + room_size && row < rows; ++row) {
+                if (row != door_row) {
+                    map.set_pos(row, col, Map::CellType::BLOCKED);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,125 @@
+/* MovingAI.ixx - Reader for the MovingAI benchmark map and scenario files
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+export module MovingAI;
+
+import <iostream>;
+import <memory>;
+import <sstream>;
+import <string>;
+import <vector>;
+
+import AStarLib;
+
+export namespace AStarBench {
+
+    /**
+     * One query of a MovingAI scenario file, see https://movingai.com/benchmarks/formats.html
+     * The files use x for columns and y for rows, they are stored here as rows and columns.
+     */
+    export struct Scenario {
+        int bucket;
+        std::string map;
+        int width, height;
+        int start_row, start_col;
+        int goal_row, goal_col;
+
+        // octile distance without corner cutting, which is not the cost model of the solvers
+        double optimal_length;
+    };
+
+    std::unique_ptr<AStarLib::Map> load_movingai_map(std::istream& input);
+
+    std::vector<Scenario> load_movingai_scenarios(std::istream& input);
+}
+
+// make the standard C++ library available on the local namespace
+using namespace std;
+
+// also to reduce typing
+using namespace AStarLib;
+using namespace AStarBench;
+
+/**
+ * @brief Reads a MovingAI .map file.
+ * Ground and swamp cells ('.', 'G' and 'S') are free, everything else is blocked.
+ * @param input the map file contents.
+ * @return null if the header or any of the rows is invalid.
+ */
+unique_ptr<Map> AStarBench::load_movingai_map(istream& input)
+{
+    string key, type;
+    int height = 0;
+    int width = 0;
+
+    if (!(input >> key >> type) || key != "type") {
+        return nullptr;
+    }
+    if (!(input >> key >> height) || key != "height" || !(input >> key >> width) || key != "width") {
+        return nullptr;
+    }
+    if (!(input >> key) || key != "map" || height <= 0 || width <= 0) {
+        return nullptr;
+    }
+
+    auto map = make_unique<Map>(height, width);
+
+    string line;
+    for (int row = 0; row < height; ++row) {
+        if (!(input >> line) || line.size() < static_cast<size_t>(width)) {
+            return nullptr;
+        }
+        for (int col = 0; col < width; ++col) {
+            const char cell = line[col];
+            if (cell != '.' && cell != 'G' && cell != 'S') {
+                map->set_pos(row, col, Map::CellType::BLOCKED);
+            }
+        }
+    }
+
+    return map;
+}
+
+/**
+ * @brief Reads a MovingAI .scen file.
+ * @param input the scenario file contents.
+ * @return the queries, empty if the file is not a version 1 scenario.
+ */
+vector<Scenario> AStarBench::load_movingai_scenarios(istream& input)
+{
+    vector<Scenario> scenarios;
+
+    string key;
+    double version = 0.0;
+    if (!(input >> key >> version) || key != "version") {
+        return scenarios;
+    }
+
+    string line;
+    while (getline(input, line)) {
+        istringstream fields(line);
+        Scenario scenario;
+        if (fields >> scenario.bucket >> scenario.map >> scenario.width >> scenario.height
+            >> scenario.start_col >> scenario.start_row >> scenario.goal_col >> scenario.goal_row
+            >> scenario.optimal_length) {
+            scenarios.push_back(std::move(scenario));
+        }
+    }
+
+    return scenarios;
+}
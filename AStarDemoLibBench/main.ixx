@@ -0,0 +1,1018 @@
+/* main.ixx - driver application for the A* library benchmarks
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+export module main;
+
+import <algorithm>;
+import <atomic>;
+import <chrono>;
+import <cstddef>;
+import <cstdint>;
+import <cmath>;
+import <coroutine>;
+import <cstdlib>;
+import <exception>;
+import <filesystem>;
+import <format>;
+import <fstream>;
+import <future>;
+import <iostream>;
+import <latch>;
+import <limits>;
+import <memory>;
+import <random>;
+import <sstream>;
+import <string>;
+import <utility>;
+import <vector>;
+
+import AStarLib;
+import BenchReport;
+import MapGenerators;
+import MovingAI;
+
+using namespace AStarLib;
+using namespace AStarBench;
+
+/**
+ * @brief Reads the whole map file, so that the file system is kept out of the measurements.
+ * @param filename the map to load
+ * @return the map contents, empty on error
+ */
+std::wstring read_map(const std::string& filename)
+{
+    std::wifstream fd(filename);
+    std::wstringstream buffer;
+    buffer << fd.rdbuf();
+    return buffer.str();
+}
+
+/**
+ * @brief Measures a solver between the two opposite corners of the map.
+ * @param name the solver name for the report
+ * @param contents the map file contents
+ * @param iterations how many searches to run
+ */
+template<typename Solver>
+bool bench_solver(const std::string& name, const std::wstring& contents, int iterations)
+{
+    using clock = std::chrono::steady_clock;
+
+    clock::duration elapsed{};
+    long long expansions = 0;
+    long long heap_operations = 0;
+    std::size_t peak_open = 0;
+    double path_cost = 0.0;
+
+    Map map;
+    std::wistringstream buffer(contents);
+    if (!map.load(buffer)) {
+        std::cerr << "Invalid map file\n";
+        return false;
+    }
+
+    // the solver keeps its scratch memory between searches, as it would in a game loop,
+    // any preprocessing it does is reported apart from the searches
+    const auto setup_start = clock::now();
+    Solver solver(map);
+    const auto setup = clock::now() - setup_start;
+
+    for (int i = 0; i < iterations; ++i) {
+        auto start = std::make_shared<Node>(0, 0);
+        auto goal = std::make_shared<Node>(map.rows() - 2, map.columns() - 2);
+
+        const auto before = clock::now();
+        auto path = solver.find(start, goal);
+        elapsed += clock::now() - before;
+
+        if (path == nullptr) {
+            std::cerr << "No path found\n";
+            return false;
+        }
+        path_cost = path->cost();
+        expansions += solver.stats().expansions;
+        heap_operations += solver.stats().heap_operations();
+        peak_open = std::max(peak_open, solver.stats().peak_open);
+    }
+
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    std::cout << std::format("{}: {} searches, path cost {:.1f}, {} expansions/search\n",
+        name, iterations, path_cost, expansions / iterations);
+    std::cout << std::format("  {:.3f} ms/search, {:.0f} expansions/sec\n",
+        seconds * 1000.0 / iterations, expansions / seconds);
+    std::cout << std::format("  {:.3f} ms setup\n",
+        std::chrono::duration<double, std::milli>(setup).count());
+    std::cout << std::format("  {} heap operations/search, {} cells on the open list at most\n",
+        heap_operations / iterations, peak_open);
+
+    return true;
+}
+
+/**
+ * @brief Measures the throughput of many random queries, searched one after the
+ * other by a single solver and then as batches spread over the default thread pool.
+ * @param contents the map file contents
+ * @param queries how many queries each batch has
+ * @param iterations how many batches to run
+ */
+bool bench_batch(const std::wstring& contents, int queries, int iterations)
+{
+    using clock = std::chrono::steady_clock;
+
+    Map map;
+    std::wistringstream buffer(contents);
+    if (!map.load(buffer)) {
+        std::cerr << "Invalid map file\n";
+        return false;
+    }
+
+    // pairs of random free cells, the same ones on every run
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> rows(0, map.rows() - 1);
+    std::uniform_int_distribution<int> cols(0, map.columns() - 1);
+    const auto free_cell = [&] {
+        for (;;) {
+            Node cell(rows(random), cols(random));
+            if (map.passable(cell.row(), cell.col())) {
+                return cell;
+            }
+        }
+    };
+
+    std::vector<PathQuery> batch;
+    for (int i = 0; i < queries; ++i) {
+        batch.push_back({ free_cell(), free_cell() });
+    }
+    std::vector<BatchSolver::NodePtr> results(batch.size());
+
+    const auto snapshot = map.snapshot();
+    AStarSolver solver(snapshot);
+    const auto sequential_start = clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        for (std::size_t query = 0; query < batch.size(); ++query) {
+            results[query] = solver.find(std::make_shared<Node>(batch[query].start.row(), batch[query].start.col()),
+                std::make_shared<Node>(batch[query].goal.row(), batch[query].goal.col()));
+        }
+    }
+    const double sequential = std::chrono::duration<double>(clock::now() - sequential_start).count();
+
+    BatchSolver solvers;
+    const auto batch_start = clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        solvers.solve(snapshot, batch, results);
+    }
+    const double parallel = std::chrono::duration<double>(clock::now() - batch_start).count();
+
+    const double searches = static_cast<double>(queries) * iterations;
+    std::cout << std::format("Batches of {} random queries, {} workers:\n", queries, ThreadPool::default_pool().size());
+    std::cout << std::format("  sequential {:.0f} queries/sec, batched {:.0f} queries/sec ({:.1f}x)\n",
+        searches / sequential, searches / parallel, sequential / parallel);
+
+    return true;
+}
+
+/**
+ * Coroutine that starts right away and is never awaited, to drive AsyncSolver::find_async().
+ */
+struct DetachedSearch {
+    struct promise_type {
+        DetachedSearch get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+DetachedSearch await_search(AsyncSolver& solver, std::shared_ptr<const MapSnapshot> snapshot, const PathQuery& query,
+    std::atomic<std::size_t>& found, std::latch& done)
+{
+    const auto result = co_await solver.find_async(std::move(snapshot), { query.start.row(), query.start.col() },
+        { query.goal.row(), query.goal.col() });
+    found += result.status == SearchStatus::FOUND;
+    done.count_down();
+}
+
+/**
+ * @brief Measures starting a thread for every query, as std::async does, against
+ * awaiting them from coroutines on the shared thread pool.
+ * @param contents the map file contents
+ * @param queries how many random queries to run
+ */
+bool bench_async(const std::wstring& contents, int queries)
+{
+    using clock = std::chrono::steady_clock;
+
+    Map map;
+    std::wistringstream buffer(contents);
+    if (!map.load(buffer)) {
+        std::cerr << "Invalid map file\n";
+        return false;
+    }
+
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> rows(0, map.rows() - 1);
+    std::uniform_int_distribution<int> cols(0, map.columns() - 1);
+    std::vector<PathQuery> batch;
+    while (batch.size() < static_cast<std::size_t>(queries)) {
+        Node start(rows(random), cols(random));
+        Node goal(rows(random), cols(random));
+        if (map.passable(start.row(), start.col()) && map.passable(goal.row(), goal.col())) {
+            batch.push_back({ start, goal });
+        }
+    }
+    const auto snapshot = map.snapshot();
+
+    auto before = clock::now();
+    std::vector<std::future<bool>> futures;
+    for (const auto& query : batch) {
+        futures.push_back(std::async(std::launch::async, [&snapshot, &query] {
+            AStarSolver solver(snapshot);
+            return !solver.find(query.start.row(), query.start.col(), query.goal.row(), query.goal.col()).empty();
+        }));
+    }
+    std::size_t threaded_found = 0;
+    for (auto& future : futures) {
+        threaded_found += future.get();
+    }
+    const double threaded = std::chrono::duration<double, std::micro>(clock::now() - before).count() / queries;
+
+    AsyncSolver solver;
+    std::atomic<std::size_t> found = 0;
+    std::latch done(queries);
+    before = clock::now();
+    for (const auto& query : batch) {
+        await_search(solver, snapshot, query, found, done);
+    }
+    done.wait();
+    const double awaited = std::chrono::duration<double, std::micro>(clock::now() - before).count() / queries;
+
+    if (found != threaded_found) {
+        std::cerr << std::format("The awaited searches found {} paths instead of {}\n", found.load(), threaded_found);
+        return false;
+    }
+
+    std::cout << std::format("{} random queries, {} found:\n", queries, threaded_found);
+    std::cout << std::format("  {:.2f} us/query with a thread each, {:.2f} us/query awaited on the thread pool\n", threaded, awaited);
+    return true;
+}
+
+/**
+ * @brief Measures many units heading to the same goal, each one searching on its
+ * own and then all of them walking a single flow field.
+ * @param contents the map file contents
+ * @param units how many units head to the goal
+ * @param iterations how many times to repeat it
+ */
+bool bench_flow_field(const std::wstring& contents, int units, int iterations)
+{
+    using clock = std::chrono::steady_clock;
+
+    Map map;
+    std::wistringstream buffer(contents);
+    if (!map.load(buffer)) {
+        std::cerr << "Invalid map file\n";
+        return false;
+    }
+
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> rows(0, map.rows() - 1);
+    std::uniform_int_distribution<int> cols(0, map.columns() - 1);
+    std::vector<Node> starts;
+    while (starts.size() < static_cast<std::size_t>(units)) {
+        Node cell(rows(random), cols(random));
+        if (map.passable(cell.row(), cell.col())) {
+            starts.push_back(cell);
+        }
+    }
+    const int goal_row = map.rows() - 2;
+    const int goal_col = map.columns() - 2;
+
+    const auto snapshot = map.snapshot();
+    AStarSolver solver(snapshot);
+    int found = 0;
+    const auto solver_start = clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        for (const auto& start : starts) {
+            found += solver.find(std::make_shared<Node>(start.row(), start.col()), std::make_shared<Node>(goal_row, goal_col)) != nullptr;
+        }
+    }
+    const double searches = std::chrono::duration<double>(clock::now() - solver_start).count();
+
+    // a new field for every repetition, so that its search is part of the measurement
+    int walked = 0;
+    const auto field_start = clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        FlowField field(snapshot);
+        field.set_goal(goal_row, goal_col);
+        for (const auto& start : starts) {
+            walked += field.find(std::make_shared<Node>(start.row(), start.col())) != nullptr;
+        }
+    }
+    const double fields = std::chrono::duration<double>(clock::now() - field_start).count();
+
+    if (found != walked) {
+        std::cerr << "Flow field and solver disagree on the reachable units\n";
+        return false;
+    }
+
+    std::cout << std::format("{} units to the same goal:\n", units);
+    std::cout << std::format("  one search each {:.3f} ms, one flow field {:.3f} ms ({:.1f}x)\n",
+        searches * 1000.0 / iterations, fields * 1000.0 / iterations, searches / fields);
+
+    return true;
+}
+
+/**
+ * @brief Measures many agents moving at once without colliding, each one heading to its own random goal.
+ * @param agents how many agents move on the map
+ * @param ticks how many steps to move them
+ */
+bool bench_cooperative(const std::wstring& contents, int agents, int ticks)
+{
+    using clock = std::chrono::steady_clock;
+
+    Map map;
+    std::wistringstream buffer(contents);
+    if (!map.load(buffer)) {
+        std::cerr << "Invalid map file\n";
+        return false;
+    }
+
+    // different starts and different goals, so that every agent can get there
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> rows(0, map.rows() - 1);
+    std::uniform_int_distribution<int> cols(0, map.columns() - 1);
+    const auto free_cells = [&](std::vector<Node>& cells) {
+        while (cells.size() < static_cast<std::size_t>(agents)) {
+            Node cell(rows(random), cols(random));
+            const bool taken = std::any_of(cells.begin(), cells.end(), [&](const Node& other) {
+                return other.row() == cell.row() && other.col() == cell.col();
+            });
+            if (!taken && map.passable(cell.row(), cell.col()) && map.connected(cell.row(), cell.col(), map.rows() / 2, map.columns() / 2)) {
+                cells.push_back(cell);
+            }
+        }
+    };
+    std::vector<Node> starts, goals;
+    free_cells(starts);
+    free_cells(goals);
+
+    CooperativePlanner planner(map);
+    for (int i = 0; i < agents; ++i) {
+        planner.add_agent(starts[i].row(), starts[i].col(), goals[i].row(), goals[i].col());
+    }
+
+    double worst = 0.0;
+    const auto start = clock::now();
+    for (int tick = 0; tick < ticks; ++tick) {
+        const auto before = clock::now();
+        planner.tick();
+        worst = std::max(worst, std::chrono::duration<double, std::milli>(clock::now() - before).count());
+    }
+    const double elapsed = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+    int arrived = 0;
+    for (int i = 0; i < agents; ++i) {
+        arrived += planner.arrived(i);
+    }
+
+    const auto& stats = planner.stats();
+    std::cout << std::format("{} cooperative agents, window of {} ticks:\n", agents, planner.window());
+    std::cout << std::format("  {:.3f} ms/tick, {:.3f} ms worst tick, {} arrived after {} ticks\n", elapsed / ticks, worst, arrived, ticks);
+    std::cout << std::format("  {} expansions/tick, {} heap operations/tick\n", stats.expansions / ticks, stats.heap_operations() / ticks);
+    return true;
+}
+
+/**
+ * @brief Measures replanning after a cell on the current path gets blocked and unblocked
+ * again, with a full A* search against the incremental solver repair.
+ * @param contents the map file contents
+ * @param iterations how many cells to toggle
+ */
+bool bench_incremental(const std::wstring& contents, int iterations)
+{
+    using clock = std::chrono::steady_clock;
+
+    Map map;
+    std::wistringstream buffer(contents);
+    if (!map.load(buffer)) {
+        std::cerr << "Invalid map file\n";
+        return false;
+    }
+
+    const int goal_row = map.rows() - 2;
+    const int goal_col = map.columns() - 2;
+    const auto search = [&](auto& solver) {
+        return solver.find(std::make_shared<Node>(0, 0), std::make_shared<Node>(goal_row, goal_col));
+    };
+
+    IncrementalSolver incremental(map);
+    const auto first_start = clock::now();
+    auto path = search(incremental);
+    const double first = std::chrono::duration<double>(clock::now() - first_start).count();
+    if (path == nullptr) {
+        std::cerr << "No path found\n";
+        return false;
+    }
+    const auto first_expansions = incremental.stats().expansions;
+
+    std::vector<Node> cells;
+    for (auto node = path; node != nullptr; node = node->get_parent()) {
+        cells.emplace_back(node->row(), node->col());
+    }
+
+    clock::duration full{}, repair{};
+    std::size_t full_expansions = 0, repair_expansions = 0;
+    int replans = 0;
+    for (int i = 0; i < iterations; ++i) {
+        // somewhere along the path, away from both ends
+        const auto& cell = cells[1 + (i * 7919) % (cells.size() - 2)];
+        for (const auto type : { Map::CellType::BLOCKED, Map::CellType::FREE }) {
+            map.set_pos(cell.row(), cell.col(), type);
+
+            AStarSolver solver(map.snapshot());
+            auto before = clock::now();
+            auto expected = search(solver);
+            full += clock::now() - before;
+            full_expansions += solver.stats().expansions;
+
+            before = clock::now();
+            incremental.cell_changed(cell.row(), cell.col());
+            auto repaired = search(incremental);
+            repair += clock::now() - before;
+            repair_expansions += incremental.stats().expansions;
+            ++replans;
+
+            if ((expected == nullptr) != (repaired == nullptr) || (expected != nullptr && expected->cost() != repaired->cost())) {
+                std::cerr << "Incremental solver and A* disagree\n";
+                return false;
+            }
+        }
+    }
+
+    const auto milliseconds = [replans](clock::duration elapsed) {
+        return std::chrono::duration<double, std::milli>(elapsed).count() / replans;
+    };
+    std::cout << std::format("Replanning after toggling a cell on the path, {} times:\n", replans);
+    std::cout << std::format("  first incremental search {:.3f} ms, {} expansions\n", first * 1000.0, first_expansions);
+    std::cout << std::format("  full A* {:.3f} ms, {} expansions/search\n", milliseconds(full), full_expansions / replans);
+    std::cout << std::format("  incremental repair {:.3f} ms, {} expansions/search\n", milliseconds(repair), repair_expansions / replans);
+
+    return true;
+}
+
+/**
+ * @brief Measures a path cache answering the same random queries over and over,
+ * as patrol routes do, against searching them every time.
+ * @param contents the map file contents
+ * @param routes how many different queries there are
+ * @param iterations how many times each one is asked
+ */
+bool bench_cache(const std::wstring& contents, int routes, int iterations)
+{
+    using clock = std::chrono::steady_clock;
+
+    Map map;
+    std::wistringstream buffer(contents);
+    if (!map.load(buffer)) {
+        std::cerr << "Invalid map file\n";
+        return false;
+    }
+
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> rows(0, map.rows() - 1);
+    std::uniform_int_distribution<int> cols(0, map.columns() - 1);
+    std::vector<PathQuery> queries;
+    while (queries.size() < static_cast<std::size_t>(routes)) {
+        Node start(rows(random), cols(random));
+        Node goal(rows(random), cols(random));
+        if (map.passable(start.row(), start.col()) && map.passable(goal.row(), goal.col())) {
+            queries.push_back({ start, goal });
+        }
+    }
+
+    AStarSolver solver(map.snapshot());
+    PathCache cache(map, queries.size());
+    const auto run = [&](auto&& find) {
+        const auto before = clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            for (const auto& query : queries) {
+                find(std::make_shared<Node>(query.start.row(), query.start.col()),
+                    std::make_shared<Node>(query.goal.row(), query.goal.col()));
+            }
+        }
+        return std::chrono::duration<double, std::micro>(clock::now() - before).count() / (static_cast<double>(iterations) * queries.size());
+    };
+
+    const double uncached = run([&](auto start, auto goal) { return solver.find(start, goal); });
+    const double cached = run([&](auto start, auto goal) { return cache.find(solver, start, goal); });
+
+    std::cout << std::format("Path cache, {} routes asked {} times each:\n", routes, iterations);
+    std::cout << std::format("  {} hits, {} misses\n", cache.hits(), cache.misses());
+    std::cout << std::format("  {:.2f} us/query uncached, {:.2f} us/query cached\n", uncached, cached);
+
+    // and the hits alone, now that everything is cached
+    const double hits = run([&](auto start, auto goal) { return cache.find(solver, start, goal); });
+    std::cout << std::format("  {:.2f} us/hit\n", hits);
+
+    return true;
+}
+
+/**
+ * @brief Measures handing a long path back as a chain of nodes, as a Path and into a
+ * caller's buffer, from the same search through a maze.
+ * @param size the amount of rows and columns of the generated maze
+ * @param iterations how many times to search
+ */
+bool bench_path_output(int size, int iterations)
+{
+    using clock = std::chrono::steady_clock;
+
+    Map map(size, size);
+    maze(map, 42);
+    const int goal = (size - 1) & ~1;
+    AStarSolver solver(map.snapshot());
+
+    const auto run = [&](auto&& find) {
+        const auto before = clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            find();
+        }
+        return std::chrono::duration<double, std::milli>(clock::now() - before).count() / iterations;
+    };
+
+    const double nodes = run([&] { return solver.find(std::make_shared<Node>(0, 0), std::make_shared<Node>(goal, goal)) != nullptr; });
+    const double path = run([&] { return solver.find(0, 0, goal, goal).size(); });
+
+    std::vector<PathPoint> buffer(static_cast<std::size_t>(size) * size);
+    const double span = run([&] {
+        solver.start(0, 0, goal, goal);
+        solver.step(std::numeric_limits<std::size_t>::max());
+        return solver.copy_path(buffer);
+    });
+
+    const auto found = solver.find(0, 0, goal, goal);
+    if (found.empty()) {
+        std::cerr << "No path found through the maze\n";
+        return false;
+    }
+
+    std::cout << std::format("Path output through a {}x{} maze, {} cells, {} waypoints:\n", size, size, found.size(), found.waypoints().size());
+    std::cout << std::format("  {:.2f} ms with nodes, {:.2f} ms with a Path, {:.2f} ms into a buffer\n", nodes, path, span);
+    return true;
+}
+
+/**
+ * @brief Measures loading a large random map from the text format against the binary one.
+ * @param size the amount of rows and columns of the generated map
+ */
+bool bench_loading(int size)
+{
+    using clock = std::chrono::steady_clock;
+    const auto elapsed = [](clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(clock::now() - since).count();
+    };
+
+    std::mt19937 random(42);
+    std::bernoulli_distribution wall(0.3);
+    std::wstring text = L"AStarv20\n32 32 tiles.png\n" + std::to_wstring(size) + L" " + std::to_wstring(size) + L"\n";
+    for (int row = 0; row < size; ++row) {
+        for (int col = 0; col < size; ++col) {
+            text += wall(random) ? L'*' : L'.';
+        }
+        text += L'\n';
+    }
+
+    const auto path = std::filesystem::temp_directory_path() / "AStarDemoLibBench.amap";
+    auto before = clock::now();
+    {
+        std::wistringstream buffer(text);
+        std::ofstream binary(path, std::ios::binary | std::ios::trunc);
+        if (!convert_text_map(buffer, binary)) {
+            std::cerr << "Could not write the binary map\n";
+            return false;
+        }
+    }
+    const double converting = elapsed(before);
+
+    Map map;
+    before = clock::now();
+    std::wistringstream buffer(text);
+    map.load(buffer);
+    const double parsing = elapsed(before);
+
+    before = clock::now();
+    auto file = BinaryMap::open(path);
+    if (file == nullptr) {
+        std::cerr << "Could not open the binary map\n";
+        return false;
+    }
+    auto snapshot = file->snapshot();
+    const double mapping = elapsed(before);
+
+    before = clock::now();
+    file->load(map);
+    const double copying = elapsed(before);
+
+    std::cout << std::format("Loading a {}x{} map:\n", size, size);
+    std::cout << std::format("  {:.2f} ms parsing the text format, {:.2f} ms converting it\n", parsing, converting);
+    std::cout << std::format("  {:.3f} ms mapping the binary format into a snapshot, {:.2f} ms loading it into a Map\n", mapping, copying);
+
+    snapshot.reset();
+    file.reset();
+    std::filesystem::remove(path);
+    return true;
+}
+
+/**
+ * @brief Measures how fast the neighbour masks of a large random map are computed from its passability plane.
+ * @param size the amount of rows and columns of the generated map
+ * @param iterations how many times to build the masks
+ */
+bool bench_neighbour_masks(int size, int iterations)
+{
+    Map map(size, size);
+    random_obstacles(map, 0.3, 42);
+    const auto snapshot = map.snapshot();
+    std::vector<std::uint8_t> masks(static_cast<std::size_t>(size) * size);
+
+    const auto before = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        build_neighbour_masks(snapshot->plane(), size, size, masks);
+    }
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - before;
+
+    for (int row = 0; row < size; ++row) {
+        for (int col = 0; col < size; ++col) {
+            if (masks[static_cast<std::size_t>(row) * size + col] != map.neighbours(row, col)) {
+                std::cerr << std::format("The neighbour masks differ from the map ones at ({}, {})\n", col, row);
+                return false;
+            }
+        }
+    }
+
+    const double per_build = elapsed.count() / iterations;
+    std::cout << std::format("Neighbour masks of a {}x{} map:\n", size, size);
+    std::cout << std::format("  {:.2f} ms per build, {:.0f} million cells/s\n", per_build, masks.size() / per_build / 1000.0);
+    return true;
+}
+
+/**
+ * @brief Measures searching a world paged in from a chunk file, with a memory budget smaller than the world.
+ * @param size the amount of rows and columns of the generated world
+ * @param budget how many bytes of chunks may be resident
+ * @param queries how many searches to run
+ */
+bool bench_chunked(int size, std::size_t budget, int queries)
+{
+    using clock = std::chrono::steady_clock;
+
+    // random walls on a quarter of the cells, generated chunk by chunk
+    const auto path = std::filesystem::temp_directory_path() / "AStarDemoLibBench.chunks";
+    std::mt19937_64 random(42);
+    const bool written = write_chunked_map(path, size, size, [&](int, int, ChunkedMap::ChunkWords words) {
+        for (auto& word : words) {
+            word = random() | random();
+        }
+    });
+
+    auto world = written ? ChunkedMap::open(path, budget) : nullptr;
+    if (world == nullptr) {
+        std::cerr << "Could not write the chunk file\n";
+        return false;
+    }
+
+    ChunkedSolver solver(*world);
+    std::uniform_int_distribution<int> cells(0, size - 1);
+    std::uniform_int_distribution<int> offsets(-500, 500);
+    double total = 0.0;
+    std::size_t expansions = 0;
+    int found = 0;
+    for (int query = 0; query < queries; ++query) {
+        int start_row, start_col, goal_row, goal_col;
+        do {
+            start_row = cells(random);
+            start_col = cells(random);
+            goal_row = std::clamp(start_row + offsets(random), 0, size - 1);
+            goal_col = std::clamp(start_col + offsets(random), 0, size - 1);
+        } while (!world->passable(start_row, start_col) || !world->passable(goal_row, goal_col));
+
+        const auto before = clock::now();
+        const auto result = solver.find(std::make_shared<Node>(start_row, start_col), std::make_shared<Node>(goal_row, goal_col));
+        total += std::chrono::duration<double, std::milli>(clock::now() - before).count();
+        expansions += solver.stats().expansions;
+        found += result != nullptr ? 1 : 0;
+    }
+
+    std::cout << std::format("Chunked {}x{} world, {} chunks on disk, room for {} in memory:\n", size, size, world->chunk_count(), world->capacity());
+    std::cout << std::format("  {:.2f} ms/search, {} expansions/search, {} of {} paths found\n", total / queries, expansions / queries, found, queries);
+    std::cout << std::format("  {} chunk reads, {} evictions, {} KB resident\n", world->loads(), world->evictions(), world->resident_chunks() * ChunkedMap::chunk_size * sizeof(std::uint64_t) / 1024);
+
+    world.reset();
+    std::filesystem::remove(path);
+    return true;
+}
+
+/**
+ * @brief Runs an A* solver over a set of queries, on a snapshot so that the map is left untouched.
+ * @param name the case name for the report
+ * @param label where the map came from
+ * @param map the map to search
+ * @param queries the searches to run
+ * @param check compare each path with a Dijkstra search from the goal
+ */
+template<typename Solver = AStarSolver>
+CaseResult run_case(const std::string& name, const std::string& label, const Map& map, const std::vector<PathQuery>& queries, bool check)
+{
+    using clock = std::chrono::steady_clock;
+
+    CaseResult result;
+    result.name = name;
+    result.map = label;
+    result.rows = map.rows();
+    result.cols = map.columns();
+    result.queries = queries.size();
+    result.checked = check;
+
+    const auto snapshot = map.snapshot();
+    Solver solver(snapshot);
+    FlowField reference(snapshot);
+
+    std::vector<double> latencies;
+    latencies.reserve(queries.size());
+    double seconds = 0.0;
+
+    for (const auto& query : queries) {
+        auto start = std::make_shared<Node>(query.start.row(), query.start.col());
+        auto goal = std::make_shared<Node>(query.goal.row(), query.goal.col());
+
+        const auto before = clock::now();
+        const auto path = solver.find(start, goal);
+        const auto elapsed = std::chrono::duration<double>(clock::now() - before).count();
+
+        seconds += elapsed;
+        latencies.push_back(elapsed * 1e6);
+        result.expansions += solver.stats().expansions;
+        result.peak_open = std::max(result.peak_open, solver.stats().peak_open);
+
+        if (check) {
+            reference.set_goal(query.goal.row(), query.goal.col());
+            const double expected = reference.distance(query.start.row(), query.start.col());
+            if (path == nullptr) {
+                ++(std::isinf(expected) ? result.unreachable : result.missed);
+            }
+            else if (std::abs(path->cost() - expected) <= 1e-6 * std::max(1.0, expected)) {
+                ++result.optimal;
+            }
+            else {
+                ++result.suboptimal;
+            }
+        }
+    }
+
+    result.latency = summarize(std::move(latencies));
+    result.expansions_per_second = seconds > 0.0 ? result.expansions / seconds : 0.0;
+    result.peak_memory_bytes = peak_memory_bytes();
+    return result;
+}
+
+/**
+ * @brief Picks random pairs of free cells.
+ */
+std::vector<PathQuery> random_queries(const Map& map, int count, unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> rows(0, map.rows() - 1);
+    std::uniform_int_distribution<int> cols(0, map.columns() - 1);
+
+    std::vector<PathQuery> queries;
+    for (int attempts = 0; queries.size() < static_cast<std::size_t>(count) && attempts < count * 100; ++attempts) {
+        Node start(rows(random), cols(random));
+        Node goal(rows(random), cols(random));
+        if (map.passable(start.row(), start.col()) && map.passable(goal.row(), goal.col())) {
+            queries.push_back({ start, goal });
+        }
+    }
+    return queries;
+}
+
+/**
+ * Command line of the benchmark suite.
+ */
+struct SuiteOptions {
+    std::string movingai_map;
+    std::string scenarios;
+    std::vector<std::string> synthetic;
+    int size = 512;
+    int queries = 100;
+    unsigned seed = 1;
+    bool check = true;
+    bool policies = false;
+    std::string json;
+};
+
+/**
+ * @brief Runs the A* solver over the queries, and when asked to, the other prebuilt policy combinations.
+ * The 8 connected ones share the A* solver costs, so their paths can be checked the same way.
+ */
+void run_cases(std::vector<CaseResult>& results, const std::string& label, const Map& map, const std::vector<PathQuery>& queries, const SuiteOptions& options)
+{
+    results.push_back(run_case("A* solver", label, map, queries, options.check));
+    if (options.policies) {
+        results.push_back(run_case<OctileSolver>("Octile A* solver", label, map, queries, options.check));
+        results.push_back(run_case<IntegerSolver>("Integer A* solver", label, map, queries, options.check));
+        results.push_back(run_case<DijkstraSolver>("Dijkstra solver", label, map, queries, options.check));
+        results.push_back(run_case<ManhattanSolver>("4 connected A* solver", label, map, queries, false));
+    }
+}
+
+/**
+ * @brief Runs the suite over MovingAI and synthetic maps.
+ * @return false if a map could not be loaded or a path was not optimal.
+ */
+bool run_suite(const SuiteOptions& options)
+{
+    std::vector<CaseResult> results;
+
+    if (!options.movingai_map.empty()) {
+        std::ifstream input(options.movingai_map);
+        const auto map = load_movingai_map(input);
+        if (map == nullptr) {
+            std::cerr << std::format("Could not read {}\n", options.movingai_map);
+            return false;
+        }
+
+        std::vector<PathQuery> queries;
+        if (!options.scenarios.empty()) {
+            std::ifstream scenario_input(options.scenarios);
+            for (const auto& scenario : load_movingai_scenarios(scenario_input)) {
+                if (scenario.width == map->columns() && scenario.height == map->rows()) {
+                    queries.push_back({ Node(scenario.start_row, scenario.start_col), Node(scenario.goal_row, scenario.goal_col) });
+                }
+            }
+            if (queries.empty()) {
+                std::cerr << std::format("No usable queries in {}\n", options.scenarios);
+                return false;
+            }
+        }
+        else {
+            queries = random_queries(*map, options.queries, options.seed);
+        }
+
+        run_cases(results, options.movingai_map, *map, queries, options);
+    }
+
+    for (const auto& kind : options.synthetic) {
+        Map map(options.size, options.size);
+        if (kind == "random") {
+            random_obstacles(map, 0.3, options.seed);
+        }
+        else if (kind == "maze") {
+            maze(map, options.seed);
+        }
+        else if (kind == "rooms") {
+            rooms(map, 15, options.seed);
+        }
+        else {
+            std::cerr << std::format("Unknown synthetic map {}\n", kind);
+            return false;
+        }
+
+        const auto queries = random_queries(map, options.queries, options.seed);
+        run_cases(results, std::format("{} {}x{}", kind, options.size, options.size), map, queries, options);
+    }
+
+    bool optimal = true;
+    for (const auto& result : results) {
+        // keep the standard output clean when the JSON goes there
+        print_result(options.json == "-" ? std::cerr : std::cout, result);
+        optimal = optimal && result.suboptimal == 0 && result.missed == 0;
+    }
+
+    if (options.json == "-") {
+        write_json(std::cout, results);
+    }
+    else if (!options.json.empty()) {
+        std::ofstream output(options.json);
+        write_json(output, results);
+        if (!output) {
+            std::cerr << std::format("Could not write {}\n", options.json);
+            return false;
+        }
+    }
+
+    return optimal;
+}
+
+/**
+ * @brief Compares all the solvers and search helpers on a map in the AStarv20 format.
+ */
+bool run_comparison(const std::string& filename, int iterations)
+{
+    const auto contents = read_map(filename);
+    if (contents.empty()) {
+        std::cerr << std::format("Could not read {}\n", filename);
+        return false;
+    }
+
+    return bench_solver<AStarSolver>("A* solver", contents, iterations) &&
+        bench_solver<OctileSolver>("Octile A* solver", contents, iterations) &&
+        bench_solver<IntegerSolver>("Integer A* solver", contents, iterations) &&
+        bench_solver<ManhattanSolver>("4 connected A* solver", contents, iterations) &&
+        bench_solver<DijkstraSolver>("Dijkstra solver", contents, iterations) &&
+        bench_solver<BidirectionalSolver>("Bidirectional A* solver", contents, iterations) &&
+        bench_solver<JumpPointSolver>("Jump point solver", contents, iterations) &&
+        bench_solver<HierarchicalSolver>("Hierarchical solver", contents, iterations) &&
+        bench_batch(contents, 256, iterations) &&
+        bench_async(contents, 256) &&
+        bench_flow_field(contents, 256, iterations) &&
+        bench_cooperative(contents, 256, 500) &&
+        bench_incremental(contents, iterations) &&
+        bench_cache(contents, 64, iterations) &&
+        bench_path_output(1025, 10) &&
+        bench_loading(2048) &&
+        bench_neighbour_masks(4096, 10) &&
+        bench_chunked(16384, std::size_t{ 64 } << 10, 20);
+}
+
+void usage()
+{
+    std::cerr <<
+        "usage: AStarDemoLibBench [map.txt [iterations]]\n"
+        "       AStarDemoLibBench [--movingai file.map [--scen file.scen]] [--synthetic random|maze|rooms|all]...\n"
+        "                         [--size cells] [--queries count] [--seed seed] [--no-check] [--policies] [--json file|-]\n";
+}
+
+export int main(int argc, char* argv[])
+{
+    if (argc < 2 || std::string(argv[1]).rfind("--", 0) != 0) {
+        const std::string filename = argc > 1 ? argv[1] : "../Map/AStarMap.txt";
+        const int iterations = argc > 2 ? std::atoi(argv[2]) : 20;
+        return run_comparison(filename, iterations) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    SuiteOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string option = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (option == "--no-check") {
+            options.check = false;
+        }
+        else if (option == "--policies") {
+            options.policies = true;
+        }
+        else if (!has_value) {
+            usage();
+            return EXIT_FAILURE;
+        }
+        else if (option == "--movingai") {
+            options.movingai_map = argv[++i];
+        }
+        else if (option == "--scen") {
+            options.scenarios = argv[++i];
+        }
+        else if (option == "--synthetic") {
+            const std::string kind = argv[++i];
+            if (kind == "all") {
+                options.synthetic.insert(options.synthetic.end(), { "random", "maze", "rooms" });
+            }
+            else {
+                options.synthetic.push_back(kind);
+            }
+        }
+        else if (option == "--size") {
+            options.size = std::max(std::atoi(argv[++i]), 1);
+        }
+        else if (option == "--queries") {
+            options.queries = std::max(std::atoi(argv[++i]), 1);
+        }
+        else if (option == "--seed") {
+            options.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (option == "--json") {
+            options.json = argv[++i];
+        }
+        else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    return run_suite(options) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,291 @@
+/* AStarSolverTests.ixx - unit tests for the AStarSolver class
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+module;
+
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <stop_token>
+#include <gtest/gtest.h>
+
+export module AStarSolverTests;
+
+import AStarLib;
+
+using namespace AStarLib;
+
+using namespace testing;
+
+TEST(AStarSolverTests, TestStraightPath)
+{
+    Map map(10, 10);
+    AStarSolver solver(map);
+
+    auto start = std::make_shared<Node>(1, 1);
+    auto goal = std::make_shared<Node>(1, 6);
+
+    auto path = solver.find(start, goal);
+
+    ASSERT_NE(path, nullptr);
+    ASSERT_EQ(5.0, path->cost());
+}
+
+TEST(AStarSolverTests, TestAroundWall)
+{
+    Map map(10, 10);
+    for (int row = 0; row < 7; ++row) {
+        map.set_pos(row, 4, Map::CellType::BLOCKED);
+    }
+    AStarSolver solver(map);
+
+    auto start = std::make_shared<Node>(1, 1);
+    auto goal = std::make_shared<Node>(1, 7);
+
+    auto path = solver.find(start, goal);
+
+    ASSERT_NE(path, nullptr);
+    // down to the end of the wall, and back up again, 3 diagonals and 3 straight moves each way
+    ASSERT_EQ(15.0, path->cost());
+
+    for (auto node = path; node != nullptr; node = node->get_parent()) {
+        ASSERT_NE(Map::CellType::BLOCKED, map.at(node->row(), node->col()));
+    }
+}
+
+TEST(AStarSolverTests, TestNoPath)
+{
+    Map map(10, 10);
+    for (int row = 0; row < 10; ++row) {
+        map.set_pos(row, 4, Map::CellType::BLOCKED);
+    }
+    AStarSolver solver(map);
+
+    auto start = std::make_shared<Node>(1, 1);
+    auto goal = std::make_shared<Node>(1, 7);
+
+    ASSERT_EQ(solver.find(start, goal), nullptr);
+
+    // the goal is on the other side of the wall, which is known without searching
+    ASSERT_EQ(SearchStatus::NOT_FOUND, solver.status());
+    ASSERT_EQ(0u, solver.stats().expansions);
+}
+
+TEST(AStarSolverTests, TestReuse)
+{
+    Map map(10, 10);
+    AStarSolver solver(map);
+
+    auto first = solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(8, 8));
+    ASSERT_NE(first, nullptr);
+    ASSERT_EQ(7 * 1.5, first->cost());
+
+    // nothing from the previous search must leak into the next one
+    map.set_pos(4, 4, Map::CellType::BLOCKED);
+    auto second = solver.find(std::make_shared<Node>(8, 1), std::make_shared<Node>(1, 8));
+    ASSERT_NE(second, nullptr);
+    ASSERT_EQ(7 * 1.5, second->cost());
+
+    int length = 0;
+    for (auto node = second; node != nullptr; node = node->get_parent()) {
+        ++length;
+    }
+    ASSERT_EQ(8, length);
+}
+
+TEST(AStarSolverTests, TestCopyPath)
+{
+    Map map(10, 10);
+    for (int row = 0; row < 7; ++row) {
+        map.set_pos(row, 4, Map::CellType::BLOCKED);
+    }
+    AStarSolver solver(map);
+
+    auto path = solver.find(1, 1, 1, 7);
+    ASSERT_EQ(15.0, path.cost());
+    ASSERT_EQ(solver.path_length(), path.size());
+    ASSERT_EQ((PathPoint{ 1, 1 }), path.front());
+    ASSERT_EQ((PathPoint{ 1, 7 }), path.back());
+
+    // the same cells as the chain of nodes, in the opposite order
+    auto node = solver.path();
+    for (auto point = path.points().rbegin(); point != path.points().rend(); ++point) {
+        ASSERT_NE(node, nullptr);
+        ASSERT_EQ(point->row, node->row());
+        ASSERT_EQ(point->col, node->col());
+        node = node->get_parent();
+    }
+    ASSERT_EQ(node, nullptr);
+
+    // nothing is written to memory too small to hold it
+    std::vector<PathPoint> points(path.size() - 1, PathPoint{ -1, -1 });
+    ASSERT_EQ(path.size(), solver.copy_path(points));
+    ASSERT_EQ((PathPoint{ -1, -1 }), points.front());
+
+    points.resize(path.size());
+    ASSERT_EQ(path.size(), solver.copy_path(points));
+    ASSERT_TRUE(std::equal(points.begin(), points.end(), path.begin(), path.end()));
+
+    // the path is straight lines between the turns
+    auto waypoints = path.waypoints();
+    ASSERT_LT(waypoints.size(), path.size());
+    auto expanded = waypoints.expanded();
+    ASSERT_TRUE(std::equal(expanded.begin(), expanded.end(), path.begin(), path.end()));
+
+    for (int row = 7; row < 10; ++row) {
+        map.set_pos(row, 4, Map::CellType::BLOCKED);
+    }
+    ASSERT_TRUE(solver.find(1, 1, 1, 7).empty());
+    ASSERT_FALSE(solver.copy_path(path));
+    ASSERT_TRUE(path.empty());
+    ASSERT_EQ(0u, solver.copy_path(points));
+}
+
+TEST(AStarSolverTests, TestSnapshot)
+{
+    Map map(10, 10);
+    for (int row = 0; row < 7; ++row) {
+        map.set_pos(row, 4, Map::CellType::BLOCKED);
+    }
+    AStarSolver solver(map.snapshot());
+
+    // edits made after the snapshot was taken are not seen by the solver
+    map.set_pos(7, 4, Map::CellType::BLOCKED);
+
+    auto path = solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 7));
+    ASSERT_NE(path, nullptr);
+    ASSERT_EQ(15.0, path->cost());
+
+    // and the map is left untouched
+    ASSERT_EQ(Map::CellType::FREE, map.at(1, 1));
+}
+
+TEST(AStarSolverTests, TestSteps)
+{
+    Map map(10, 10);
+    for (int row = 0; row < 7; ++row) {
+        map.set_pos(row, 4, Map::CellType::BLOCKED);
+    }
+    AStarSolver solver(map);
+    ASSERT_EQ(SearchStatus::IDLE, solver.status());
+
+    solver.start(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 7));
+    int steps = 0;
+    while (solver.step(3) == SearchStatus::RUNNING) {
+        ASSERT_EQ(nullptr, solver.path());
+        ++steps;
+    }
+
+    // the same path as a search done in one go
+    ASSERT_GT(steps, 1);
+    ASSERT_EQ(SearchStatus::FOUND, solver.status());
+    ASSERT_NE(solver.path(), nullptr);
+    ASSERT_EQ(15.0, solver.path()->cost());
+    ASSERT_EQ(solver.path(), solver.partial_path());
+}
+
+TEST(AStarSolverTests, TestRunUntil)
+{
+    Map map(10, 10);
+    AStarSolver solver(map);
+
+    solver.start(std::make_shared<Node>(1, 1), std::make_shared<Node>(8, 8));
+
+    // a deadline already past still runs one slice, which is enough on such a small map
+    ASSERT_EQ(SearchStatus::FOUND, solver.run_until(std::chrono::steady_clock::now()));
+    ASSERT_EQ(10.5, solver.path()->cost());
+}
+
+TEST(AStarSolverTests, TestCancel)
+{
+    Map map(10, 10);
+    for (int row = 0; row < 7; ++row) {
+        map.set_pos(row, 4, Map::CellType::BLOCKED);
+    }
+    AStarSolver solver(map);
+    std::stop_source stop;
+
+    solver.start(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 7), stop.get_token());
+    ASSERT_EQ(SearchStatus::RUNNING, solver.step(4));
+
+    stop.request_stop();
+    ASSERT_EQ(SearchStatus::CANCELLED, solver.step(100));
+    ASSERT_EQ(nullptr, solver.path());
+
+    // the partial path leads from the start towards the goal
+    auto partial = solver.partial_path();
+    ASSERT_NE(partial, nullptr);
+    auto node = partial;
+    while (node->get_parent() != nullptr) {
+        node = node->get_parent();
+    }
+    ASSERT_EQ(1, node->row());
+    ASSERT_EQ(1, node->col());
+    ASSERT_GT(partial->col(), 1);
+}
+
+TEST(AStarSolverTests, TestPolicies)
+{
+    Map map(10, 10);
+    for (int row = 0; row < 7; ++row) {
+        map.set_pos(row, 4, Map::CellType::BLOCKED);
+    }
+    auto start = std::make_shared<Node>(1, 1);
+    auto goal = std::make_shared<Node>(1, 7);
+
+    AStarSolver astar(map);
+    OctileSolver octile(map);
+    DijkstraSolver dijkstra(map);
+    ManhattanSolver manhattan(map);
+    IntegerSolver integer(map);
+
+    // all the 8 connected ones agree on the cost, the better informed the fewer expansions
+    ASSERT_EQ(15.0, astar.find(start, goal)->cost());
+    ASSERT_EQ(15.0, octile.find(start, goal)->cost());
+    ASSERT_EQ(15.0, dijkstra.find(start, goal)->cost());
+    ASSERT_EQ(15.0, integer.find(start, goal)->cost());
+    ASSERT_LE(octile.stats().expansions, astar.stats().expansions);
+    ASSERT_LT(astar.stats().expansions, dijkstra.stats().expansions);
+
+    // down 6 rows, across 6 columns and back up 6 rows, one straight step at a time
+    ASSERT_EQ(18.0, manhattan.find(start, goal)->cost());
+}
+
+TEST(AStarSolverTests, TestCornerCutting)
+{
+    // two walls touching by their corners, with a single free cell beyond them
+    Map map(3, 3);
+    map.set_pos(0, 1, Map::CellType::BLOCKED);
+    map.set_pos(1, 0, Map::CellType::BLOCKED);
+    map.set_pos(1, 2, Map::CellType::BLOCKED);
+    map.set_pos(2, 1, Map::CellType::BLOCKED);
+    auto start = std::make_shared<Node>(0, 0);
+    auto goal = std::make_shared<Node>(2, 2);
+
+    // the default moves squeeze diagonally between them
+    AStarSolver solver(map);
+    auto path = solver.find(start, goal);
+    ASSERT_NE(path, nullptr);
+    ASSERT_EQ(3.0, path->cost());
+
+    BasicAStarSolver<SearchPolicy<OctileHeuristic, StandardCost, EightConnectedNoCornerCutting>> strict(map);
+    ASSERT_EQ(nullptr, strict.find(start, goal));
+}
+
+export class AStarSolverTests;
@@ -0,0 +1,207 @@
+/* AsyncSolverTests.ixx - Unit tests for the searches awaited from coroutines
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+module;
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <latch>
+#include <limits>
+#include <memory>
+#include <stop_token>
+#include <vector>
+#include <gtest/gtest.h>
+
+export module AsyncSolverTests;
+
+import AStarLib;
+
+using namespace AStarLib;
+
+using namespace testing;
+
+namespace {
+    /**
+     * Coroutine that starts right away and is never awaited, enough to drive find_async().
+     */
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+    };
+
+    Detached search(AsyncSolver& solver, const Map& map, PathPoint start, PathPoint goal, std::stop_token stop,
+        AsyncResult& result, std::latch& done)
+    {
+        result = co_await solver.find_async(map, start, goal, TaskPriority::INTERACTIVE, stop);
+        done.count_down();
+    }
+
+    /**
+     * Runs the tasks right away on the calling thread, counting them.
+     */
+    struct InlineExecutor {
+        std::size_t tasks = 0;
+
+        std::size_t size() const noexcept { return 1; }
+
+        void submit(ThreadPool::Task task, TaskPriority) {
+            ++tasks;
+            task(0);
+        }
+    };
+
+    static_assert(SearchExecutor<ThreadPool> && SearchExecutor<InlineExecutor>);
+
+    /**
+     * Counts the cells the search closed.
+     */
+    struct ClosedCounter {
+        std::size_t closed = 0;
+
+        void on_push(int, int, double) noexcept {}
+        void on_decrease_key(int, int, double) noexcept {}
+        void on_close(int, int) noexcept { ++closed; }
+        void on_expand(int, int, double) noexcept {}
+    };
+
+    Detached observed_search(AsyncSolver& solver, const Map& map, PathPoint start, PathPoint goal, ClosedCounter& observer,
+        AsyncResult& result)
+    {
+        result = co_await solver.find_async(map, start, goal, observer);
+    }
+}
+
+TEST(AsyncSolverTests, TestFind)
+{
+    Map map(10, 10);
+    for (int row = 0; row < 7; ++row) {
+        map.set_pos(row, 4, Map::CellType::BLOCKED);
+    }
+
+    ThreadPool pool(2);
+    AsyncSolver solver(pool);
+    AsyncResult result;
+    std::latch done(1);
+    search(solver, map, { 1, 1 }, { 1, 7 }, {}, result, done);
+    done.wait();
+
+    ASSERT_EQ(SearchStatus::FOUND, result.status);
+    ASSERT_EQ(15.0, result.path.cost());
+    ASSERT_EQ((PathPoint{ 1, 1 }), result.path.front());
+    ASSERT_EQ((PathPoint{ 1, 7 }), result.path.back());
+}
+
+TEST(AsyncSolverTests, TestManySearches)
+{
+    Map map(32, 32);
+    for (int row = 0; row < 28; ++row) {
+        map.set_pos(row, 16, Map::CellType::BLOCKED);
+    }
+
+    ThreadPool pool(3);
+    AsyncSolver solver(pool);
+    constexpr int searches = 64;
+    std::vector<AsyncResult> results(searches);
+    std::latch done(searches);
+    for (int i = 0; i < searches; ++i) {
+        search(solver, map, { i % 32, 0 }, { (i * 7) % 32, 31 }, {}, results[i], done);
+    }
+    done.wait();
+
+    // the same paths as searching one at a time
+    AStarSolver reference(map);
+    for (int i = 0; i < searches; ++i) {
+        const auto expected = reference.find(i % 32, 0, (i * 7) % 32, 31);
+        ASSERT_EQ(SearchStatus::FOUND, results[i].status);
+        ASSERT_EQ(expected.cost(), results[i].path.cost());
+        ASSERT_EQ(expected.size(), results[i].path.size());
+    }
+}
+
+TEST(AsyncSolverTests, TestNotFound)
+{
+    Map map(10, 10);
+    for (int row = 0; row < 10; ++row) {
+        map.set_pos(row, 4, Map::CellType::BLOCKED);
+    }
+
+    InlineExecutor executor;
+    AsyncSolver solver(executor);
+    AsyncResult result;
+    std::latch done(1);
+    search(solver, map, { 1, 1 }, { 1, 7 }, {}, result, done);
+
+    // the inline executor already ran it
+    ASSERT_TRUE(done.try_wait());
+    ASSERT_EQ(1u, executor.tasks);
+    ASSERT_EQ(SearchStatus::NOT_FOUND, result.status);
+    ASSERT_TRUE(result.path.empty());
+}
+
+TEST(AsyncSolverTests, TestObserver)
+{
+    Map map(10, 10);
+    for (int row = 0; row < 7; ++row) {
+        map.set_pos(row, 4, Map::CellType::BLOCKED);
+    }
+
+    InlineExecutor executor;
+    AsyncSolver solver(executor);
+    ClosedCounter observer;
+    AsyncResult result;
+    observed_search(solver, map, { 1, 1 }, { 1, 7 }, observer, result);
+
+    // told about the same cells as a search on the calling thread
+    AStarSolver reference(map);
+    ClosedCounter expected;
+    reference.start(1, 1, 1, 7);
+    reference.step(std::numeric_limits<std::size_t>::max(), expected);
+
+    ASSERT_EQ(SearchStatus::FOUND, result.status);
+    ASSERT_GT(observer.closed, 0u);
+    ASSERT_EQ(expected.closed, observer.closed);
+}
+
+TEST(AsyncSolverTests, TestCancelled)
+{
+    Map map(10, 10);
+    InlineExecutor executor;
+    AsyncSolver solver(executor);
+
+    // stopped before being awaited, it never gets to the executor
+    std::stop_source stop;
+    stop.request_stop();
+    AsyncResult result;
+    result.status = SearchStatus::IDLE;
+    std::latch done(1);
+    search(solver, map, { 1, 1 }, { 8, 8 }, stop.get_token(), result, done);
+
+    ASSERT_TRUE(done.try_wait());
+    ASSERT_EQ(0u, executor.tasks);
+    ASSERT_EQ(SearchStatus::CANCELLED, result.status);
+    ASSERT_TRUE(result.path.empty());
+}
+
+export class AsyncSolverTests;
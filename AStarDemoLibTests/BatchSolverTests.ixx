@@ -0,0 +1,102 @@
+/* BatchSolverTests.ixx - unit tests for the BatchSolver class
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+module;
+
+#include <memory>
+#include <vector>
+#include <gtest/gtest.h>
+
+export module BatchSolverTests;
+
+import AStarLib;
+
+using namespace AStarLib;
+
+using namespace testing;
+
+TEST(BatchSolverTests, TestMatchesSingleSearches)
+{
+    Map map(30, 30);
+    for (int row = 0; row < 25; ++row) {
+        map.set_pos(row, 15, Map::CellType::BLOCKED);
+    }
+
+    std::vector<PathQuery> queries;
+    for (int i = 0; i < 28; ++i) {
+        queries.push_back({ Node(i, 1), Node(28 - i, 28) });
+    }
+
+    ThreadPool pool(4);
+    BatchSolver batch(pool);
+    std::vector<BatchSolver::NodePtr> results(queries.size());
+    batch.solve(map, queries, results);
+
+    AStarSolver solver(map.snapshot());
+    for (std::size_t i = 0; i < queries.size(); ++i) {
+        auto expected = solver.find(std::make_shared<Node>(queries[i].start.row(), queries[i].start.col()),
+            std::make_shared<Node>(queries[i].goal.row(), queries[i].goal.col()));
+
+        ASSERT_NE(results[i], nullptr);
+        ASSERT_EQ(expected->cost(), results[i]->cost());
+        ASSERT_EQ(queries[i].goal, *results[i]);
+    }
+
+    // the searches work on a snapshot, the map is left untouched
+    ASSERT_EQ(Map::CellType::FREE, map.at(1, 1));
+}
+
+TEST(BatchSolverTests, TestNoPath)
+{
+    Map map(10, 10);
+    for (int row = 0; row < 10; ++row) {
+        map.set_pos(row, 4, Map::CellType::BLOCKED);
+    }
+
+    const std::vector<PathQuery> queries = { { Node(1, 1), Node(1, 7) }, { Node(1, 1), Node(8, 2) } };
+    std::vector<BatchSolver::NodePtr> results(queries.size());
+
+    BatchSolver batch;
+    batch.solve(map, queries, results);
+
+    ASSERT_EQ(results[0], nullptr);
+    ASSERT_NE(results[1], nullptr);
+}
+
+TEST(BatchSolverTests, TestReuse)
+{
+    Map map(10, 10);
+    ThreadPool pool(2);
+    BatchSolver batch(pool);
+
+    const std::vector<PathQuery> queries = { { Node(1, 1), Node(1, 7) } };
+    std::vector<BatchSolver::NodePtr> results(queries.size());
+
+    batch.solve(map, queries, results);
+    ASSERT_NE(results[0], nullptr);
+    ASSERT_EQ(6.0, results[0]->cost());
+
+    // the next batch sees the edits done in between
+    for (int row = 0; row < 10; ++row) {
+        map.set_pos(row, 4, Map::CellType::BLOCKED);
+    }
+    batch.solve(map, queries, results);
+    ASSERT_EQ(results[0], nullptr);
+}
+
+export class BatchSolverTests;
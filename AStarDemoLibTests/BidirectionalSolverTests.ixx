@@ -0,0 +1,148 @@
+/* BidirectionalSolverTests.ixx - unit tests for the BidirectionalSolver class
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+module;
+
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <gtest/gtest.h>
+
+export module BidirectionalSolverTests;
+
+import AStarLib;
+
+using namespace AStarLib;
+
+using namespace testing;
+
+TEST(BidirectionalSolverTests, TestStartIsGoal)
+{
+    Map map(10, 10);
+    BidirectionalSolver solver(map);
+
+    auto path = solver.find(std::make_shared<Node>(3, 3), std::make_shared<Node>(3, 3));
+    ASSERT_NE(path, nullptr);
+    ASSERT_EQ(0.0, path->cost());
+    ASSERT_EQ(path->get_parent(), nullptr);
+}
+
+TEST(BidirectionalSolverTests, TestPocket)
+{
+    // the goal sits in a pocket facing away from the start, which A* floods
+    Map map(40, 40);
+    for (int row = 12; row <= 28; ++row) {
+        map.set_pos(row, 18, Map::CellType::BLOCKED);
+    }
+    for (int col = 5; col <= 18; ++col) {
+        map.set_pos(12, col, Map::CellType::BLOCKED);
+        map.set_pos(28, col, Map::CellType::BLOCKED);
+    }
+    const auto snapshot = map.snapshot();
+
+    AStarSolver reference(snapshot);
+    auto expected = reference.find(std::make_shared<Node>(20, 35), std::make_shared<Node>(20, 10));
+    ASSERT_NE(expected, nullptr);
+
+    BidirectionalSolver solver(snapshot);
+    auto path = solver.find(std::make_shared<Node>(20, 35), std::make_shared<Node>(20, 10));
+    ASSERT_NE(path, nullptr);
+    ASSERT_EQ(expected->cost(), path->cost());
+
+    ASSERT_LT(solver.stats().expansions, reference.stats().expansions);
+}
+
+TEST(BidirectionalSolverTests, TestStoppingRule)
+{
+    const char* const rows[] = {
+        "....#..#",
+        "#.#..##.",
+        ".#...#..",
+        "...#....",
+        "......#.",
+        ".#.##...",
+        "#......#",
+        "#.#..#..",
+    };
+    Map map(8, 8);
+    for (int row = 0; row < 8; ++row) {
+        for (int col = 0; col < 8; ++col) {
+            if (rows[row][col] == '#') {
+                map.set_pos(row, col, Map::CellType::BLOCKED);
+            }
+        }
+    }
+    BidirectionalSolver solver(map);
+
+    // the frontiers first meet on a path costing 5.5, cells still queued then lead to a shorter one
+    auto path = solver.find(std::make_shared<Node>(3, 5), std::make_shared<Node>(6, 3));
+    ASSERT_NE(path, nullptr);
+    ASSERT_EQ(4.5, path->cost());
+}
+
+TEST(BidirectionalSolverTests, TestMatchesAStarOnRandomMaps)
+{
+    for (unsigned seed = 1; seed <= 5; ++seed) {
+        Map map(32, 32);
+        std::mt19937 random(seed);
+        std::bernoulli_distribution wall(0.3);
+        for (int row = 0; row < map.rows(); ++row) {
+            for (int col = 0; col < map.columns(); ++col) {
+                if (wall(random)) {
+                    map.set_pos(row, col, Map::CellType::BLOCKED);
+                }
+            }
+        }
+
+        const auto snapshot = map.snapshot();
+        AStarSolver reference(snapshot);
+        BidirectionalSolver solver(snapshot);
+
+        std::uniform_int_distribution<int> cells(0, 31);
+        for (int query = 0; query < 50; ++query) {
+            const int start_row = cells(random), start_col = cells(random);
+            const int goal_row = cells(random), goal_col = cells(random);
+            if (!map.passable(start_row, start_col) || !map.passable(goal_row, goal_col)) {
+                continue;
+            }
+
+            auto expected = reference.find(std::make_shared<Node>(start_row, start_col), std::make_shared<Node>(goal_row, goal_col));
+            auto path = solver.find(std::make_shared<Node>(start_row, start_col), std::make_shared<Node>(goal_row, goal_col));
+            ASSERT_EQ(expected == nullptr, path == nullptr) << seed << ", " << query;
+            if (expected == nullptr) {
+                continue;
+            }
+            ASSERT_DOUBLE_EQ(expected->cost(), path->cost()) << seed << ", " << query;
+
+            // both halves join into one walkable chain of neighbours
+            ASSERT_EQ(goal_row, path->row());
+            ASSERT_EQ(goal_col, path->col());
+            auto node = path;
+            for (; node->get_parent() != nullptr; node = node->get_parent()) {
+                const auto parent = node->get_parent();
+                ASSERT_TRUE(map.passable(node->row(), node->col()));
+                ASSERT_LE(std::abs(node->row() - parent->row()), 1);
+                ASSERT_LE(std::abs(node->col() - parent->col()), 1);
+            }
+            ASSERT_EQ(start_row, node->row());
+            ASSERT_EQ(start_col, node->col());
+        }
+    }
+}
+
+export class BidirectionalSolverTests;
@@ -0,0 +1,201 @@
+/* ChunkedMapTests.ixx - unit tests for the ChunkedMap and ChunkedSolver classes
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+module;
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <gtest/gtest.h>
+
+export module ChunkedMapTests;
+
+import AStarLib;
+
+using namespace AStarLib;
+
+using namespace testing;
+
+namespace {
+    std::filesystem::path chunk_file(const char* name)
+    {
+        return std::filesystem::temp_directory_path() / name;
+    }
+
+    void add_walls(Map& map, unsigned seed)
+    {
+        std::mt19937 random(seed);
+        std::bernoulli_distribution wall(0.25);
+        for (int row = 0; row < map.rows(); ++row) {
+            for (int col = 0; col < map.columns(); ++col) {
+                if (wall(random)) {
+                    map.set_pos(row, col, Map::CellType::BLOCKED);
+                }
+            }
+        }
+    }
+}
+
+TEST(ChunkedMapTests, TestContents)
+{
+    const auto path = chunk_file("ChunkedMapTests_contents.chunks");
+    Map map(150, 200);
+    add_walls(map, 7);
+    ASSERT_TRUE(save_chunked_map(map, path));
+
+    // room for only four of the twelve chunks
+    auto chunked = ChunkedMap::open(path, 4 * 512);
+    ASSERT_NE(chunked, nullptr);
+    ASSERT_EQ(150, chunked->rows());
+    ASSERT_EQ(200, chunked->columns());
+    ASSERT_EQ(12u, chunked->chunk_count());
+    ASSERT_EQ(4u, chunked->capacity());
+
+    for (int row = -1; row <= map.rows(); ++row) {
+        for (int col = -1; col <= map.columns(); ++col) {
+            ASSERT_EQ(map.passable(row, col), chunked->passable(row, col));
+        }
+    }
+    ASSERT_EQ(map.at(10, 10), chunked->at(10, 10));
+    ASSERT_THROW(chunked->at(150, 0), std::out_of_range);
+
+    ASSERT_LE(chunked->resident_chunks(), 4u);
+    ASSERT_GT(chunked->evictions(), 0u);
+
+    chunked.reset();
+    std::filesystem::remove(path);
+}
+
+TEST(ChunkedMapTests, TestWriter)
+{
+    const auto path = chunk_file("ChunkedMapTests_writer.chunks");
+
+    // a 100 x 100 checkerboard of 10 x 10 blocks, the bits outside of the map get dropped
+    ASSERT_TRUE(write_chunked_map(path, 100, 100, [](int first_row, int first_col, ChunkedMap::ChunkWords words) {
+        for (int row = 0; row < ChunkedMap::chunk_size; ++row) {
+            for (int col = 0; col < ChunkedMap::chunk_size; ++col) {
+                if (((first_row + row) / 10 + (first_col + col) / 10) % 2 == 0) {
+                    words[row] |= std::uint64_t{ 1 } << col;
+                }
+            }
+        }
+    }));
+
+    auto chunked = ChunkedMap::open(path);
+    ASSERT_NE(chunked, nullptr);
+    ASSERT_TRUE(chunked->passable(0, 0));
+    ASSERT_FALSE(chunked->passable(0, 10));
+    ASSERT_TRUE(chunked->passable(99, 99));
+    ASSERT_FALSE(chunked->passable(100, 99));
+    ASSERT_FALSE(chunked->passable(99, 100));
+
+    chunked.reset();
+    std::filesystem::remove(path);
+    ASSERT_EQ(nullptr, ChunkedMap::open(path));
+}
+
+TEST(ChunkedMapTests, TestPrefetch)
+{
+    const auto path = chunk_file("ChunkedMapTests_prefetch.chunks");
+    ASSERT_TRUE(save_chunked_map(Map(128, 128), path));
+
+    auto chunked = ChunkedMap::open(path);
+    ASSERT_NE(chunked, nullptr);
+    chunked->prefetch(100, 100);
+    chunked->prefetch(-1, 5);
+
+    // the hint never changes the answers, and the chunk is read once whether it was served already or not
+    ASSERT_TRUE(chunked->passable(100, 100));
+    ASSERT_EQ(1u, chunked->loads());
+
+    chunked.reset();
+    std::filesystem::remove(path);
+}
+
+TEST(ChunkedMapTests, TestSolverMatchesAStar)
+{
+    const auto path = chunk_file("ChunkedMapTests_solver.chunks");
+    Map map(160, 160);
+    add_walls(map, 11);
+    ASSERT_TRUE(save_chunked_map(map, path));
+
+    auto chunked = ChunkedMap::open(path, 6 * 512);
+    ASSERT_NE(chunked, nullptr);
+    ChunkedSolver solver(*chunked);
+    AStarSolver reference(map.snapshot());
+
+    std::mt19937 random(3);
+    std::uniform_int_distribution<int> cells(0, 159);
+    for (int query = 0; query < 20; ++query) {
+        const int start_row = cells(random), start_col = cells(random);
+        const int goal_row = cells(random), goal_col = cells(random);
+        if (!map.passable(start_row, start_col) || !map.passable(goal_row, goal_col)) {
+            continue;
+        }
+
+        auto expected = reference.find(std::make_shared<Node>(start_row, start_col), std::make_shared<Node>(goal_row, goal_col));
+        auto path_found = solver.find(std::make_shared<Node>(start_row, start_col), std::make_shared<Node>(goal_row, goal_col));
+        ASSERT_EQ(expected == nullptr, path_found == nullptr);
+        if (expected != nullptr) {
+            ASSERT_DOUBLE_EQ(expected->cost(), path_found->cost());
+            for (auto node = path_found; node != nullptr; node = node->get_parent()) {
+                ASSERT_TRUE(map.passable(node->row(), node->col()));
+            }
+        }
+    }
+    ASSERT_LE(chunked->resident_chunks(), 6u);
+
+    chunked.reset();
+    std::filesystem::remove(path);
+}
+
+TEST(ChunkedMapTests, TestSolverBudget)
+{
+    const auto path = chunk_file("ChunkedMapTests_budget.chunks");
+
+    // the goal is walled in, so the whole rest of the map gets searched
+    Map map(100, 100);
+    for (int cell = 0; cell < 5; ++cell) {
+        map.set_pos(88, 88 + cell, Map::CellType::BLOCKED);
+        map.set_pos(92, 88 + cell, Map::CellType::BLOCKED);
+        map.set_pos(88 + cell, 88, Map::CellType::BLOCKED);
+        map.set_pos(88 + cell, 92, Map::CellType::BLOCKED);
+    }
+    ASSERT_TRUE(save_chunked_map(map, path));
+
+    auto chunked = ChunkedMap::open(path);
+    ASSERT_NE(chunked, nullptr);
+
+    ChunkedSolver limited(*chunked, 1000);
+    ASSERT_EQ(nullptr, limited.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(90, 90)));
+    ASSERT_EQ(SearchStatus::RUNNING, limited.status());
+    ASSERT_LE(limited.stats().expansions, 1000u);
+
+    ChunkedSolver solver(*chunked);
+    ASSERT_EQ(nullptr, solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(90, 90)));
+    ASSERT_EQ(SearchStatus::NOT_FOUND, solver.status());
+    ASSERT_NE(nullptr, solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(5, 5)));
+    ASSERT_EQ(SearchStatus::FOUND, solver.status());
+
+    chunked.reset();
+    std::filesystem::remove(path);
+}
+
+export class ChunkedMapTests;
@@ -0,0 +1,175 @@
+/* ConnectivityTests.ixx - unit tests for the Connectivity class
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+module;
+
+#include <cstddef>
+#include <random>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+
+export module ConnectivityTests;
+
+import AStarLib;
+
+using namespace AStarLib;
+
+using namespace testing;
+
+namespace {
+    /**
+     * Flood fill from a cell with 8 connectivity, what the components must agree with.
+     */
+    std::vector<bool> flood(const Map& map, int row, int col)
+    {
+        const int cols = map.columns();
+        std::vector<bool> reached(static_cast<std::size_t>(map.rows()) * cols, false);
+        std::vector<std::pair<int, int>> pending{ { row, col } };
+        reached[static_cast<std::size_t>(row) * cols + col] = true;
+
+        while (!pending.empty()) {
+            const auto [r, c] = pending.back();
+            pending.pop_back();
+            for (int next_row = r - 1; next_row <= r + 1; ++next_row) {
+                for (int next_col = c - 1; next_col <= c + 1; ++next_col) {
+                    if (!map.passable(next_row, next_col)) {
+                        continue;
+                    }
+                    const auto next = static_cast<std::size_t>(next_row) * cols + next_col;
+                    if (!reached[next]) {
+                        reached[next] = true;
+                        pending.emplace_back(next_row, next_col);
+                    }
+                }
+            }
+        }
+        return reached;
+    }
+
+    // a wall down the middle of the map
+    void split(Map& map, int col)
+    {
+        for (int row = 0; row < map.rows(); ++row) {
+            map.set_pos(row, col, Map::CellType::BLOCKED);
+        }
+    }
+}
+
+TEST(ConnectivityTests, TestComponents)
+{
+    Map map(10, 10);
+    split(map, 4);
+
+    ASSERT_TRUE(map.connected(1, 1, 8, 3));
+    ASSERT_FALSE(map.connected(1, 1, 1, 7));
+
+    // blocked goals can't be reached, blocked starts are left through their neighbours
+    ASSERT_FALSE(map.connected(1, 1, 5, 4));
+    ASSERT_TRUE(map.connected(5, 4, 1, 7));
+    ASSERT_TRUE(map.connected(5, 4, 5, 4));
+}
+
+TEST(ConnectivityTests, TestIncremental)
+{
+    Map map(10, 10);
+    split(map, 4);
+    ASSERT_FALSE(map.connected(1, 1, 1, 7));
+
+    // opening a door merges both sides, closing it splits them again
+    map.set_pos(9, 4, Map::CellType::FREE);
+    ASSERT_TRUE(map.connected(1, 1, 1, 7));
+
+    map.set_pos(9, 4, Map::CellType::BLOCKED);
+    ASSERT_FALSE(map.connected(1, 1, 1, 7));
+
+    // a door can't be closed from a single side of it
+    map.set_pos(5, 4, Map::CellType::FREE);
+    map.set_pos(5, 3, Map::CellType::BLOCKED);
+    ASSERT_TRUE(map.connected(1, 1, 1, 7));
+}
+
+TEST(ConnectivityTests, TestBlockWithoutSplit)
+{
+    Map map(10, 10);
+    Connectivity connectivity;
+    connectivity.build(map);
+
+    // the cells around are still joined among themselves
+    map.set_pos(5, 5, Map::CellType::BLOCKED);
+    connectivity.block(map, 5, 5);
+    ASSERT_TRUE(connectivity.valid());
+    ASSERT_TRUE(connectivity.connected(map, 4, 4, 6, 6));
+
+    // a one cell gap in a wall may split it
+    map.set_pos(2, 1, Map::CellType::BLOCKED);
+    map.set_pos(2, 3, Map::CellType::BLOCKED);
+    connectivity.build(map);
+    map.set_pos(2, 2, Map::CellType::BLOCKED);
+    connectivity.block(map, 2, 2);
+    ASSERT_FALSE(connectivity.valid());
+}
+
+TEST(ConnectivityTests, TestSnapshot)
+{
+    Map map(10, 10);
+    split(map, 4);
+
+    auto snapshot = map.snapshot();
+    ASSERT_FALSE(snapshot->connected(1, 1, 1, 7));
+
+    map.set_pos(0, 4, Map::CellType::FREE);
+    ASSERT_FALSE(snapshot->connected(1, 1, 1, 7));
+    ASSERT_TRUE(map.snapshot()->connected(1, 1, 1, 7));
+}
+
+TEST(ConnectivityTests, TestMatchesFloodFill)
+{
+    Map map(24, 31);
+    std::mt19937 random(11);
+    std::bernoulli_distribution wall(0.35);
+    for (int row = 0; row < map.rows(); ++row) {
+        for (int col = 0; col < map.columns(); ++col) {
+            if (wall(random)) {
+                map.set_pos(row, col, Map::CellType::BLOCKED);
+            }
+        }
+    }
+
+    std::uniform_int_distribution<int> rows(0, map.rows() - 1);
+    std::uniform_int_distribution<int> cols(0, map.columns() - 1);
+    for (int edit = 0; edit < 200; ++edit) {
+        map.set_pos(rows(random), cols(random), wall(random) ? Map::CellType::BLOCKED : Map::CellType::FREE);
+
+        const int row = rows(random);
+        const int col = cols(random);
+        if (!map.passable(row, col)) {
+            continue;
+        }
+
+        const auto reached = flood(map, row, col);
+        for (int other_row = 0; other_row < map.rows(); ++other_row) {
+            for (int other_col = 0; other_col < map.columns(); ++other_col) {
+                const bool expected = reached[static_cast<std::size_t>(other_row) * map.columns() + other_col];
+                ASSERT_EQ(expected, map.connected(row, col, other_row, other_col)) << edit;
+            }
+        }
+    }
+}
+
+export class ConnectivityTests;
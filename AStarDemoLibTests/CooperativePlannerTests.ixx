@@ -0,0 +1,181 @@
+/* CooperativePlannerTests.ixx - unit tests for the CooperativePlanner class
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+module;
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+
+export module CooperativePlannerTests;
+
+import AStarLib;
+
+using namespace AStarLib;
+
+using namespace testing;
+
+namespace {
+    /**
+     * Runs the planner until every agent arrived, checking each tick that no two agents
+     * share a cell or swap places, and that they only move to neighbouring cells.
+     * @return how many ticks it took, or max_ticks when some agent did not arrive.
+     */
+    int run_agents(CooperativePlanner& planner, int max_ticks)
+    {
+        std::vector<std::pair<int, int>> previous(planner.agents());
+        for (std::size_t agent = 0; agent < planner.agents(); ++agent) {
+            previous[agent] = planner.position(agent);
+        }
+
+        for (int tick = 0; tick < max_ticks; ++tick) {
+            bool all_arrived = true;
+            for (std::size_t agent = 0; agent < planner.agents(); ++agent) {
+                all_arrived = all_arrived && planner.arrived(agent);
+            }
+            if (all_arrived) {
+                return tick;
+            }
+
+            planner.tick();
+
+            std::set<std::pair<int, int>> occupied;
+            for (std::size_t agent = 0; agent < planner.agents(); ++agent) {
+                const auto position = planner.position(agent);
+                EXPECT_TRUE(occupied.insert(position).second) << "tick " << tick << ", agent " << agent;
+                EXPECT_LE(std::abs(position.first - previous[agent].first), 1);
+                EXPECT_LE(std::abs(position.second - previous[agent].second), 1);
+
+                for (std::size_t other = 0; other < agent; ++other) {
+                    const bool swapped = position == previous[other] && planner.position(other) == previous[agent] && position != previous[agent];
+                    EXPECT_FALSE(swapped) << "tick " << tick << ", agents " << other << " and " << agent;
+                }
+            }
+            for (std::size_t agent = 0; agent < planner.agents(); ++agent) {
+                previous[agent] = planner.position(agent);
+            }
+        }
+        return max_ticks;
+    }
+}
+
+TEST(CooperativePlannerTests, TestSpaceTimeTable)
+{
+    SpaceTimeTable table(16);
+
+    table.assign(3, 7, 42);
+    ASSERT_EQ(42u, table.find(3, 7));
+    ASSERT_EQ(SpaceTimeTable::npos, table.find(7, 3));
+
+    table.assign(3, 7, 43);
+    ASSERT_EQ(1u, table.size());
+    ASSERT_EQ(43u, table.find(3, 7));
+
+    ASSERT_TRUE(table.erase(3, 7));
+    ASSERT_FALSE(table.erase(3, 7));
+    ASSERT_EQ(SpaceTimeTable::npos, table.find(3, 7));
+
+    // growing keeps everything that was stored
+    for (std::uint32_t i = 0; i < 1000; ++i) {
+        table.assign(i, i % 17, i);
+    }
+    ASSERT_EQ(1000u, table.size());
+    ASSERT_GE(table.capacity(), 2000u);
+    for (std::uint32_t i = 0; i < 1000; ++i) {
+        ASSERT_EQ(i, table.find(i, i % 17));
+    }
+
+    table.clear();
+    ASSERT_EQ(0u, table.size());
+    ASSERT_EQ(SpaceTimeTable::npos, table.find(5, 5));
+}
+
+TEST(CooperativePlannerTests, TestCorridor)
+{
+    // a one cell wide corridor, with a pocket to step aside into
+    Map map(3, 11);
+    for (int col = 0; col < map.columns(); ++col) {
+        map.set_pos(0, col, Map::CellType::BLOCKED);
+        if (col != 5) {
+            map.set_pos(2, col, Map::CellType::BLOCKED);
+        }
+    }
+
+    CooperativePlanner planner(map, 8);
+    planner.add_agent(1, 0, 1, 10);
+    planner.add_agent(1, 10, 1, 0);
+
+    ASSERT_LT(run_agents(planner, 60), 60);
+    ASSERT_EQ(std::make_pair(1, 10), planner.position(0));
+    ASSERT_EQ(std::make_pair(1, 0), planner.position(1));
+}
+
+TEST(CooperativePlannerTests, TestCrowd)
+{
+    Map map(24, 24);
+    for (int row = 4; row < 20; ++row) {
+        map.set_pos(row, 12, Map::CellType::BLOCKED);
+    }
+
+    // everyone swaps sides of the wall, through the same two gaps
+    CooperativePlanner planner(map);
+    std::mt19937 random(5);
+    std::vector<int> rows(map.rows());
+    for (int row = 0; row < map.rows(); ++row) {
+        rows[row] = row;
+    }
+    std::shuffle(rows.begin(), rows.end(), random);
+    for (int i = 0; i < map.rows(); ++i) {
+        planner.add_agent(i, 0, rows[i], 23);
+        planner.add_agent(i, 23, rows[i], 0);
+    }
+
+    ASSERT_LT(run_agents(planner, 200), 200);
+    ASSERT_GT(planner.stats().expansions, 0u);
+}
+
+TEST(CooperativePlannerTests, TestUnreachableGoal)
+{
+    Map map(5, 5);
+    for (int row = 0; row < map.rows(); ++row) {
+        map.set_pos(row, 2, Map::CellType::BLOCKED);
+    }
+
+    CooperativePlanner planner(map);
+    planner.add_agent(2, 0, 2, 4);
+    for (int tick = 0; tick < 10; ++tick) {
+        planner.tick();
+    }
+
+    ASSERT_EQ(std::make_pair(2, 0), planner.position(0));
+    ASSERT_FALSE(planner.arrived(0));
+
+    planner.set_goal(0, 4, 1);
+    for (int tick = 0; tick < 10; ++tick) {
+        planner.tick();
+    }
+    ASSERT_TRUE(planner.arrived(0));
+}
+
+export class CooperativePlannerTests;
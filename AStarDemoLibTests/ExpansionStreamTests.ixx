@@ -0,0 +1,167 @@
+/* ExpansionStreamTests.ixx - unit tests for the ExpansionStream class
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+module;
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+export module ExpansionStreamTests;
+
+import AStarLib;
+
+using namespace AStarLib;
+
+using namespace testing;
+
+TEST(ExpansionStreamTests, TestWrapAround)
+{
+    ExpansionStream stream(4);
+    ASSERT_EQ(4u, stream.capacity());
+
+    std::vector<std::uint32_t> cells;
+    for (std::uint32_t i = 0; i < 10; ++i) {
+        ASSERT_TRUE(stream.try_publish({ i, SearchContext::CellState::OPEN }));
+        stream.drain([&cells](const ExpansionEvent& event) { cells.push_back(event.cell); });
+    }
+
+    ASSERT_EQ(10u, cells.size());
+    for (std::uint32_t i = 0; i < 10; ++i) {
+        ASSERT_EQ(i, cells[i]);
+    }
+}
+
+TEST(ExpansionStreamTests, TestFullStream)
+{
+    ExpansionStream stream(3);
+    ASSERT_EQ(4u, stream.capacity());
+
+    for (std::uint32_t i = 0; i < 4; ++i) {
+        ASSERT_TRUE(stream.try_publish({ i, SearchContext::CellState::OPEN }));
+    }
+    ASSERT_FALSE(stream.try_publish({ 4, SearchContext::CellState::OPEN }));
+
+    // a limited drain makes room for as many events as it took
+    ASSERT_EQ(2u, stream.drain([](const ExpansionEvent&) {}, 2));
+    ASSERT_TRUE(stream.try_publish({ 4, SearchContext::CellState::OPEN }));
+    ASSERT_TRUE(stream.try_publish({ 5, SearchContext::CellState::OPEN }));
+    ASSERT_FALSE(stream.try_publish({ 6, SearchContext::CellState::OPEN }));
+
+    // a closed stream drops what does not fit, instead of waiting
+    stream.close();
+    stream.publish({ 6, SearchContext::CellState::OPEN });
+    ASSERT_EQ(1u, stream.dropped());
+
+    stream.discard();
+    ASSERT_EQ(0u, stream.drain([](const ExpansionEvent&) {}));
+}
+
+TEST(ExpansionStreamTests, TestOverflowRefresh)
+{
+    ExpansionStream stream(2);
+    stream.track(8);
+
+    stream.publish({ 0, SearchContext::CellState::UNSEEN });
+    stream.publish({ 3, SearchContext::CellState::OPEN });
+    stream.publish({ 5, SearchContext::CellState::OPEN });
+    stream.publish({ 3, SearchContext::CellState::CLOSED });
+    ASSERT_EQ(2u, stream.dropped());
+    ASSERT_TRUE(stream.overflowed());
+
+    // the queued events are replaced by the latest state of every cell seen
+    std::vector<ExpansionEvent> events;
+    stream.drain([&events](const ExpansionEvent& event) { events.push_back(event); });
+    ASSERT_FALSE(stream.overflowed());
+    ASSERT_EQ(3u, events.size());
+    ASSERT_EQ(SearchContext::CellState::UNSEEN, events[0].state);
+    ASSERT_EQ(3u, events[1].cell);
+    ASSERT_EQ(SearchContext::CellState::CLOSED, events[1].state);
+    ASSERT_EQ(5u, events[2].cell);
+    ASSERT_EQ(SearchContext::CellState::OPEN, events[2].state);
+
+    // back to plain events
+    stream.publish({ 6, SearchContext::CellState::OPEN });
+    events.clear();
+    stream.drain([&events](const ExpansionEvent& event) { events.push_back(event); });
+    ASSERT_EQ(1u, events.size());
+    ASSERT_EQ(6u, events[0].cell);
+}
+
+TEST(ExpansionStreamTests, TestConcurrentOverflow)
+{
+    constexpr std::uint32_t count = 100000;
+    ExpansionStream stream(64);
+    stream.track(count);
+
+    // the producer never waits, however far behind the consumer is
+    std::thread producer([&stream] {
+        for (std::uint32_t i = 0; i < count; ++i) {
+            stream.publish({ i, SearchContext::CellState::OPEN });
+            stream.publish({ i, SearchContext::CellState::CLOSED });
+        }
+    });
+
+    std::vector<SearchContext::CellState> states(count, SearchContext::CellState::UNSEEN);
+    const auto apply = [&states](const ExpansionEvent& event) {
+        if (event.state == SearchContext::CellState::UNSEEN) {
+            states.assign(states.size(), SearchContext::CellState::UNSEEN);
+        }
+        else {
+            states[event.cell] = event.state;
+        }
+    };
+    while (stream.drain(apply) > 0 || states.back() != SearchContext::CellState::CLOSED) {
+        std::this_thread::yield();
+    }
+    producer.join();
+    stream.drain(apply);
+
+    // whatever was dropped, the consumer ends up with the final states
+    for (const auto state : states) {
+        ASSERT_EQ(SearchContext::CellState::CLOSED, state);
+    }
+}
+
+TEST(ExpansionStreamTests, TestStreamObserver)
+{
+    Map map(10, 10);
+    for (int row = 0; row < 7; ++row) {
+        map.set_pos(row, 4, Map::CellType::BLOCKED);
+    }
+    AStarSolver solver(map);
+    ExpansionStream stream(1 << 12);
+    StreamObserver observer(stream, map.columns());
+
+    auto path = solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 7), observer);
+    ASSERT_NE(path, nullptr);
+
+    std::vector<ExpansionEvent> events;
+    stream.drain([&events](const ExpansionEvent& event) { events.push_back(event); });
+
+    // the search start marker, then one event per push and per close
+    ASSERT_EQ(1 + solver.stats().pushes + solver.stats().pops, events.size());
+    ASSERT_EQ(SearchContext::CellState::UNSEEN, events.front().state);
+    ASSERT_EQ(static_cast<std::uint32_t>(1 * map.columns() + 7), events.back().cell);
+    ASSERT_EQ(SearchContext::CellState::CLOSED, events.back().state);
+}
+
+export class ExpansionStreamTests;
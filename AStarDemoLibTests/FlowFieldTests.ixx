@@ -0,0 +1,119 @@
+/* FlowFieldTests.ixx - unit tests for the FlowField class
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+module;
+
+#include <cmath>
+#include <memory>
+#include <gtest/gtest.h>
+
+export module FlowFieldTests;
+
+import AStarLib;
+
+using namespace AStarLib;
+
+using namespace testing;
+
+TEST(FlowFieldTests, TestMatchesSolver)
+{
+    Map map(20, 20);
+    for (int row = 0; row < 15; ++row) {
+        map.set_pos(row, 10, Map::CellType::BLOCKED);
+    }
+    FlowField field(map);
+    field.set_goal(2, 17);
+
+    AStarSolver solver(map.snapshot());
+    for (int row = 0; row < 20; row += 3) {
+        for (int col = 0; col < 10; col += 2) {
+            auto expected = solver.find(std::make_shared<Node>(row, col), std::make_shared<Node>(2, 17));
+            ASSERT_NE(expected, nullptr);
+            ASSERT_EQ(expected->cost(), field.distance(row, col));
+
+            auto path = field.find(std::make_shared<Node>(row, col));
+            ASSERT_NE(path, nullptr);
+            ASSERT_EQ(expected->cost(), path->cost());
+            ASSERT_EQ(2, path->row());
+            ASSERT_EQ(17, path->col());
+        }
+    }
+}
+
+TEST(FlowFieldTests, TestDirection)
+{
+    Map map(10, 10);
+    FlowField field(map);
+    field.set_goal(5, 5);
+
+    ASSERT_EQ(FlowField::no_direction, field.direction(5, 5));
+
+    const int direction = field.direction(2, 5);
+    ASSERT_EQ(1, FlowField::row_step(direction));
+    ASSERT_EQ(0, FlowField::col_step(direction));
+}
+
+TEST(FlowFieldTests, TestLazy)
+{
+    Map map(100, 100);
+    FlowField field(map);
+    field.set_goal(50, 50);
+
+    ASSERT_EQ(1.0, field.distance(50, 51));
+    ASSERT_LT(field.settled_cells(), 100u);
+
+    field.expand_all();
+    ASSERT_EQ(100u * 100u, field.settled_cells());
+}
+
+TEST(FlowFieldTests, TestNoPath)
+{
+    Map map(10, 10);
+    for (int row = 0; row < 10; ++row) {
+        map.set_pos(row, 4, Map::CellType::BLOCKED);
+    }
+    FlowField field(map);
+    field.set_goal(1, 7);
+
+    ASSERT_TRUE(std::isinf(field.distance(1, 1)));
+    ASSERT_EQ(FlowField::no_direction, field.direction(1, 1));
+    ASSERT_EQ(field.find(std::make_shared<Node>(1, 1)), nullptr);
+}
+
+TEST(FlowFieldTests, TestMapChanges)
+{
+    Map map(10, 10);
+    FlowField field(map);
+    field.set_goal(1, 7);
+    ASSERT_EQ(6.0, field.distance(1, 1));
+
+    // visiting cells doesn't invalidate the field
+    map.visit(1, 2);
+    field.distance(1, 1);
+    const auto settled = field.settled_cells();
+    ASSERT_EQ(6.0, field.distance(1, 1));
+    ASSERT_EQ(settled, field.settled_cells());
+
+    // blocking them does
+    for (int row = 0; row < 10; ++row) {
+        map.set_pos(row, 4, Map::CellType::BLOCKED);
+    }
+    ASSERT_TRUE(std::isinf(field.distance(1, 1)));
+}
+
+export class FlowFieldTests;
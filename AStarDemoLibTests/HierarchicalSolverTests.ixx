@@ -0,0 +1,124 @@
+/* HierarchicalSolverTests.ixx - unit tests for the HierarchicalSolver class
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+module;
+
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <gtest/gtest.h>
+
+export module HierarchicalSolverTests;
+
+import AStarLib;
+
+using namespace AStarLib;
+
+using namespace testing;
+
+TEST(HierarchicalSolverTests, TestStraightPath)
+{
+    Map map(40, 40);
+    HierarchicalSolver solver(map, 8);
+
+    auto path = solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 30));
+
+    ASSERT_NE(path, nullptr);
+    // the path goes through the cluster entrances, so it may be slightly longer than the optimal one
+    ASSERT_GE(path->cost(), 29.0);
+    ASSERT_LE(path->cost(), 29.0 * 1.1);
+}
+
+TEST(HierarchicalSolverTests, TestAroundWall)
+{
+    Map map(40, 40);
+    for (int row = 0; row < 30; ++row) {
+        map.set_pos(row, 20, Map::CellType::BLOCKED);
+    }
+    HierarchicalSolver solver(map, 8);
+
+    auto path = solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 38));
+    ASSERT_NE(path, nullptr);
+
+    // every step must be a single move into a free cell
+    for (auto node = path; node->get_parent() != nullptr; node = node->get_parent()) {
+        auto parent = node->get_parent();
+        ASSERT_LE(std::abs(node->row() - parent->row()), 1);
+        ASSERT_LE(std::abs(node->col() - parent->col()), 1);
+        ASSERT_NE(Map::CellType::BLOCKED, map.at(node->row(), node->col()));
+    }
+}
+
+TEST(HierarchicalSolverTests, TestNoPath)
+{
+    Map map(40, 40);
+    for (int row = 0; row < 40; ++row) {
+        map.set_pos(row, 20, Map::CellType::BLOCKED);
+    }
+    HierarchicalSolver solver(map, 8);
+
+    ASSERT_EQ(solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 38)), nullptr);
+}
+
+TEST(HierarchicalSolverTests, TestMapEdits)
+{
+    Map map(40, 40);
+    for (int row = 0; row < 40; ++row) {
+        map.set_pos(row, 20, Map::CellType::BLOCKED);
+    }
+    HierarchicalSolver solver(map, 8);
+    ASSERT_EQ(solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 38)), nullptr);
+
+    // opening a gate in the wall is picked up on the next search, without telling the solver
+    map.set_pos(35, 20, Map::CellType::FREE);
+
+    auto path = solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 38));
+    ASSERT_NE(path, nullptr);
+
+    bool gate = false;
+    for (auto node = path; node != nullptr; node = node->get_parent()) {
+        gate = gate || (node->row() == 35 && node->col() == 20);
+    }
+    ASSERT_TRUE(gate);
+
+    // and so is closing it again, with cells being visited meanwhile
+    map.visit(1, 2);
+    map.set_pos(35, 20, Map::CellType::BLOCKED);
+    ASSERT_EQ(solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 38)), nullptr);
+}
+
+TEST(HierarchicalSolverTests, TestReload)
+{
+    Map map(40, 40);
+    HierarchicalSolver solver(map, 8);
+    ASSERT_NE(solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 38)), nullptr);
+
+    // more edits than the change log holds, and then a different map altogether
+    for (std::size_t i = 0; i <= Map::change_log_capacity; ++i) {
+        map.visit(static_cast<int>(i / 40 % 40), static_cast<int>(i % 40));
+    }
+    Map wall(40, 40);
+    for (int row = 0; row < 40; ++row) {
+        wall.set_pos(row, 20, Map::CellType::BLOCKED);
+    }
+    map.load(*wall.snapshot());
+
+    ASSERT_EQ(solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 38)), nullptr);
+}
+
+export class HierarchicalSolverTests;
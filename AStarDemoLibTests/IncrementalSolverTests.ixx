@@ -0,0 +1,187 @@
+/* IncrementalSolverTests.ixx - unit tests for the IncrementalSolver class
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+module;
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+
+export module IncrementalSolverTests;
+
+import AStarLib;
+
+using namespace AStarLib;
+
+using namespace testing;
+
+namespace {
+    /**
+     * Counts the cells the search closed and expanded.
+     */
+    struct RepairCounter {
+        std::size_t closed = 0;
+        std::size_t expanded = 0;
+
+        void on_push(int, int, double) noexcept {}
+        void on_decrease_key(int, int, double) noexcept {}
+        void on_close(int, int) noexcept { ++closed; }
+        void on_expand(int, int, double) noexcept { ++expanded; }
+    };
+}
+
+TEST(IncrementalSolverTests, TestStraightPath)
+{
+    Map map(10, 10);
+    IncrementalSolver solver(map);
+
+    auto path = solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 6));
+
+    ASSERT_NE(path, nullptr);
+    ASSERT_EQ(5.0, path->cost());
+}
+
+TEST(IncrementalSolverTests, TestNoPath)
+{
+    Map map(10, 10);
+    for (int row = 0; row < 10; ++row) {
+        map.set_pos(row, 4, Map::CellType::BLOCKED);
+    }
+    IncrementalSolver solver(map);
+
+    // told apart by the map components, without searching
+    ASSERT_EQ(solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 7)), nullptr);
+    ASSERT_EQ(0u, solver.stats().expansions);
+}
+
+TEST(IncrementalSolverTests, TestReplan)
+{
+    Map map(10, 10);
+    IncrementalSolver solver(map);
+
+    auto path = solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 7));
+    ASSERT_NE(path, nullptr);
+    ASSERT_EQ(6.0, path->cost());
+
+    // a wall shows up in the way
+    std::vector<std::pair<int, int>> changed;
+    for (int row = 0; row < 7; ++row) {
+        map.set_pos(row, 4, Map::CellType::BLOCKED);
+        changed.emplace_back(row, 4);
+    }
+    solver.cells_changed(changed);
+
+    path = solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 7));
+    ASSERT_NE(path, nullptr);
+    ASSERT_EQ(15.0, path->cost());
+
+    // and a door closes the way around it
+    map.set_pos(7, 4, Map::CellType::BLOCKED);
+    map.set_pos(8, 4, Map::CellType::BLOCKED);
+    map.set_pos(9, 4, Map::CellType::BLOCKED);
+    changed = { { 7, 4 }, { 8, 4 }, { 9, 4 } };
+    solver.cells_changed(changed);
+
+    ASSERT_EQ(solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 7)), nullptr);
+
+    // until it opens again
+    map.set_pos(8, 4, Map::CellType::FREE);
+    solver.cell_changed(8, 4);
+
+    path = solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 7));
+    ASSERT_NE(path, nullptr);
+    ASSERT_EQ(17.0, path->cost());
+}
+
+TEST(IncrementalSolverTests, TestMovingStart)
+{
+    Map map(20, 20);
+    for (int row = 0; row < 15; ++row) {
+        map.set_pos(row, 10, Map::CellType::BLOCKED);
+    }
+    IncrementalSolver solver(map);
+
+    auto path = solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 18));
+    ASSERT_NE(path, nullptr);
+    const auto full = solver.stats().expansions;
+
+    // walking along the path needs no search at all
+    path = solver.find(std::make_shared<Node>(2, 2), std::make_shared<Node>(1, 18));
+    ASSERT_NE(path, nullptr);
+    ASSERT_LT(solver.stats().expansions, full);
+
+    AStarSolver reference(map.snapshot());
+    auto expected = reference.find(std::make_shared<Node>(2, 2), std::make_shared<Node>(1, 18));
+    ASSERT_EQ(expected->cost(), path->cost());
+}
+
+TEST(IncrementalSolverTests, TestObserver)
+{
+    Map map(20, 20);
+    IncrementalSolver solver(map);
+
+    RepairCounter full;
+    ASSERT_NE(solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 18), full), nullptr);
+    ASSERT_GT(full.closed, 0u);
+    ASSERT_EQ(full.closed, full.expanded);
+
+    // nothing changed, nothing to repair
+    RepairCounter again;
+    ASSERT_NE(solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 18), again), nullptr);
+    ASSERT_EQ(0u, again.closed);
+
+    // only the cells around the edit are seen again
+    map.set_pos(1, 10, Map::CellType::BLOCKED);
+    solver.cell_changed(1, 10);
+    RepairCounter repair;
+    ASSERT_NE(solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 18), repair), nullptr);
+    ASSERT_GT(repair.closed, 0u);
+    ASSERT_EQ(solver.stats().expansions, repair.closed);
+}
+
+TEST(IncrementalSolverTests, TestUnreportedEdits)
+{
+    Map map(10, 10);
+    IncrementalSolver solver(map);
+    ASSERT_NE(solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 7)), nullptr);
+
+    // found on the map change log, without reporting them
+    for (int row = 0; row < 7; ++row) {
+        map.set_pos(row, 4, Map::CellType::BLOCKED);
+    }
+    auto path = solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 7));
+    ASSERT_NE(path, nullptr);
+    ASSERT_EQ(15.0, path->cost());
+
+    // a map of the same size loaded over it can't be repaired, it is searched again
+    Map wall(10, 10);
+    for (int row = 0; row < 10; ++row) {
+        wall.set_pos(row, 4, Map::CellType::BLOCKED);
+    }
+    map.load(*wall.snapshot());
+    ASSERT_EQ(solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 7)), nullptr);
+
+    map.load(*Map(10, 10).snapshot());
+    path = solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 7));
+    ASSERT_NE(path, nullptr);
+    ASSERT_EQ(6.0, path->cost());
+}
+
+export class IncrementalSolverTests;
@@ -0,0 +1,172 @@
+/* JumpPointSolverTests.ixx - unit tests for the JumpPointSolver class
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+module;
+
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <gtest/gtest.h>
+
+export module JumpPointSolverTests;
+
+import AStarLib;
+
+using namespace AStarLib;
+
+using namespace testing;
+
+namespace {
+    /**
+     * Blocks random cells. With isolated set, no two blocked cells touch, not even
+     * diagonally, so every one of them forces neighbours and gets squeezed past diagonally.
+     */
+    void add_jump_point_blocks(Map& map, unsigned seed, double density, bool isolated)
+    {
+        std::mt19937 random(seed);
+        std::bernoulli_distribution wall(density);
+        for (int row = 0; row < map.rows(); ++row) {
+            for (int col = 0; col < map.columns(); ++col) {
+                if (!wall(random)) {
+                    continue;
+                }
+
+                bool alone = true;
+                for (int dr = -1; dr <= 1 && isolated; ++dr) {
+                    for (int dc = -1; dc <= 1; ++dc) {
+                        const int next_row = row + dr, next_col = col + dc;
+                        if (next_row >= 0 && next_row < map.rows() && next_col >= 0 && next_col < map.columns() &&
+                            !map.passable(next_row, next_col)) {
+                            alone = false;
+                        }
+                    }
+                }
+                if (alone) {
+                    map.set_pos(row, col, Map::CellType::BLOCKED);
+                }
+            }
+        }
+    }
+}
+
+TEST(JumpPointSolverTests, TestSameCostAsAStar)
+{
+    Map map(20, 20);
+    for (int row = 0; row < 15; ++row) {
+        map.set_pos(row, 6, Map::CellType::BLOCKED);
+        map.set_pos(19 - row, 13, Map::CellType::BLOCKED);
+    }
+
+    AStarSolver astar(map.snapshot());
+    JumpPointSolver jps(map.snapshot());
+
+    auto expected = astar.find(std::make_shared<Node>(0, 0), std::make_shared<Node>(0, 19));
+    auto path = jps.find(std::make_shared<Node>(0, 0), std::make_shared<Node>(0, 19));
+
+    ASSERT_NE(expected, nullptr);
+    ASSERT_NE(path, nullptr);
+    ASSERT_EQ(expected->cost(), path->cost());
+}
+
+TEST(JumpPointSolverTests, TestMatchesAStarOnRandomMaps)
+{
+    struct Layout {
+        double density;
+        bool isolated;
+    };
+    const Layout layouts[] = { { 0.2, true }, { 0.1, false }, { 0.25, false } };
+
+    for (const auto& layout : layouts) {
+        for (unsigned seed = 1; seed <= 4; ++seed) {
+            Map map(40, 37);
+            add_jump_point_blocks(map, seed, layout.density, layout.isolated);
+
+            const auto snapshot = map.snapshot();
+            AStarSolver reference(snapshot);
+            JumpPointSolver solver(snapshot);
+
+            std::mt19937 random(seed * 31);
+            std::uniform_int_distribution<int> rows(0, map.rows() - 1);
+            std::uniform_int_distribution<int> cols(0, map.columns() - 1);
+            for (int query = 0; query < 60; ++query) {
+                const int start_row = rows(random), start_col = cols(random);
+                const int goal_row = rows(random), goal_col = cols(random);
+                if (!map.passable(start_row, start_col) || !map.passable(goal_row, goal_col)) {
+                    continue;
+                }
+
+                auto expected = reference.find(std::make_shared<Node>(start_row, start_col), std::make_shared<Node>(goal_row, goal_col));
+                auto path = solver.find(std::make_shared<Node>(start_row, start_col), std::make_shared<Node>(goal_row, goal_col));
+                ASSERT_EQ(expected == nullptr, path == nullptr) << layout.density << ", " << seed << ", " << query;
+                if (expected == nullptr) {
+                    continue;
+                }
+                ASSERT_DOUBLE_EQ(expected->cost(), path->cost()) << layout.density << ", " << seed << ", " << query;
+
+                // the jumps are filled in with every cell between them
+                ASSERT_EQ(goal_row, path->row());
+                ASSERT_EQ(goal_col, path->col());
+                auto node = path;
+                for (; node->get_parent() != nullptr; node = node->get_parent()) {
+                    const auto parent = node->get_parent();
+                    ASSERT_TRUE(map.passable(node->row(), node->col()));
+                    ASSERT_LE(std::abs(node->row() - parent->row()), 1);
+                    ASSERT_LE(std::abs(node->col() - parent->col()), 1);
+                }
+                ASSERT_EQ(start_row, node->row());
+                ASSERT_EQ(start_col, node->col());
+            }
+        }
+    }
+}
+
+TEST(JumpPointSolverTests, TestPathIsContiguous)
+{
+    Map map(20, 20);
+    for (int row = 2; row < 20; ++row) {
+        map.set_pos(row, 10, Map::CellType::BLOCKED);
+    }
+    JumpPointSolver solver(map);
+
+    auto path = solver.find(std::make_shared<Node>(18, 2), std::make_shared<Node>(18, 18));
+    ASSERT_NE(path, nullptr);
+    ASSERT_EQ(18, path->row());
+    ASSERT_EQ(18, path->col());
+
+    for (auto node = path; node->get_parent() != nullptr; node = node->get_parent()) {
+        auto parent = node->get_parent();
+        ASSERT_LE(std::abs(node->row() - parent->row()), 1);
+        ASSERT_LE(std::abs(node->col() - parent->col()), 1);
+        ASSERT_NE(Map::CellType::BLOCKED, map.at(node->row(), node->col()));
+    }
+}
+
+TEST(JumpPointSolverTests, TestNoPath)
+{
+    Map map(10, 10);
+    for (int col = 0; col < 10; ++col) {
+        map.set_pos(5, col, Map::CellType::BLOCKED);
+    }
+    JumpPointSolver solver(map);
+
+    // told apart by the map components, without searching
+    ASSERT_EQ(solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(8, 8)), nullptr);
+    ASSERT_EQ(0u, solver.stats().expansions);
+}
+
+export class JumpPointSolverTests;
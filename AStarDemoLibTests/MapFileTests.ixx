@@ -0,0 +1,175 @@
+/* MapFileTests.ixx - unit tests for the binary map format
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+module;
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <string>
+#include <gtest/gtest.h>
+
+export module MapFileTests;
+
+import AStarLib;
+
+using namespace AStarLib;
+
+using namespace testing;
+
+namespace {
+    const wchar_t* text_map =
+        L"AStarv20\n"
+        L"32 32 tiles.png\n"
+        L"4 6\n"
+        L"..*..\n"
+        L".**..\n"
+        L".....\n"
+        L"*....\n";
+
+    std::filesystem::path temp_file(const char* name)
+    {
+        return std::filesystem::temp_directory_path() / name;
+    }
+}
+
+TEST(MapFileTests, TestRoundTrip)
+{
+    const auto path = temp_file("MapFileTests_round_trip.amap");
+    {
+        std::wistringstream text(text_map);
+        std::ofstream binary(path, std::ios::binary | std::ios::trunc);
+        ASSERT_TRUE(convert_text_map(text, binary));
+    }
+
+    std::wistringstream text(text_map);
+    Map expected;
+    ASSERT_TRUE(expected.load(text));
+
+    auto file = BinaryMap::open(path);
+    ASSERT_NE(file, nullptr);
+    ASSERT_EQ(4, file->rows());
+    ASSERT_EQ(6, file->columns());
+    ASSERT_EQ(32, file->tilesWidth());
+    ASSERT_EQ(L"tiles.png", file->tilesetFilename());
+
+    Map map;
+    file->load(map);
+    auto snapshot = file->snapshot();
+    ASSERT_EQ(expected.rows(), map.rows());
+    ASSERT_EQ(expected.columns(), map.columns());
+    ASSERT_EQ(expected.tilesetFilename(), map.tilesetFilename());
+
+    for (int row = -1; row <= expected.rows(); ++row) {
+        for (int col = -1; col <= expected.columns(); ++col) {
+            ASSERT_EQ(expected.passable(row, col), map.passable(row, col));
+            ASSERT_EQ(expected.passable(row, col), snapshot->passable(row, col));
+        }
+    }
+    ASSERT_EQ(Map::CellType::BLOCKED, map.at(1, 2));
+    ASSERT_EQ(Map::CellType::FREE, snapshot->at(2, 2));
+
+    // the masks are only computed once, later calls share the same snapshot
+    ASSERT_EQ(snapshot.get(), file->snapshot().get());
+
+    // the loaded map can be edited and searched as usual
+    map.set_pos(2, 2, Map::CellType::BLOCKED);
+    ASSERT_FALSE(map.passable(2, 2));
+    ASSERT_TRUE(snapshot->passable(2, 2));
+
+    file.reset();
+    snapshot.reset();
+    std::filesystem::remove(path);
+}
+
+TEST(MapFileTests, TestSnapshotSearch)
+{
+    const auto path = temp_file("MapFileTests_search.amap");
+    {
+        Map map(10, 10);
+        for (int row = 0; row < 7; ++row) {
+            map.set_pos(row, 4, Map::CellType::BLOCKED);
+        }
+        std::ofstream binary(path, std::ios::binary | std::ios::trunc);
+        ASSERT_TRUE(save_binary_map(map, binary));
+    }
+
+    {
+        // the snapshot keeps the file mapped on its own
+        AStarSolver solver(BinaryMap::open(path)->snapshot());
+        auto path_found = solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 7));
+        ASSERT_NE(path_found, nullptr);
+        ASSERT_EQ(15.0, path_found->cost());
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST(MapFileTests, TestBlocks)
+{
+    const auto path = temp_file("MapFileTests_blocks.amap");
+    const std::byte payload[] = { std::byte{ 1 }, std::byte{ 2 }, std::byte{ 3 } };
+    {
+        Map map(3, 3);
+        const MapBlock blocks[] = { { block_tag("TEST"), payload } };
+        std::ofstream binary(path, std::ios::binary | std::ios::trunc);
+        ASSERT_TRUE(save_binary_map(map, binary, blocks));
+    }
+
+    auto file = BinaryMap::open(path);
+    ASSERT_NE(file, nullptr);
+    const auto data = file->block(block_tag("TEST"));
+    ASSERT_EQ(3u, data.size());
+    ASSERT_EQ(std::byte{ 3 }, data[2]);
+    ASSERT_TRUE(file->block(block_tag("NONE")).empty());
+
+    file.reset();
+    std::filesystem::remove(path);
+}
+
+TEST(MapFileTests, TestInvalidFiles)
+{
+    ASSERT_EQ(nullptr, BinaryMap::open(temp_file("MapFileTests_missing.amap")));
+
+    const auto path = temp_file("MapFileTests_invalid.amap");
+    {
+        // a text map is not a binary one
+        std::ofstream binary(path, std::ios::binary | std::ios::trunc);
+        binary << "AStarv20\n32 32 tiles.png\n1 1\n.\n";
+    }
+    ASSERT_EQ(nullptr, BinaryMap::open(path));
+
+    {
+        // truncated plane
+        Map map(64, 64);
+        std::ostringstream buffer(std::ios::binary);
+        ASSERT_TRUE(save_binary_map(map, buffer));
+        const auto contents = buffer.str();
+
+        std::ofstream binary(path, std::ios::binary | std::ios::trunc);
+        binary.write(contents.data(), 200);
+    }
+    ASSERT_EQ(nullptr, BinaryMap::open(path));
+
+    std::filesystem::remove(path);
+}
+
+export class MapFileTests;
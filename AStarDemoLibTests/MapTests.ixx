@@ -18,7 +18,13 @@
  */
 module;
 
+#include <cstdint>
 #include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
 #include <gtest/gtest.h>
 
 export module MapTests;
@@ -29,6 +35,33 @@ using namespace AStarLib;
 
 using namespace testing;
 
+namespace {
+    /**
+     * The neighbour mask of a cell worked out from passable(), one neighbour at a time.
+     */
+    template<typename Grid>
+    std::uint8_t expected_neighbours(const Grid& grid, int row, int col)
+    {
+        std::uint8_t mask = 0;
+        for (int bit = 0; bit < 8; ++bit) {
+            if (grid.passable(row + NeighbourMask::row_offset[bit], col + NeighbourMask::col_offset[bit])) {
+                mask |= 1 << bit;
+            }
+        }
+        return mask;
+    }
+
+    template<typename Grid>
+    void expect_neighbours(const Grid& grid)
+    {
+        for (int row = 0; row < grid.rows(); ++row) {
+            for (int col = 0; col < grid.columns(); ++col) {
+                ASSERT_EQ(expected_neighbours(grid, row, col), grid.neighbours(row, col)) << row << ", " << col;
+            }
+        }
+    }
+}
+
 TEST(MapTests, TestConstructor)
 {
     Map map;
@@ -55,4 +88,188 @@ TEST(MapTests, TestAddPath)
     ASSERT_EQ(map.at(endNode->row(), endNode->col()), Map::CellType::END);
 }
 
+TEST(MapTests, TestPassable)
+{
+    Map map(5, 8);
+
+    map.set_pos(2, 3, Map::CellType::BLOCKED);
+    map.set_pos(4, 7, Map::CellType::START);
+
+    ASSERT_FALSE(map.passable(2, 3));
+    ASSERT_TRUE(map.passable(4, 7));
+    ASSERT_TRUE(map.passable(0, 0));
+
+    map.set_pos(2, 3, Map::CellType::FREE);
+    ASSERT_TRUE(map.passable(2, 3));
+
+    map.clear();
+    ASSERT_TRUE(map.passable(4, 7));
+}
+
+TEST(MapTests, TestBorder)
+{
+    Map map(5, 8);
+
+    for (int col = -1; col <= map.columns(); ++col) {
+        ASSERT_FALSE(map.passable(-1, col));
+        ASSERT_FALSE(map.passable(map.rows(), col));
+    }
+    for (int row = -1; row <= map.rows(); ++row) {
+        ASSERT_FALSE(map.passable(row, -1));
+        ASSERT_FALSE(map.passable(row, map.columns()));
+    }
+
+    ASSERT_THROW(map.at(5, 0), std::out_of_range);
+    ASSERT_THROW(map.set_pos(0, -1, Map::CellType::BLOCKED), std::out_of_range);
+}
+
+TEST(MapTests, TestLoad)
+{
+    std::wistringstream buffer(L"AStarv20\n16 16 Tiles.png\n3 5\n..*.\n*...\n....\n");
+    Map map;
+
+    ASSERT_TRUE(map.load(buffer));
+    ASSERT_EQ(3, map.rows());
+    ASSERT_EQ(5, map.columns());
+    ASSERT_EQ(16, map.tilesWidth());
+
+    ASSERT_EQ(Map::CellType::BLOCKED, map.at(0, 2));
+    ASSERT_EQ(Map::CellType::BLOCKED, map.at(1, 0));
+    ASSERT_EQ(Map::CellType::FREE, map.at(2, 3));
+    ASSERT_FALSE(map.passable(0, 2));
+    ASSERT_TRUE(map.passable(0, 3));
+}
+
+TEST(MapTests, TestSnapshot)
+{
+    Map map(5, 8);
+    map.set_pos(2, 3, Map::CellType::BLOCKED);
+
+    auto snapshot = map.snapshot();
+    ASSERT_EQ(5, snapshot->rows());
+    ASSERT_EQ(8, snapshot->columns());
+    ASSERT_EQ(Map::CellType::BLOCKED, snapshot->at(2, 3));
+    ASSERT_FALSE(snapshot->passable(2, 3));
+    ASSERT_FALSE(snapshot->passable(-1, 0));
+
+    // nothing changed, so the same snapshot is handed out
+    ASSERT_EQ(snapshot, map.snapshot());
+
+    // later edits don't affect the snapshots already taken
+    map.set_pos(2, 3, Map::CellType::FREE);
+    ASSERT_FALSE(snapshot->passable(2, 3));
+
+    auto updated = map.snapshot();
+    ASSERT_NE(snapshot, updated);
+    ASSERT_LT(snapshot->version(), updated->version());
+    ASSERT_TRUE(updated->passable(2, 3));
+}
+
+TEST(MapTests, TestNeighbourMasks)
+{
+    // odd sizes, so that the rows start in the middle of the plane words
+    Map map(37, 70);
+    std::mt19937 random(7);
+    std::bernoulli_distribution wall(0.3);
+    for (int row = 0; row < map.rows(); ++row) {
+        for (int col = 0; col < map.columns(); ++col) {
+            if (wall(random)) {
+                map.set_pos(row, col, Map::CellType::BLOCKED);
+            }
+        }
+    }
+    expect_neighbours(map);
+
+    auto snapshot = map.snapshot();
+    expect_neighbours(*snapshot);
+
+    // unblocking and blocking again only touches the masks around the cell
+    map.set_pos(0, 0, Map::CellType::FREE);
+    map.set_pos(10, 10, Map::CellType::BLOCKED);
+    map.set_pos(10, 10, Map::CellType::FREE);
+    map.set_pos(36, 69, Map::CellType::BLOCKED);
+    expect_neighbours(map);
+    expect_neighbours(*map.snapshot());
+
+    Map copy;
+    copy.load(*MapSnapshot::from_plane(snapshot->rows(), snapshot->columns(), snapshot->plane().data(), snapshot));
+    expect_neighbours(copy);
+    ASSERT_EQ(snapshot->neighbours(5, 5), copy.neighbours(5, 5));
+
+    map.clear();
+    expect_neighbours(map);
+    ASSERT_EQ(0xff, map.neighbours(1, 1));
+    ASSERT_EQ(NeighbourMask::RIGHT | NeighbourMask::DOWN | NeighbourMask::DOWN_RIGHT, map.neighbours(0, 0));
+}
+
+TEST(MapTests, TestCornerCutting)
+{
+    const std::uint8_t mask = NeighbourMask::UP | NeighbourMask::UP_LEFT | NeighbourMask::UP_RIGHT | NeighbourMask::RIGHT | NeighbourMask::DOWN_RIGHT;
+
+    ASSERT_EQ(NeighbourMask::UP | NeighbourMask::UP_RIGHT | NeighbourMask::RIGHT, NeighbourMask::without_corner_cutting(mask));
+    ASSERT_EQ(0xff, NeighbourMask::without_corner_cutting(0xff));
+    ASSERT_EQ(0, NeighbourMask::without_corner_cutting(NeighbourMask::DIAGONAL));
+}
+
+TEST(MapTests, TestChangesSince)
+{
+    Map map(10, 10);
+    std::vector<std::pair<int, int>> cells;
+
+    const auto before = map.changes_since(0, cells);
+    ASSERT_FALSE(before.everything);
+    ASSERT_TRUE(cells.empty());
+
+    map.set_pos(2, 3, Map::CellType::BLOCKED);
+    map.visit(5, 5);
+    map.set_pos(2, 3, Map::CellType::FREE);
+
+    // each cell only once, no matter how often it changed
+    auto changes = map.changes_since(before.version, cells);
+    ASSERT_FALSE(changes.everything);
+    ASSERT_EQ(map.version(), changes.version);
+    ASSERT_EQ((std::vector<std::pair<int, int>>{ { 2, 3 }, { 5, 5 } }), cells);
+
+    // only what changed after the version given
+    Path path({ { 7, 1 }, { 7, 2 }, { 8, 3 } }, 2.5);
+    map.add_path(path);
+    changes = map.changes_since(changes.version, cells);
+    ASSERT_FALSE(changes.everything);
+    ASSERT_EQ((std::vector<std::pair<int, int>>{ { 7, 1 }, { 7, 2 }, { 8, 3 } }), cells);
+
+    changes = map.changes_since(changes.version, cells);
+    ASSERT_FALSE(changes.everything);
+    ASSERT_TRUE(cells.empty());
+
+    // replacing the whole map can't be described cell by cell
+    map.clear();
+    changes = map.changes_since(changes.version, cells);
+    ASSERT_TRUE(changes.everything);
+    ASSERT_TRUE(cells.empty());
+    ASSERT_FALSE(map.changes_since(changes.version, cells).everything);
+}
+
+TEST(MapTests, TestChangeLogOverflow)
+{
+    Map map(200, 200);
+    std::vector<std::pair<int, int>> cells;
+
+    const auto start = map.changes_since(0, cells);
+    for (std::size_t i = 0; i < Map::change_log_capacity; ++i) {
+        map.visit(static_cast<int>(i / 200), static_cast<int>(i % 200));
+    }
+    const auto full = map.changes_since(start.version, cells);
+    ASSERT_FALSE(full.everything);
+    ASSERT_EQ(Map::change_log_capacity, cells.size());
+
+    // the oldest change is gone from the log, the ones after it are still there
+    map.visit(199, 199);
+    ASSERT_TRUE(map.changes_since(start.version, cells).everything);
+
+    const auto recent = map.changes_since(full.version - 1, cells);
+    ASSERT_FALSE(recent.everything);
+    ASSERT_EQ(2u, cells.size());
+    ASSERT_EQ(std::make_pair(199, 199), cells.back());
+}
+
 export class MapTests;
\ No newline at end of file
@@ -0,0 +1,226 @@
+/* OpenListTests.ixx - unit tests for the IndexedHeap class
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+module;
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <gtest/gtest.h>
+
+export module OpenListTests;
+
+import AStarLib;
+
+using namespace AStarLib;
+
+using namespace testing;
+
+TEST(OpenListTests, TestConstructor)
+{
+    IndexedHeap heap(10);
+
+    ASSERT_TRUE(heap.empty());
+    ASSERT_EQ(10u, heap.capacity());
+    ASSERT_FALSE(heap.contains(3));
+}
+
+TEST(OpenListTests, TestPopOrder)
+{
+    IndexedHeap heap(10);
+
+    heap.push(4, 7.0);
+    heap.push(1, 2.0);
+    heap.push(9, 5.5);
+    heap.push(0, 3.0);
+    heap.push(6, 1.0);
+
+    ASSERT_EQ(5u, heap.size());
+    ASSERT_TRUE(heap.contains(9));
+
+    ASSERT_EQ(6u, heap.pop());
+    ASSERT_EQ(1u, heap.pop());
+    ASSERT_EQ(0u, heap.pop());
+    ASSERT_EQ(9u, heap.pop());
+    ASSERT_EQ(4u, heap.pop());
+
+    ASSERT_TRUE(heap.empty());
+    ASSERT_FALSE(heap.contains(9));
+}
+
+TEST(OpenListTests, TestDecreaseKey)
+{
+    IndexedHeap heap(10);
+
+    heap.push(2, 4.0);
+    heap.push(3, 5.0);
+    heap.push(8, 6.0);
+
+    heap.decrease_key(8, 1.0);
+
+    ASSERT_EQ(1.0, heap.key(8));
+    ASSERT_EQ(8u, heap.top());
+    ASSERT_EQ(8u, heap.pop());
+    ASSERT_EQ(2u, heap.pop());
+}
+
+TEST(OpenListTests, TestClear)
+{
+    IndexedHeap heap(10);
+
+    heap.push(2, 4.0);
+    heap.push(5, 1.0);
+    heap.clear();
+
+    ASSERT_TRUE(heap.empty());
+    ASSERT_FALSE(heap.contains(2));
+    ASSERT_FALSE(heap.contains(5));
+
+    heap.push(5, 3.0);
+    ASSERT_EQ(5u, heap.top());
+}
+
+TEST(OpenListTests, TestUpdate)
+{
+    IndexedHeap heap(10);
+
+    heap.push(2, 4.0);
+    heap.push(3, 5.0);
+    heap.push(8, 6.0);
+
+    heap.update(2, 9.0);
+    heap.update(8, 0.5);
+
+    ASSERT_EQ(8u, heap.pop());
+    ASSERT_EQ(3u, heap.pop());
+    ASSERT_EQ(2u, heap.pop());
+}
+
+TEST(OpenListTests, TestRemove)
+{
+    IndexedHeap heap(10);
+
+    for (int i = 0; i < 10; ++i) {
+        heap.push(i, 10.0 - i);
+    }
+    heap.remove(9);
+    heap.remove(4);
+
+    ASSERT_EQ(8u, heap.size());
+    ASSERT_FALSE(heap.contains(4));
+
+    ASSERT_EQ(8u, heap.pop());
+    ASSERT_EQ(7u, heap.pop());
+    ASSERT_EQ(6u, heap.pop());
+    ASSERT_EQ(5u, heap.pop());
+    ASSERT_EQ(3u, heap.pop());
+}
+
+TEST(OpenListTests, TestPairKeys)
+{
+    BasicIndexedHeap<std::pair<double, double>> heap(10);
+
+    heap.push(1, { 2.0, 3.0 });
+    heap.push(2, { 2.0, 1.0 });
+    heap.push(3, { 1.0, 5.0 });
+
+    ASSERT_EQ(3u, heap.pop());
+    ASSERT_EQ(2u, heap.pop());
+    ASSERT_EQ(1u, heap.pop());
+}
+
+TEST(OpenListTests, TestBucketPopOrder)
+{
+    BucketQueue queue(10);
+
+    queue.push(4, 107);
+    queue.push(1, 102);
+    queue.push(9, 105);
+    queue.push(0, 103);
+    queue.push(6, 101);
+    queue.push(3, 103);
+
+    ASSERT_EQ(6u, queue.size());
+    ASSERT_EQ(105u, queue.key(9));
+
+    ASSERT_EQ(6u, queue.pop());
+    ASSERT_EQ(1u, queue.pop());
+
+    // equal priorities come out last in, first out
+    ASSERT_EQ(3u, queue.pop());
+    ASSERT_EQ(0u, queue.pop());
+    ASSERT_EQ(9u, queue.pop());
+    ASSERT_EQ(4u, queue.pop());
+
+    ASSERT_TRUE(queue.empty());
+    ASSERT_FALSE(queue.contains(9));
+}
+
+TEST(OpenListTests, TestBucketDecreaseKey)
+{
+    BucketQueue queue(10);
+
+    queue.push(2, 4);
+    queue.push(3, 5);
+    queue.push(8, 6);
+
+    queue.decrease_key(8, 1);
+    queue.remove(2);
+
+    // the outdated entries are skipped
+    ASSERT_EQ(2u, queue.size());
+    ASSERT_EQ(1u, queue.key(8));
+    ASSERT_EQ(8u, queue.pop());
+    ASSERT_EQ(3u, queue.pop());
+    ASSERT_TRUE(queue.empty());
+
+    // and a new round starts anywhere
+    queue.push(2, 1000);
+    ASSERT_EQ(2u, queue.pop());
+}
+
+TEST(OpenListTests, TestBucketMatchesHeap)
+{
+    constexpr std::size_t cells = 1000;
+    IndexedHeap heap(cells);
+    BucketQueue queue(cells);
+    std::mt19937 random(7);
+
+    // priorities spread far wider than the initial ring, in no particular order
+    for (std::size_t index = 0; index < cells; ++index) {
+        const auto key = static_cast<std::uint32_t>(random() % 5000);
+        heap.push(index, key);
+        queue.push(index, key);
+    }
+    for (std::size_t index = 0; index < cells; index += 3) {
+        const auto key = static_cast<std::uint32_t>(heap.key(index) / 2);
+        heap.decrease_key(index, key);
+        queue.decrease_key(index, key);
+    }
+
+    while (!heap.empty()) {
+        const auto expected = heap.key(heap.top());
+        const auto index = queue.pop();
+        ASSERT_EQ(expected, heap.key(index));
+        heap.remove(index);
+    }
+    ASSERT_TRUE(queue.empty());
+}
+
+export class OpenListTests;
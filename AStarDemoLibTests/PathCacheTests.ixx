@@ -0,0 +1,170 @@
+/* PathCacheTests.ixx - unit tests for the PathCache class
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+module;
+
+#include <memory>
+#include <gtest/gtest.h>
+
+export module PathCacheTests;
+
+import AStarLib;
+
+using namespace AStarLib;
+
+using namespace testing;
+
+TEST(PathCacheTests, TestHitAndMiss)
+{
+    Map map(10, 10);
+    AStarSolver solver(map.snapshot());
+    PathCache cache(map);
+
+    auto first = cache.find(solver, std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 6));
+    auto second = cache.find(solver, std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 6));
+
+    ASSERT_NE(first, nullptr);
+    ASSERT_EQ(first, second);
+    ASSERT_EQ(1u, cache.hits());
+    ASSERT_EQ(1u, cache.misses());
+    ASSERT_EQ(1u, cache.size());
+}
+
+TEST(PathCacheTests, TestOverlappingQueries)
+{
+    Map map(10, 10);
+    AStarSolver solver(map.snapshot());
+    PathCache cache(map);
+
+    cache.find(solver, std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 8));
+
+    // the same start, with the goal along the way
+    auto prefix = cache.lookup(1, 1, 1, 4);
+    ASSERT_TRUE(prefix.has_value());
+    ASSERT_EQ(3.0, (*prefix)->cost());
+
+    // the same goal, starting from along the way
+    auto suffix = cache.lookup(1, 5, 1, 8);
+    ASSERT_TRUE(suffix.has_value());
+    ASSERT_EQ(3.0, (*suffix)->cost());
+    ASSERT_EQ(1, (*suffix)->row());
+    ASSERT_EQ(8, (*suffix)->col());
+
+    int length = 0;
+    for (auto node = *suffix; node != nullptr; node = node->get_parent()) {
+        ++length;
+    }
+    ASSERT_EQ(4, length);
+
+    ASSERT_FALSE(cache.lookup(2, 1, 1, 8).has_value());
+}
+
+TEST(PathCacheTests, TestRegionInvalidation)
+{
+    Map map(20, 20);
+    AStarSolver solver(map.snapshot());
+    PathCache cache(map);
+
+    cache.find(solver, std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 10));
+    cache.find(solver, std::make_shared<Node>(15, 1), std::make_shared<Node>(15, 10));
+    ASSERT_EQ(2u, cache.size());
+
+    // only the path going through the blocked cell is dropped
+    map.set_pos(1, 5, Map::CellType::BLOCKED);
+
+    ASSERT_FALSE(cache.lookup(1, 1, 1, 10).has_value());
+    ASSERT_EQ(1u, cache.size());
+    ASSERT_TRUE(cache.lookup(15, 1, 15, 10).has_value());
+
+    // unblocking it can only shorten paths close enough to it
+    map.set_pos(1, 5, Map::CellType::FREE);
+    ASSERT_TRUE(cache.lookup(15, 1, 15, 10).has_value());
+}
+
+TEST(PathCacheTests, TestSeveralEdits)
+{
+    Map map(20, 20);
+    AStarSolver solver(map.snapshot());
+    PathCache cache(map);
+
+    cache.find(solver, std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 10));
+    cache.find(solver, std::make_shared<Node>(15, 1), std::make_shared<Node>(15, 10));
+
+    // a far away edit next to one on the path, both are caught up with at once
+    map.set_pos(10, 18, Map::CellType::BLOCKED);
+    map.set_pos(1, 5, Map::CellType::BLOCKED);
+
+    ASSERT_FALSE(cache.lookup(1, 1, 1, 10).has_value());
+    ASSERT_TRUE(cache.lookup(15, 1, 15, 10).has_value());
+}
+
+TEST(PathCacheTests, TestLogOverflow)
+{
+    Map map(200, 200);
+    AStarSolver solver(map.snapshot());
+    PathCache cache(map);
+
+    cache.find(solver, std::make_shared<Node>(150, 1), std::make_shared<Node>(150, 10));
+
+    // more edits than the map remembers, whatever they touched is unknown
+    for (std::size_t cell = 0; cell <= Map::change_log_capacity; ++cell) {
+        map.set_pos(static_cast<int>(cell / 200), static_cast<int>(cell % 200), Map::CellType::BLOCKED);
+    }
+
+    ASSERT_FALSE(cache.lookup(150, 1, 150, 10).has_value());
+    ASSERT_EQ(0u, cache.size());
+}
+
+TEST(PathCacheTests, TestNoPath)
+{
+    Map map(10, 10);
+    for (int row = 0; row < 10; ++row) {
+        map.set_pos(row, 4, Map::CellType::BLOCKED);
+    }
+    AStarSolver solver(map);
+    PathCache cache(map);
+
+    ASSERT_EQ(cache.find(solver, std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 7)), nullptr);
+
+    auto cached = cache.lookup(1, 1, 1, 7);
+    ASSERT_TRUE(cached.has_value());
+    ASSERT_EQ(*cached, nullptr);
+
+    // opening a door anywhere may connect them
+    map.set_pos(9, 4, Map::CellType::FREE);
+    ASSERT_FALSE(cache.lookup(1, 1, 1, 7).has_value());
+}
+
+TEST(PathCacheTests, TestLeastRecentlyUsed)
+{
+    Map map(10, 10);
+    AStarSolver solver(map.snapshot());
+    PathCache cache(map, 2);
+
+    cache.find(solver, std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 2));
+    cache.find(solver, std::make_shared<Node>(2, 1), std::make_shared<Node>(2, 2));
+    cache.lookup(1, 1, 1, 2);
+    cache.find(solver, std::make_shared<Node>(3, 1), std::make_shared<Node>(3, 2));
+
+    ASSERT_EQ(2u, cache.size());
+    ASSERT_TRUE(cache.lookup(1, 1, 1, 2).has_value());
+    ASSERT_FALSE(cache.lookup(2, 1, 2, 2).has_value());
+    ASSERT_TRUE(cache.lookup(3, 1, 3, 2).has_value());
+}
+
+export class PathCacheTests;
@@ -0,0 +1,97 @@
+/* PathTests.ixx - Unit tests for the compact paths
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+module;
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <gtest/gtest.h>
+
+export module PathTests;
+
+import AStarLib;
+
+using namespace AStarLib;
+
+using namespace testing;
+
+TEST(PathTests, TestEmpty)
+{
+    Path path;
+    ASSERT_TRUE(path.empty());
+    ASSERT_TRUE(path.waypoints().empty());
+    ASSERT_TRUE(path.expanded().empty());
+    ASSERT_TRUE(Path::from_nodes(nullptr).empty());
+}
+
+TEST(PathTests, TestWaypoints)
+{
+    // right, then diagonally down and right, then down
+    Path path({ { 0, 0 }, { 0, 1 }, { 0, 2 }, { 1, 3 }, { 2, 4 }, { 3, 4 }, { 4, 4 } }, 8.0);
+
+    auto waypoints = path.waypoints();
+    ASSERT_EQ(4u, waypoints.size());
+    ASSERT_EQ((PathPoint{ 0, 0 }), waypoints[0]);
+    ASSERT_EQ((PathPoint{ 0, 2 }), waypoints[1]);
+    ASSERT_EQ((PathPoint{ 2, 4 }), waypoints[2]);
+    ASSERT_EQ((PathPoint{ 4, 4 }), waypoints[3]);
+    ASSERT_EQ(8.0, waypoints.cost());
+
+    auto expanded = waypoints.expanded();
+    ASSERT_TRUE(std::equal(path.begin(), path.end(), expanded.begin(), expanded.end()));
+    ASSERT_EQ(8.0, expanded.cost());
+}
+
+TEST(PathTests, TestFromNodes)
+{
+    auto start = std::make_shared<Node>(1, 1);
+    auto middle = std::make_shared<Node>(1, 2);
+    auto end = std::make_shared<Node>(2, 3);
+    middle->set_parent(start);
+    end->set_parent(middle);
+    end->set_cost(2.5);
+
+    auto path = Path::from_nodes(end.get());
+    ASSERT_EQ(3u, path.size());
+    ASSERT_EQ((PathPoint{ 1, 1 }), path.front());
+    ASSERT_EQ((PathPoint{ 2, 3 }), path.back());
+    ASSERT_EQ(2.5, path.cost());
+}
+
+TEST(PathTests, TestLongChain)
+{
+    // a chain this long would overflow the stack if each node released the next one
+    auto end = std::make_shared<Node>(0, 0);
+    for (int i = 1; i < 1'000'000; ++i) {
+        auto node = std::make_shared<Node>(0, i);
+        node->set_parent(std::move(end));
+        end = std::move(node);
+    }
+
+    // parents still held somewhere else stay alive
+    auto middle = end;
+    for (int i = 0; i < 500'000; ++i) {
+        middle = middle->get_parent();
+    }
+    end = nullptr;
+    ASSERT_EQ(499'999, middle->col());
+    ASSERT_EQ(500'000u, Path::from_nodes(middle.get()).size());
+}
+
+export class PathTests;
@@ -0,0 +1,139 @@
+/* SearchObserverTests.ixx - unit tests for the search observers and statistics
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+module;
+
+#include <cstddef>
+#include <memory>
+#include <gtest/gtest.h>
+
+export module SearchObserverTests;
+
+import AStarLib;
+
+using namespace AStarLib;
+
+using namespace testing;
+
+namespace {
+    struct CountingObserver {
+        std::size_t pushes = 0;
+        std::size_t decrease_keys = 0;
+        std::size_t closes = 0;
+        std::size_t expansions = 0;
+
+        void on_push(int, int, double) { ++pushes; }
+        void on_decrease_key(int, int, double) { ++decrease_keys; }
+        void on_close(int, int) { ++closes; }
+        void on_expand(int, int, double) { ++expansions; }
+    };
+
+    bool has_visited_cells(const Map& map)
+    {
+        for (int row = 0; row < map.rows(); ++row) {
+            for (int col = 0; col < map.columns(); ++col) {
+                if (map.at(row, col) == Map::CellType::VISITED) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void add_wall(Map& map)
+    {
+        for (int row = 0; row < 7; ++row) {
+            map.set_pos(row, 4, Map::CellType::BLOCKED);
+        }
+    }
+}
+
+TEST(SearchObserverTests, TestObserverMatchesStats)
+{
+    Map map(10, 10);
+    add_wall(map);
+    AStarSolver solver(map);
+    CountingObserver observer;
+
+    auto path = solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 7), observer);
+
+    ASSERT_NE(path, nullptr);
+    const auto& stats = solver.stats();
+    ASSERT_EQ(stats.pushes, observer.pushes);
+    ASSERT_EQ(stats.decrease_keys, observer.decrease_keys);
+    ASSERT_EQ(stats.pops, observer.closes);
+    ASSERT_EQ(stats.expansions, observer.expansions);
+
+    // the goal is closed without being expanded
+    ASSERT_EQ(stats.pops, stats.expansions + 1);
+    ASSERT_EQ(stats.pushes + stats.pops + stats.decrease_keys, stats.heap_operations());
+    ASSERT_GT(stats.peak_open, 0u);
+}
+
+TEST(SearchObserverTests, TestSearchesDoNotChangeTheMap)
+{
+    Map map(10, 10);
+    add_wall(map);
+    const auto version = map.version();
+
+    AStarSolver astar(map);
+    JumpPointSolver jump_point(map);
+    BidirectionalSolver bidirectional(map);
+    HierarchicalSolver hierarchical(map, 4);
+
+    ASSERT_NE(astar.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 7)), nullptr);
+    ASSERT_NE(jump_point.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 7)), nullptr);
+    ASSERT_NE(bidirectional.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 7)), nullptr);
+    ASSERT_NE(hierarchical.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 7)), nullptr);
+
+    ASSERT_FALSE(has_visited_cells(map));
+    ASSERT_EQ(version, map.version());
+}
+
+TEST(SearchObserverTests, TestMapVisitObserver)
+{
+    Map map(10, 10);
+    add_wall(map);
+    AStarSolver solver(map);
+    MapVisitObserver observer(map);
+
+    auto path = solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 7), observer);
+
+    ASSERT_NE(path, nullptr);
+    ASSERT_EQ(Map::CellType::VISITED, map.at(1, 1));
+    ASSERT_EQ(Map::CellType::VISITED, map.at(1, 7));
+    ASSERT_EQ(Map::CellType::BLOCKED, map.at(0, 4));
+}
+
+TEST(SearchObserverTests, TestBidirectionalObserver)
+{
+    Map map(10, 10);
+    add_wall(map);
+    BidirectionalSolver solver(map);
+    CountingObserver observer;
+
+    auto path = solver.find(std::make_shared<Node>(1, 1), std::make_shared<Node>(1, 7), observer);
+
+    ASSERT_NE(path, nullptr);
+    ASSERT_EQ(solver.stats().pushes, observer.pushes);
+    ASSERT_EQ(solver.stats().pops, observer.closes);
+    ASSERT_EQ(solver.stats().expansions, observer.expansions);
+    ASSERT_GT(solver.stats().elapsed.count(), 0);
+}
+
+export class SearchObserverTests;
@@ -0,0 +1,115 @@
+/* ThreadPoolTests.ixx - unit tests for the ThreadPool class
+ * Copyright (C) 2021 Paulo Pinto
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+module;
+
+#include <atomic>
+#include <latch>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include <gtest/gtest.h>
+
+export module ThreadPoolTests;
+
+import AStarLib;
+
+using namespace AStarLib;
+
+using namespace testing;
+
+TEST(ThreadPoolTests, TestEveryIndexOnce)
+{
+    ThreadPool pool(4);
+    ASSERT_EQ(4u, pool.size());
+
+    std::vector<std::atomic<int>> calls(1000);
+    pool.parallel_for(calls.size(), [&calls](std::size_t, std::size_t index) {
+        calls[index].fetch_add(1);
+    });
+
+    for (const auto& count : calls) {
+        ASSERT_EQ(1, count.load());
+    }
+}
+
+TEST(ThreadPoolTests, TestWorkerIndex)
+{
+    ThreadPool pool(3);
+
+    std::atomic<bool> valid = true;
+    pool.parallel_for(100, [&pool, &valid](std::size_t worker, std::size_t) {
+        if (worker >= pool.size()) {
+            valid = false;
+        }
+    });
+
+    ASSERT_TRUE(valid);
+}
+
+TEST(ThreadPoolTests, TestException)
+{
+    ThreadPool pool(2);
+
+    std::atomic<int> calls = 0;
+    ASSERT_THROW(pool.parallel_for(10, [&calls](std::size_t, std::size_t index) {
+        ++calls;
+        if (index == 5) {
+            throw std::runtime_error("failed");
+        }
+    }), std::runtime_error);
+
+    // the pool keeps working afterwards
+    calls = 0;
+    pool.parallel_for(10, [&calls](std::size_t, std::size_t) { ++calls; });
+    ASSERT_EQ(10, calls.load());
+}
+
+TEST(ThreadPoolTests, TestPriority)
+{
+    ThreadPool pool(1);
+
+    // keeps the only worker busy while the other tasks get queued
+    std::latch queued(1);
+    std::latch done(4);
+    pool.submit([&queued, &done](std::size_t) {
+        queued.wait();
+        done.count_down();
+    });
+
+    std::mutex lock;
+    std::vector<int> order;
+    const auto task = [&](int id) {
+        return [&, id](std::size_t) {
+            {
+                std::lock_guard guard(lock);
+                order.push_back(id);
+            }
+            done.count_down();
+        };
+    };
+    pool.submit(task(1));
+    pool.submit(task(2));
+    pool.submit(task(3), TaskPriority::INTERACTIVE);
+    queued.count_down();
+    done.wait();
+
+    ASSERT_EQ((std::vector<int>{ 3, 1, 2 }), order);
+}
+
+export class ThreadPoolTests;
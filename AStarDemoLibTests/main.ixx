@@ -23,7 +23,25 @@ module;
 export module main;
 
 import NodeTests;
+import PathTests;
 import MapTests;
+import MapFileTests;
+import OpenListTests;
+import AStarSolverTests;
+import JumpPointSolverTests;
+import HierarchicalSolverTests;
+import ThreadPoolTests;
+import BatchSolverTests;
+import AsyncSolverTests;
+import FlowFieldTests;
+import BidirectionalSolverTests;
+import IncrementalSolverTests;
+import PathCacheTests;
+import ChunkedMapTests;
+import SearchObserverTests;
+import ExpansionStreamTests;
+import ConnectivityTests;
+import CooperativePlannerTests;
 
 
 export int main(int argc, char* argv[])